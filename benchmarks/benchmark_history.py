@@ -0,0 +1,374 @@
+#!/usr/bin/env python3
+"""
+Benchmark history store and HTML trend report
+
+Every run of the C++ benchmark is appended to a local JSON-lines history store,
+keyed by git commit, host fingerprint and build flags. The `report` command
+renders a static HTML page that charts each kernel's latency and GFLOP/s over
+time and marks regressions against the preceding runs of the same series.
+
+Usage:
+    python3 benchmark_history.py record --input ../build/benchmark_cpp_output.txt
+    python3 benchmark_history.py report
+"""
+
+import argparse
+import hashlib
+import html
+import json
+import os
+import platform
+import re
+import statistics
+import subprocess
+import sys
+import time
+from typing import Dict, List, Optional
+
+from compare_benchmarks import parse_cpp_output
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_ROOT = os.path.dirname(SCRIPT_DIR)
+DEFAULT_HISTORY = os.path.join(SCRIPT_DIR, 'history', 'benchmark_history.jsonl')
+DEFAULT_REPORT = os.path.join(SCRIPT_DIR, 'history', 'benchmark_trend_report.html')
+DEFAULT_BUILD_DIR = os.path.join(REPO_ROOT, 'build')
+
+# Floating point operations per call, derived from the benchmark name
+FLOP_PATTERNS = [
+    (re.compile(r'MatMul \((\d+)x(\d+)\)'), lambda m: 2 * int(m.group(1)) ** 3),
+    (re.compile(r'Linear \((\d+)->(\d+)\)'),
+     lambda m: 2 * int(m.group(1)) * int(m.group(2)) + int(m.group(2))),
+    (re.compile(r'ReLU \((\d+)\)'), lambda m: int(m.group(1))),
+    (re.compile(r'Add \((\d+)\)'), lambda m: int(m.group(1))),
+    (re.compile(r'Train(?: \w+)? \((\d+)->(\d+), batch (\d+)'),
+     lambda m: 4 * int(m.group(1)) * int(m.group(2)) * int(m.group(3))),
+    (re.compile(r'SoftmaxCE \((\d+)\)'), lambda m: 4 * int(m.group(1))),
+    (re.compile(r'(?:GEMM|Linear rows) \((\d+)x(\d+)x(\d+)\)'),
+     lambda m: 2 * int(m.group(1)) * int(m.group(2)) * int(m.group(3))),
+    (re.compile(r'MoE \w+ \((\d+) tokens, (\d+)->(\d+), (\d+) experts, top-(\d+)\)'),
+     lambda m: 2 * int(m.group(1)) * int(m.group(2)) * (int(m.group(5)) * int(m.group(3)) + int(m.group(4)))),
+]
+
+
+def kernel_name(operation: str) -> str:
+    """Strip the framework suffix: 'MatMul (4x4) - C++ (Meta)' -> 'MatMul (4x4)'"""
+    return operation.rsplit(' - ', 1)[0].strip()
+
+
+def flops_for(kernel: str) -> Optional[int]:
+    for pattern, flops in FLOP_PATTERNS:
+        match = pattern.search(kernel)
+        if match:
+            return flops(match)
+    return None
+
+
+def run_command(args: List[str]) -> str:
+    try:
+        return subprocess.check_output(args, cwd=REPO_ROOT, stderr=subprocess.DEVNULL,
+                                       text=True).strip()
+    except (subprocess.CalledProcessError, FileNotFoundError):
+        return ''
+
+
+def git_info() -> Dict[str, object]:
+    commit = run_command(['git', 'rev-parse', 'HEAD']) or 'unknown'
+    return {
+        'commit': commit,
+        'short': commit[:10],
+        'subject': run_command(['git', 'log', '-1', '--format=%s']),
+        'dirty': bool(run_command(['git', 'status', '--porcelain', '--untracked-files=no'])),
+    }
+
+
+def cpu_model() -> str:
+    try:
+        with open('/proc/cpuinfo') as f:
+            for line in f:
+                if line.startswith('model name'):
+                    return line.split(':', 1)[1].strip()
+    except OSError:
+        pass
+    return run_command(['sysctl', '-n', 'machdep.cpu.brand_string']) or platform.processor()
+
+
+def host_info() -> Dict[str, object]:
+    info = {
+        'hostname': platform.node(),
+        'system': f'{platform.system()} {platform.release()}',
+        'machine': platform.machine(),
+        'cpu': cpu_model(),
+        'cores': os.cpu_count() or 0,
+    }
+    key = '|'.join(str(info[k]) for k in ('hostname', 'system', 'machine', 'cpu', 'cores'))
+    info['fingerprint'] = hashlib.sha1(key.encode()).hexdigest()[:12]
+    return info
+
+
+def build_info(build_dir: str) -> Dict[str, object]:
+    """Read compiler and flags from the CMake cache of the benchmark build"""
+    cache = {}
+    try:
+        with open(os.path.join(build_dir, 'CMakeCache.txt')) as f:
+            for line in f:
+                match = re.match(r'^([A-Za-z_]+):[A-Z]+=(.*)$', line.strip())
+                if match:
+                    cache[match.group(1)] = match.group(2)
+    except OSError:
+        pass
+    # Effective flags (including those set in CMakeLists.txt) live in flags.make
+    flags = {}
+    try:
+        with open(os.path.join(build_dir, 'CMakeFiles', 'benchmark_cpp.dir', 'flags.make')) as f:
+            for line in f:
+                match = re.match(r'^(CXX_FLAGS|CXX_DEFINES)\s*=\s*(.*)$', line.strip())
+                if match:
+                    flags[match.group(1)] = match.group(2).strip()
+    except OSError:
+        pass
+    compiler = cache.get('CMAKE_CXX_COMPILER', '')
+    version = run_command([compiler, '--version']).split('\n')[0] if compiler else ''
+    info = {
+        'compiler': version or compiler or 'unknown',
+        'build_type': cache.get('CMAKE_BUILD_TYPE', ''),
+        'cxx_flags': ' '.join(v for v in (flags.get('CXX_FLAGS', cache.get('CMAKE_CXX_FLAGS', '')),
+                                          flags.get('CXX_DEFINES', '')) if v),
+    }
+    key = '|'.join(str(info[k]) for k in ('compiler', 'build_type', 'cxx_flags'))
+    info['fingerprint'] = hashlib.sha1(key.encode()).hexdigest()[:12]
+    return info
+
+
+def load_history(path: str) -> List[dict]:
+    runs = []
+    if not os.path.exists(path):
+        return runs
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if line:
+                runs.append(json.loads(line))
+    return runs
+
+
+def record(args) -> None:
+    if args.input == '-':
+        output = sys.stdin.read()
+    elif args.input:
+        with open(args.input) as f:
+            output = f.read()
+    else:
+        output = subprocess.check_output([os.path.join(args.build_dir, 'benchmark_cpp')],
+                                         stderr=subprocess.STDOUT, text=True)
+
+    results = parse_cpp_output(output)
+    if not results:
+        print('Error: no benchmark results found in C++ output.')
+        sys.exit(1)
+
+    kernels = {}
+    for result in results:
+        name = kernel_name(result.operation)
+        flops = flops_for(name)
+        kernels[name] = {
+            'mean_us': result.mean_us,
+            'median_us': result.median_us,
+            'stddev_us': result.stddev_us,
+            'iterations': result.iterations,
+            'flops': flops,
+            'gflops': flops / (result.mean_us * 1e3) if flops and result.mean_us > 0 else None,
+        }
+
+    run = {
+        'timestamp': time.strftime('%Y-%m-%dT%H:%M:%S%z'),
+        'git': git_info(),
+        'host': host_info(),
+        'build': build_info(args.build_dir),
+        'kernels': kernels,
+    }
+
+    os.makedirs(os.path.dirname(os.path.abspath(args.history)), exist_ok=True)
+    with open(args.history, 'a') as f:
+        f.write(json.dumps(run, sort_keys=True) + '\n')
+
+    print(f"Recorded {len(kernels)} kernels for commit {run['git']['short']} "
+          f"(host {run['host']['fingerprint']}, build {run['build']['fingerprint']}) "
+          f"to {args.history}")
+
+
+def series_key(run: dict) -> str:
+    return f"{run['host']['fingerprint']}/{run['build']['fingerprint']}"
+
+
+def find_regressions(values: List[Optional[float]], window: int, threshold: float,
+                     higher_is_better: bool) -> List[bool]:
+    """Flag points that are worse than the median of the previous `window` points"""
+    flags = []
+    for i, value in enumerate(values):
+        previous = [v for v in values[max(0, i - window):i] if v is not None and v > 0]
+        if value is None or len(previous) < 1:
+            flags.append(False)
+            continue
+        baseline = statistics.median(previous)
+        if higher_is_better:
+            flags.append(value < baseline * (1.0 - threshold))
+        else:
+            flags.append(value > baseline * (1.0 + threshold))
+    return flags
+
+
+SERIES_COLORS = ['#1f77b4', '#ff7f0e', '#2ca02c', '#9467bd', '#8c564b', '#e377c2']
+
+
+def svg_chart(title: str, unit: str, series: Dict[str, List[dict]]) -> str:
+    """Render one line chart; each point is {'x': run_index, 'y': value, 'label', 'regression'}"""
+    width, height, pad_l, pad_r, pad_t, pad_b = 560, 220, 60, 20, 28, 30
+    points = [p for pts in series.values() for p in pts if p['y'] is not None]
+    if not points:
+        return f'<div class="empty">{html.escape(title)}: no data</div>'
+
+    x_max = max(p['x'] for p in points)
+    y_max = max(p['y'] for p in points) * 1.1 or 1.0
+    plot_w, plot_h = width - pad_l - pad_r, height - pad_t - pad_b
+
+    def sx(x):
+        return pad_l + (plot_w * x / x_max if x_max > 0 else plot_w / 2)
+
+    def sy(y):
+        return pad_t + plot_h - plot_h * y / y_max
+
+    parts = [f'<svg width="{width}" height="{height}" xmlns="http://www.w3.org/2000/svg">',
+             f'<text x="{pad_l}" y="16" class="title">{html.escape(title)} ({unit})</text>',
+             f'<line x1="{pad_l}" y1="{pad_t + plot_h}" x2="{width - pad_r}" '
+             f'y2="{pad_t + plot_h}" class="axis"/>',
+             f'<line x1="{pad_l}" y1="{pad_t}" x2="{pad_l}" y2="{pad_t + plot_h}" class="axis"/>']
+    for frac in (0.0, 0.5, 1.0):
+        y = y_max * frac / 1.1
+        parts.append(f'<text x="{pad_l - 6}" y="{sy(y) + 4:.1f}" class="tick" '
+                     f'text-anchor="end">{y:.3g}</text>')
+
+    for idx, (name, pts) in enumerate(sorted(series.items())):
+        color = SERIES_COLORS[idx % len(SERIES_COLORS)]
+        valid = [p for p in pts if p['y'] is not None]
+        if len(valid) > 1:
+            path = ' '.join(f"{sx(p['x']):.1f},{sy(p['y']):.1f}" for p in valid)
+            parts.append(f'<polyline points="{path}" fill="none" stroke="{color}" '
+                         f'stroke-width="1.5"/>')
+        for p in valid:
+            tip = html.escape(f"{name} {p['label']}: {p['y']:.4g} {unit}")
+            if p['regression']:
+                parts.append(f'<circle cx="{sx(p["x"]):.1f}" cy="{sy(p["y"]):.1f}" r="5" '
+                             f'class="regression"><title>REGRESSION {tip}</title></circle>')
+            else:
+                parts.append(f'<circle cx="{sx(p["x"]):.1f}" cy="{sy(p["y"]):.1f}" r="3" '
+                             f'fill="{color}"><title>{tip}</title></circle>')
+    parts.append('</svg>')
+    return '\n'.join(parts)
+
+
+def report(args) -> None:
+    runs = load_history(args.history)
+    if not runs:
+        print(f'Error: no history found at {args.history}. Run "record" first.')
+        sys.exit(1)
+
+    kernels = sorted({name for run in runs for name in run['kernels']})
+    configs = {}
+    for run in runs:
+        configs.setdefault(series_key(run), run)
+
+    sections = []
+    regressions = []
+    for kernel in kernels:
+        latency, gflops = {}, {}
+        for key in configs:
+            series_runs = [(i, run) for i, run in enumerate(runs)
+                           if series_key(run) == key and kernel in run['kernels']]
+            if not series_runs:
+                continue
+            lat_values = [run['kernels'][kernel]['mean_us'] for _, run in series_runs]
+            gf_values = [run['kernels'][kernel].get('gflops') for _, run in series_runs]
+            lat_flags = find_regressions(lat_values, args.window, args.threshold, False)
+            gf_flags = find_regressions(gf_values, args.window, args.threshold, True)
+            lat_points, gf_points = [], []
+            for (i, run), lat, gf, lat_reg, gf_reg in zip(series_runs, lat_values, gf_values,
+                                                          lat_flags, gf_flags):
+                label = f"{run['git']['short']}{'+' if run['git']['dirty'] else ''} {run['timestamp']}"
+                lat_points.append({'x': i, 'y': lat, 'label': label, 'regression': lat_reg})
+                gf_points.append({'x': i, 'y': gf, 'label': label, 'regression': gf_reg})
+                if lat_reg:
+                    regressions.append((kernel, key, label, lat))
+            latency[key] = lat_points
+            gflops[key] = gf_points
+
+        sections.append(f'<h2>{html.escape(kernel)}</h2>\n<div class="charts">\n'
+                        f'{svg_chart("Mean latency", "μs", latency)}\n'
+                        f'{svg_chart("Throughput", "GFLOP/s", gflops)}\n</div>')
+
+    config_rows = '\n'.join(
+        f"<tr><td><code>{html.escape(key)}</code></td><td>{html.escape(run['host']['hostname'])}</td>"
+        f"<td>{html.escape(run['host']['cpu'])} ({run['host']['cores']} cores)</td>"
+        f"<td>{html.escape(run['build']['compiler'])}</td>"
+        f"<td><code>{html.escape(run['build']['build_type'] + ' ' + run['build']['cxx_flags'])}</code></td></tr>"
+        for key, run in sorted(configs.items()))
+    regression_rows = '\n'.join(
+        f'<tr><td>{html.escape(kernel)}</td><td><code>{html.escape(key)}</code></td>'
+        f'<td>{html.escape(label)}</td><td>{lat:.3f}</td></tr>'
+        for kernel, key, label, lat in regressions) or '<tr><td colspan="4">None</td></tr>'
+
+    page = f"""<!DOCTYPE html>
+<html><head><meta charset="utf-8"><title>Benchmark Trend Report</title>
+<style>
+body {{ font-family: sans-serif; margin: 2em; }}
+table {{ border-collapse: collapse; margin-bottom: 1.5em; }}
+td, th {{ border: 1px solid #ccc; padding: 4px 8px; font-size: 13px; }}
+.charts {{ display: flex; flex-wrap: wrap; gap: 16px; }}
+.title {{ font-size: 13px; font-weight: bold; }}
+.tick {{ font-size: 10px; fill: #555; }}
+.axis {{ stroke: #888; }}
+.regression {{ fill: #d62728; stroke: #000; }}
+</style></head><body>
+<h1>Benchmark Trend Report</h1>
+<p>{len(runs)} runs, generated {html.escape(time.strftime('%Y-%m-%d %H:%M:%S'))}.
+Series are keyed by <code>host/build</code> fingerprint; red points regress by more than
+{args.threshold * 100:.0f}% against the median of the previous {args.window} runs.</p>
+<h2>Configurations</h2>
+<table><tr><th>Series</th><th>Host</th><th>CPU</th><th>Compiler</th><th>Flags</th></tr>
+{config_rows}</table>
+<h2>Latency regressions</h2>
+<table><tr><th>Kernel</th><th>Series</th><th>Run</th><th>Mean (μs)</th></tr>
+{regression_rows}</table>
+{''.join(sections)}
+</body></html>
+"""
+    os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+    with open(args.output, 'w') as f:
+        f.write(page)
+    print(f'Wrote trend report for {len(kernels)} kernels ({len(regressions)} regressions) '
+          f'to {args.output}')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().split('\n')[0])
+    parser.add_argument('--history', default=DEFAULT_HISTORY, help='history store (JSON lines)')
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    rec = sub.add_parser('record', help='append a C++ benchmark run to the history store')
+    rec.add_argument('--input', help="saved benchmark_cpp output ('-' for stdin); "
+                                     "runs benchmark_cpp when omitted")
+    rec.add_argument('--build-dir', default=DEFAULT_BUILD_DIR, help='CMake build directory')
+    rec.set_defaults(func=record)
+
+    rep = sub.add_parser('report', help='generate the static HTML trend report')
+    rep.add_argument('--output', default=DEFAULT_REPORT, help='HTML output path')
+    rep.add_argument('--window', type=int, default=5, help='runs in the regression baseline')
+    rep.add_argument('--threshold', type=float, default=0.10,
+                     help='relative slowdown flagged as a regression')
+    rep.set_defaults(func=report)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == '__main__':
+    main()
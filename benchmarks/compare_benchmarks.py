@@ -27,13 +27,11 @@ def parse_cpp_output(output: str) -> List[BenchmarkResult]:
     current_operation = None
     current_stats = {}
     
-    for i, line in enumerate(lines):
-        # Match operation name
+    for line in lines:
+        # Match operation name ("<name> Statistics:")
         if 'Statistics:' in line:
-            # Extract operation name from previous lines
-            if i > 0:
-                op_line = lines[i-1].strip()
-                current_operation = op_line.replace(' Statistics:', '')
+            current_operation = line.strip().replace(' Statistics:', '')
+            current_stats = {}
         
         # Match statistics
         if 'Mean:' in line:
@@ -44,16 +42,16 @@ def parse_cpp_output(output: str) -> List[BenchmarkResult]:
             match = re.search(r'Median:\s+([\d.]+)\s+μs', line)
             if match:
                 current_stats['median'] = float(match.group(1))
-        elif 'StdDev:' in line:
-            match = re.search(r'StdDev:\s+([\d.]+)\s+μs', line)
-            if match:
-                current_stats['stddev'] = float(match.group(1))
         elif 'Iterations:' in line:
             match = re.search(r'Iterations:\s+(\d+)', line)
             if match:
                 current_stats['iterations'] = int(match.group(1))
+        elif 'StdDev:' in line:
+            match = re.search(r'StdDev:\s+([\d.]+)\s+μs', line)
+            if match:
+                current_stats['stddev'] = float(match.group(1))
                 
-                # Create result if we have all data
+                # Create result once all data is in (StdDev follows Mean/Median)
                 if 'mean' in current_stats and 'median' in current_stats:
                     results.append(BenchmarkResult(
                         operation=current_operation or "Unknown",
@@ -75,11 +73,10 @@ def parse_pytorch_output(output: str) -> List[BenchmarkResult]:
     current_operation = None
     current_stats = {}
     
-    for i, line in enumerate(lines):
+    for line in lines:
         if 'Statistics:' in line:
-            if i > 0:
-                op_line = lines[i-1].strip()
-                current_operation = op_line.replace(' Statistics:', '')
+            current_operation = line.strip().replace(' Statistics:', '')
+            current_stats = {}
         
         if 'Mean:' in line:
             match = re.search(r'Mean:\s+([\d.]+)\s+μs', line)
@@ -89,14 +86,14 @@ def parse_pytorch_output(output: str) -> List[BenchmarkResult]:
             match = re.search(r'Median:\s+([\d.]+)\s+μs', line)
             if match:
                 current_stats['median'] = float(match.group(1))
-        elif 'StdDev:' in line:
-            match = re.search(r'StdDev:\s+([\d.]+)\s+μs', line)
-            if match:
-                current_stats['stddev'] = float(match.group(1))
         elif 'Iterations:' in line:
             match = re.search(r'Iterations:\s+(\d+)', line)
             if match:
                 current_stats['iterations'] = int(match.group(1))
+        elif 'StdDev:' in line:
+            match = re.search(r'StdDev:\s+([\d.]+)\s+μs', line)
+            if match:
+                current_stats['stddev'] = float(match.group(1))
                 
                 if 'mean' in current_stats and 'median' in current_stats:
                     results.append(BenchmarkResult(
@@ -0,0 +1,294 @@
+#pragma once
+
+#include "thread_pool.hpp"
+#include "loss.hpp"
+#include "profiler.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * @brief Block-sparse attention: sliding windows, global tokens, block masks
+ *
+ * The score matrix is cut into block x block tiles. A BlockMask lists, per
+ * query block, the key blocks that hold at least one allowed (query, key)
+ * pair; every other tile is never touched, so cost is proportional to the
+ * number of non-zero blocks instead of seq_len^2. Each active tile is either
+ * full (no per-element test) or partial, in which case the token-level
+ * pattern (window, global tokens, causality) is applied inside the tile.
+ * The kernel is flash-attention style: per query block, scores, online
+ * softmax and the P * V product are computed tile by tile with a running
+ * row max, so no seq_len x seq_len matrix is ever materialized.
+ */
+
+/**
+ * @brief Token-level pattern: which keys j a query i may attend to
+ *
+ * Defaults allow every pair. window bounds |i - j| (i - j when causal); the
+ * first global_tokens positions attend to, and are attended by, every token.
+ */
+struct TokenPattern {
+    static constexpr std::size_t unlimited = std::numeric_limits<std::size_t>::max();
+
+    std::size_t window = unlimited;
+    std::size_t global_tokens = 0;
+    bool causal = false;
+
+    constexpr bool allowed(std::size_t i, std::size_t j) const {
+        if (causal && j > i) return false;
+        if (i < global_tokens || j < global_tokens) return true;
+        return window == unlimited || (i > j ? i - j : j - i) <= window;
+    }
+
+    // Number of allowed keys of query i in [k0, k1)
+    constexpr std::size_t count(std::size_t i, std::size_t k0, std::size_t k1) const {
+        auto overlap = [&](std::size_t a0, std::size_t a1) {
+            const std::size_t lo = std::max(a0, k0), hi = std::min(a1, k1);
+            return hi > lo ? hi - lo : 0;
+        };
+        const std::size_t end = causal ? i + 1 : unlimited;
+        if (i < global_tokens || window == unlimited) return overlap(0, end);
+        const std::size_t lo = i > window ? i - window : 0;
+        const std::size_t hi = causal ? i + 1 : (i + window + 1);
+        // [0, global) and [lo, hi) may overlap
+        return overlap(0, std::min(global_tokens, end)) + overlap(lo, hi) -
+               overlap(lo, std::min({global_tokens, hi, end}));
+    }
+};
+
+/**
+ * @brief Compile-time block pattern over a QBlocks x KBlocks tile grid
+ *
+ *   constexpr auto diag = StaticBlockMask<8, 8>::build([](std::size_t q, std::size_t k) {
+ *       return q == k || k == 0;
+ *   });
+ */
+template<std::size_t QBlocks, std::size_t KBlocks>
+struct StaticBlockMask {
+    std::array<bool, QBlocks * KBlocks> active{};
+
+    constexpr bool operator()(std::size_t q, std::size_t k) const { return active[q * KBlocks + k]; }
+    constexpr void set(std::size_t q, std::size_t k, bool on = true) { active[q * KBlocks + k] = on; }
+
+    template<typename Pred>
+    static constexpr StaticBlockMask build(Pred pred) {
+        StaticBlockMask mask;
+        for (std::size_t q = 0; q < QBlocks; ++q) {
+            for (std::size_t k = 0; k < KBlocks; ++k) mask.set(q, k, pred(q, k));
+        }
+        return mask;
+    }
+
+    constexpr std::size_t nnz() const {
+        std::size_t n = 0;
+        for (bool on : active) n += on;
+        return n;
+    }
+};
+
+/**
+ * @brief Runtime block-sparse layout (CSR over query blocks)
+ */
+class BlockMask {
+public:
+    struct Entry {
+        std::uint32_t key_block;
+        bool partial;  // apply TokenPattern::allowed per element
+    };
+
+private:
+    std::size_t seq_len_;
+    std::size_t block_;
+    TokenPattern pattern_;
+    std::vector<std::uint32_t> offsets_;  // query block b owns entries [offsets_[b], offsets_[b + 1])
+    std::vector<Entry> entries_;
+
+public:
+    /**
+     * @brief Tiles where block_pred(q_block, k_block) holds and the token
+     * pattern allows at least one pair
+     */
+    template<typename BlockPred>
+    BlockMask(std::size_t seq_len, std::size_t block, TokenPattern pattern, BlockPred&& block_pred)
+        : seq_len_(seq_len), block_(block), pattern_(pattern) {
+        const std::size_t blocks = num_blocks();
+        offsets_.reserve(blocks + 1);
+        offsets_.push_back(0);
+        for (std::size_t qb = 0; qb < blocks; ++qb) {
+            const std::size_t q0 = qb * block_, q1 = std::min(seq_len_, q0 + block_);
+            for (std::size_t kb = 0; kb < blocks; ++kb) {
+                if (!block_pred(qb, kb)) continue;
+                const std::size_t k0 = kb * block_, k1 = std::min(seq_len_, k0 + block_);
+                std::size_t allowed = 0;
+                for (std::size_t i = q0; i < q1; ++i) allowed += pattern_.count(i, k0, k1);
+                if (allowed == 0) continue;
+                entries_.push_back({static_cast<std::uint32_t>(kb), allowed < (q1 - q0) * (k1 - k0)});
+            }
+            offsets_.push_back(static_cast<std::uint32_t>(entries_.size()));
+        }
+    }
+
+    // Every tile the token pattern touches (e.g. sliding window + global tokens)
+    BlockMask(std::size_t seq_len, std::size_t block, TokenPattern pattern = {})
+        : BlockMask(seq_len, block, pattern, [](std::size_t, std::size_t) { return true; }) {}
+
+    // Compile-time tile pattern; the sequence is exactly Blocks tiles long
+    template<std::size_t Blocks>
+    BlockMask(const StaticBlockMask<Blocks, Blocks>& mask, std::size_t block, TokenPattern pattern = {})
+        : BlockMask(Blocks * block, block, pattern, [&](std::size_t q, std::size_t k) { return mask(q, k); }) {}
+
+    static BlockMask sliding_window(std::size_t seq_len, std::size_t block, std::size_t window,
+                                    std::size_t global_tokens = 0, bool causal = false) {
+        return BlockMask(seq_len, block, TokenPattern{window, global_tokens, causal});
+    }
+
+    std::size_t seq_len() const { return seq_len_; }
+    std::size_t block() const { return block_; }
+    std::size_t num_blocks() const { return (seq_len_ + block_ - 1) / block_; }
+    const TokenPattern& pattern() const { return pattern_; }
+
+    std::size_t nnz_blocks() const { return entries_.size(); }
+    double density() const {
+        const double blocks = static_cast<double>(num_blocks());
+        return static_cast<double>(entries_.size()) / (blocks * blocks);
+    }
+
+    const Entry* begin(std::size_t query_block) const { return entries_.data() + offsets_[query_block]; }
+    const Entry* end(std::size_t query_block) const { return entries_.data() + offsets_[query_block + 1]; }
+};
+
+namespace attention_detail {
+
+// Per-worker tile scratch, reused across query blocks
+struct Workspace {
+    std::vector<float> key_t;   // [dim, block]: transposed key tile
+    std::vector<float> scores;  // [block, block]
+    std::vector<float> acc;     // [block, dim]
+    std::vector<float> row_max;
+    std::vector<float> row_sum;
+
+    void resize(std::size_t block, std::size_t dim) {
+        key_t.resize(dim * block);
+        scores.resize(block * block);
+        acc.resize(block * dim);
+        row_max.resize(block);
+        row_sum.resize(block);
+    }
+};
+
+inline Workspace& workspace() {
+    static thread_local Workspace ws;
+    return ws;
+}
+
+// One query block against its active key blocks; q, k, v, out are one head
+inline void query_block(const float* q, const float* k, const float* v, float* out, std::size_t dim,
+                        const BlockMask& mask, std::size_t qb, float scale) {
+    const std::size_t block = mask.block();
+    const std::size_t q0 = qb * block, rows = std::min(block, mask.seq_len() - q0);
+    Workspace& ws = workspace();
+    ws.resize(block, dim);
+    float* key_t = ws.key_t.data();
+    float* scores = ws.scores.data();
+    float* acc = ws.acc.data();
+    constexpr float empty = -std::numeric_limits<float>::infinity();
+    std::fill(ws.row_max.begin(), ws.row_max.begin() + rows, empty);
+    std::fill(ws.row_sum.begin(), ws.row_sum.begin() + rows, 0.0f);
+    std::fill(acc, acc + rows * dim, 0.0f);
+
+    for (const BlockMask::Entry* e = mask.begin(qb); e != mask.end(qb); ++e) {
+        const std::size_t k0 = e->key_block * block, cols = std::min(block, mask.seq_len() - k0);
+        for (std::size_t c = 0; c < cols; ++c) {
+            for (std::size_t d = 0; d < dim; ++d) key_t[d * cols + c] = k[(k0 + c) * dim + d];
+        }
+
+        // scores = scale * Q_tile * K_tile^T, unit-stride over key columns
+        for (std::size_t r = 0; r < rows; ++r) {
+            float* s = scores + r * cols;
+            const float* qr = q + (q0 + r) * dim;
+            for (std::size_t c = 0; c < cols; ++c) s[c] = 0.0f;
+            for (std::size_t d = 0; d < dim; ++d) {
+                const float qd = qr[d] * scale;
+                const float* kt = key_t + d * cols;
+                for (std::size_t c = 0; c < cols; ++c) s[c] += qd * kt[c];
+            }
+        }
+
+        // Online softmax: rescale the running sum and output by exp(old_max - new_max)
+        for (std::size_t r = 0; r < rows; ++r) {
+            float* s = scores + r * cols;
+            if (e->partial) {
+                for (std::size_t c = 0; c < cols; ++c) {
+                    if (!mask.pattern().allowed(q0 + r, k0 + c)) s[c] = empty;
+                }
+            }
+            float tile_max = empty;
+            for (std::size_t c = 0; c < cols; ++c) tile_max = std::max(tile_max, s[c]);
+            if (tile_max == empty) continue;
+
+            const float new_max = std::max(ws.row_max[r], tile_max);
+            const float correction = std::exp(ws.row_max[r] - new_max);
+            ws.row_max[r] = new_max;
+            float sum = 0.0f;
+            for (std::size_t c = 0; c < cols; ++c) {
+                s[c] = s[c] == empty ? 0.0f : loss_detail::fast_exp(s[c] - new_max);
+                sum += s[c];
+            }
+            ws.row_sum[r] = ws.row_sum[r] * correction + sum;
+
+            float* o = acc + r * dim;
+            for (std::size_t d = 0; d < dim; ++d) o[d] *= correction;
+            for (std::size_t c = 0; c < cols; ++c) {
+                const float p = s[c];
+                if (p == 0.0f) continue;
+                const float* vc = v + (k0 + c) * dim;
+                for (std::size_t d = 0; d < dim; ++d) o[d] += p * vc[d];
+            }
+        }
+    }
+
+    // Rows without any allowed key produce zeros
+    for (std::size_t r = 0; r < rows; ++r) {
+        const float inv = ws.row_sum[r] > 0.0f ? 1.0f / ws.row_sum[r] : 0.0f;
+        float* dst = out + (q0 + r) * dim;
+        const float* o = acc + r * dim;
+        for (std::size_t d = 0; d < dim; ++d) dst[d] = o[d] * inv;
+    }
+}
+
+}  // namespace attention_detail
+
+/**
+ * @brief out = softmax(Q K^T / sqrt(dim) restricted to mask) * V
+ *
+ * q, k, v and out are [heads, seq_len, dim], row-major. Tasks are
+ * (head, query block) pairs; skipped tiles cost nothing.
+ */
+inline void sparse_attention(const float* q, const float* k, const float* v, float* out, std::size_t heads,
+                             std::size_t dim, const BlockMask& mask, ThreadPool& pool = ThreadPool::global()) {
+    NN_PROFILE_ZONE("sparse_attention");
+    const std::size_t seq_len = mask.seq_len();
+    NN_METRICS_KERNEL("sparse_attention", 4 * heads * mask.nnz_blocks() * mask.block() * mask.block() * dim,
+                      sizeof(float) * heads * (2 * seq_len * dim + 2 * mask.nnz_blocks() * mask.block() * dim));
+    const float scale = 1.0f / std::sqrt(static_cast<float>(dim));
+    const std::size_t blocks = mask.num_blocks();
+    pool.parallel_for(heads * blocks, [&](std::size_t task, std::size_t) {
+        const std::size_t offset = (task / blocks) * seq_len * dim;
+        attention_detail::query_block(q + offset, k + offset, v + offset, out + offset, dim, mask,
+                                      task % blocks, scale);
+    });
+}
+
+// Full (optionally causal) attention through the same tiled kernel
+inline void dense_attention(const float* q, const float* k, const float* v, float* out, std::size_t heads,
+                            std::size_t seq_len, std::size_t dim, std::size_t block = 64, bool causal = false,
+                            ThreadPool& pool = ThreadPool::global()) {
+    TokenPattern pattern;
+    pattern.causal = causal;
+    sparse_attention(q, k, v, out, heads, dim, BlockMask(seq_len, block, pattern), pool);
+}
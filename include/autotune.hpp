@@ -0,0 +1,283 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+/**
+ * @brief Runtime algorithm selection, persisted across processes
+ *
+ * Which implementation of an op is fastest for a shape (direct vs. FFT
+ * convolution, a generic vs. a specialized kernel, ...) depends on the host.
+ * select() answers that by timing the candidates the first time a shape is
+ * seen and remembering the winner in a Cache keyed by (host, op, shape).
+ * The cache file keeps one tab-separated entry per line:
+ *
+ *   host <TAB> op <TAB> shape <TAB> winner <TAB> microseconds
+ *
+ * host is the CPU model and hardware thread count, so one file can be
+ * shared between machines; entries of other hosts are kept but never
+ * matched. ScopedCache::from_env() loads NN_META_AUTOTUNE_CACHE at startup
+ * and writes it back at exit if anything was tuned, merged with whatever
+ * other processes saved meanwhile, so later processes skip the tuning cost.
+ * A cached winner that is no longer among the candidates (renamed or
+ * removed implementation) is tuned again.
+ */
+
+namespace nn_autotune {
+
+// "CPU model name xN" (N hardware threads), from /proc/cpuinfo where available
+inline const std::string& host_key() {
+    static const std::string key = [] {
+        std::string model;
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        for (std::string line; model.empty() && std::getline(cpuinfo, line);) {
+            if (line.rfind("model name", 0) != 0) continue;
+            const auto colon = line.find(':');
+            if (colon != std::string::npos) model = line.substr(line.find_first_not_of(' ', colon + 1));
+        }
+        if (model.empty()) model = "unknown-cpu";
+        std::replace(model.begin(), model.end(), '\t', ' ');
+        return model + " x" + std::to_string(std::thread::hardware_concurrency());
+    }();
+    return key;
+}
+
+struct Choice {
+    std::string name;
+    double microseconds = 0.0;
+};
+
+/**
+ * @brief Tuning results of any number of hosts; thread-safe
+ */
+class Cache {
+private:
+    using Key = std::tuple<std::string, std::string, std::string>;  // host, op, shape
+
+    mutable std::mutex mutex_;
+    std::map<Key, Choice> entries_;
+    bool dirty_ = false;
+
+public:
+    static Cache& instance() {
+        static Cache cache;
+        return cache;
+    }
+
+    std::optional<Choice> find(const std::string& op, const std::string& shape,
+                               const std::string& host = host_key()) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find({host, op, shape});
+        if (it == entries_.end()) return std::nullopt;
+        return it->second;
+    }
+
+    void store(const std::string& op, const std::string& shape, Choice choice, const std::string& host = host_key()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_[{host, op, shape}] = std::move(choice);
+        dirty_ = true;
+    }
+
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+    }
+
+    // Entries stored since the last load() / save()
+    bool dirty() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return dirty_;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+        dirty_ = false;
+    }
+
+    // Merges entries into the cache; malformed lines are skipped
+    void read(std::istream& in) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (std::string line; std::getline(in, line);) {
+            std::string fields[5];
+            std::istringstream s(line);
+            std::size_t n = 0;
+            while (n < 5 && std::getline(s, fields[n], '\t')) ++n;
+            if (n != 5 || fields[3].empty()) continue;
+            char* end = nullptr;
+            const double us = std::strtod(fields[4].c_str(), &end);
+            if (end == fields[4].c_str()) continue;
+            entries_[{fields[0], fields[1], fields[2]}] = {fields[3], us};
+        }
+    }
+
+    void write(std::ostream& out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [key, choice] : entries_) {
+            const auto& [host, op, shape] = key;
+            out << host << '\t' << op << '\t' << shape << '\t' << choice.name << '\t' << choice.microseconds << '\n';
+        }
+    }
+
+    // Merges the file into the cache; false if it cannot be read
+    bool load(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) return false;
+        read(in);
+        std::lock_guard<std::mutex> lock(mutex_);
+        dirty_ = false;
+        return true;
+    }
+
+    /**
+     * @brief Merges the entries other processes saved to path in the meantime
+     * (ours win on the same key), then writes everything to a temporary file
+     * of this process and renames it into place
+     *
+     * Readers see the old or the new file, and concurrent savers never share
+     * a temporary. Two saves racing between their merge and their rename can
+     * still drop the entries of the first; the next save of either restores
+     * its own.
+     */
+    bool save(const std::string& path) {
+        {
+            Cache disk;
+            disk.load(path);
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto& [key, choice] : disk.entries_) entries_.try_emplace(key, choice);
+        }
+        static std::atomic<unsigned> serial{0};
+        const std::string temporary = path + ".tmp." + std::to_string(getpid()) + "." + std::to_string(serial++);
+        {
+            std::ofstream out(temporary, std::ios::trunc);
+            if (!out) return false;
+            write(out);
+            if (!out.flush()) {
+                std::remove(temporary.c_str());
+                return false;
+            }
+        }
+        if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+            std::remove(temporary.c_str());
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        dirty_ = false;
+        return true;
+    }
+};
+
+/**
+ * @brief Loads the process-wide cache for the lifetime of the guard, saves it on exit if tuned
+ */
+class ScopedCache {
+private:
+    std::string path_;
+
+public:
+    ScopedCache() = default;
+    explicit ScopedCache(std::string path) : path_(std::move(path)) { Cache::instance().load(path_); }
+
+    static ScopedCache from_env(const char* variable = "NN_META_AUTOTUNE_CACHE") {
+        const char* path = std::getenv(variable);
+        return path != nullptr ? ScopedCache(path) : ScopedCache();
+    }
+
+    ScopedCache(ScopedCache&& other) noexcept : path_(std::move(other.path_)) { other.path_.clear(); }
+    ScopedCache(const ScopedCache&) = delete;
+    ScopedCache& operator=(const ScopedCache&) = delete;
+    ScopedCache& operator=(ScopedCache&&) = delete;
+
+    ~ScopedCache() {
+        if (!path_.empty() && Cache::instance().dirty()) Cache::instance().save(path_);
+    }
+
+    bool active() const { return !path_.empty(); }
+};
+
+struct Candidate {
+    std::string name;           // stable across builds: it is what the cache stores
+    std::function<void()> run;  // one call of the implementation on representative data
+};
+
+namespace detail {
+
+constexpr int min_runs = 3;
+constexpr int max_runs = 20;
+constexpr double budget_us = 20000.0;  // per candidate, after the first min_runs
+
+// Best of a few runs after a warmup call (which also absorbs lazy setup)
+inline double time_candidate(const Candidate& candidate) {
+    using clock = std::chrono::steady_clock;
+    candidate.run();
+    double best = 0.0, total = 0.0;
+    for (int i = 0; i < max_runs && (i < min_runs || total < budget_us); ++i) {
+        const auto start = clock::now();
+        candidate.run();
+        const double us = std::chrono::duration<double, std::micro>(clock::now() - start).count();
+        best = i == 0 ? us : std::min(best, us);
+        total += us;
+    }
+    return best;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Index of the fastest candidate for (op, shape) on this host
+ *
+ * On a cache hit nothing runs. Otherwise every candidate is timed, so each
+ * run() must be safe to call repeatedly; the winner is stored in the cache.
+ */
+inline std::size_t select(const std::string& op, const std::string& shape, const std::vector<Candidate>& candidates,
+                          Cache& cache = Cache::instance()) {
+    if (candidates.size() < 2) return 0;
+    if (auto cached = cache.find(op, shape)) {
+        for (std::size_t i = 0; i < candidates.size(); ++i) {
+            if (candidates[i].name == cached->name) return i;
+        }
+    }
+    std::size_t best = 0;
+    double best_us = 0.0;
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+        const double us = detail::time_candidate(candidates[i]);
+        if (i == 0 || us < best_us) {
+            best = i;
+            best_us = us;
+        }
+    }
+    cache.store(op, shape, {candidates[best].name, best_us});
+    return best;
+}
+
+// "a,b,c" key of an extent list
+template<typename Range>
+std::string shape_key(const Range& extents) {
+    std::string key;
+    for (const auto& extent : extents) {
+        if (!key.empty()) key += ',';
+        key += std::to_string(extent);
+    }
+    return key;
+}
+
+}  // namespace nn_autotune
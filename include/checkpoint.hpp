@@ -0,0 +1,253 @@
+#pragma once
+
+#include "tensor.hpp"
+#include "nn_compiler.hpp"
+#include "memory_tracker.hpp"
+#include <cstddef>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Gradient checkpointing (activation recomputation) for Sequential models
+ *
+ * Backprop normally keeps the input of every layer alive until its backward
+ * pass. A checkpoint plan keeps only the inputs of some layers (segment
+ * starts); the others are dropped during forward and recomputed, one segment
+ * at a time, from the nearest stored input when backward reaches them. Every
+ * activation lives in its own tracked heap buffer, so the activation peak is
+ * visible in MemoryTracker under the "CheckpointedModel" owner.
+ */
+
+/**
+ * @brief Which layer inputs survive the forward pass
+ */
+struct CheckpointPlan {
+    std::vector<bool> stored;            // stored[i]: input of layer i is kept (stored[0] always)
+    std::size_t peak_bytes = 0;          // modelled activation peak of one step
+    std::size_t recomputed_layers = 0;   // extra layer forwards per step
+
+    std::size_t num_stored() const {
+        std::size_t n = 0;
+        for (bool s : stored) n += s;
+        return n;
+    }
+};
+
+namespace checkpoint_detail {
+
+// Peak live activation bytes of one training step under `stored`.
+// sizes[i] is the input of layer i; sizes[n] is the model output.
+inline CheckpointPlan evaluate(const std::vector<std::size_t>& sizes, std::vector<bool> stored) {
+    const std::size_t n = stored.size();
+    CheckpointPlan plan;
+    plan.stored = std::move(stored);
+
+    // Forward: kept inputs so far plus the current input and the layer's output
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        std::size_t live = kept + sizes[i] + sizes[i + 1];
+        if (live > plan.peak_bytes) plan.peak_bytes = live;
+        if (plan.stored[i]) kept += sizes[i];
+    }
+
+    // Backward, segment [s, e) from the last one: earlier checkpoints plus the
+    // recomputed segment; inputs of later segments have been freed already
+    std::size_t e = n;
+    while (e > 0) {
+        std::size_t s = e - 1;
+        while (!plan.stored[s]) --s;
+        kept -= sizes[s];
+        std::size_t live = kept;
+        for (std::size_t i = s; i < e; ++i) live += sizes[i];
+        if (live > plan.peak_bytes) plan.peak_bytes = live;
+        plan.recomputed_layers += e - s - 1;
+        e = s;
+    }
+    return plan;
+}
+
+// Cut the layers into k segments of roughly equal activation bytes
+inline std::vector<bool> balanced_segments(const std::vector<std::size_t>& sizes, std::size_t k) {
+    const std::size_t n = sizes.size() - 1;
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < n; ++i) total += sizes[i];
+
+    std::vector<bool> stored(n, false);
+    stored[0] = true;
+    std::size_t prefix = 0, next = 1;
+    for (std::size_t i = 0; i < n && next < k; ++i) {
+        if (prefix * k >= next * total) {
+            stored[i] = true;
+            ++next;
+        }
+        prefix += sizes[i];
+    }
+    return stored;
+}
+
+}  // namespace checkpoint_detail
+
+/**
+ * @brief Pick the checkpoint plan for a memory budget
+ *
+ * Candidates are the balanced k-segment plans for k = 1..n (k = n stores
+ * everything). The plan with the fewest recomputed layers whose peak fits the
+ * budget wins; if none fits, the one with the smallest peak.
+ */
+inline CheckpointPlan plan_checkpoints(const std::vector<std::size_t>& sizes, std::size_t budget_bytes) {
+    const std::size_t n = sizes.size() - 1;
+    CheckpointPlan best_fit, smallest;
+    bool have_fit = false;
+    for (std::size_t k = n; k >= 1; --k) {
+        CheckpointPlan plan = checkpoint_detail::evaluate(sizes, checkpoint_detail::balanced_segments(sizes, k));
+        if (k == n || plan.peak_bytes < smallest.peak_bytes) smallest = plan;
+        if (plan.peak_bytes <= budget_bytes &&
+            (!have_fit || plan.recomputed_layers < best_fit.recomputed_layers)) {
+            best_fit = plan;
+            have_fit = true;
+        }
+    }
+    return have_fit ? best_fit : smallest;
+}
+
+template<typename Model>
+class CheckpointedModel;
+
+/**
+ * @brief Runs training steps of a Sequential model under a checkpoint plan
+ *
+ * The model is borrowed; gradients accumulate in tracked workspace buffers
+ * until sgd_step() applies them.
+ */
+template<typename... Layers>
+class CheckpointedModel<Sequential<Layers...>> {
+public:
+    using Model = Sequential<Layers...>;
+    using Input = typename Model::Input;
+    using Output = typename Model::Output;
+    static constexpr std::size_t num_layers = Model::num_layers;
+
+private:
+    template<std::size_t I>
+    using InputAt = typename Model::template LayerAt<I>::Input;
+    template<std::size_t I>
+    using OutputAt = typename Model::template LayerAt<I>::Output;
+    using Grads = std::tuple<typename Layers::Gradients...>;
+
+    Model& model_;
+    CheckpointPlan plan_;
+    nn_memory::TagStats& activations_;
+    nn_memory::TagStats& workspace_;
+    std::tuple<nn_memory::TrackedPtr<typename Layers::Input>...> slots_;
+    nn_memory::TrackedPtr<Grads> grads_;
+
+    template<typename Buffer>
+    nn_memory::TrackedPtr<Buffer> make_buffer(nn_memory::TagStats& stats, const Buffer& value) const {
+        return nn_memory::make_tracked<Buffer>(nn_memory::TrackingAllocator<Buffer>(stats), value);
+    }
+
+    template<std::size_t I>
+    Output forward_pass(nn_memory::TrackedPtr<InputAt<I>> input) {
+        const auto& layer = model_.template layer<I>();
+        if constexpr (I + 1 == num_layers) {
+            Output output = layer.forward(*input);
+            if (plan_.stored[I]) std::get<I>(slots_) = std::move(input);
+            return output;
+        } else {
+            auto next = make_buffer(activations_, layer.forward(*input));
+            if (plan_.stored[I]) std::get<I>(slots_) = std::move(input);
+            input.reset();
+            return forward_pass<I + 1>(std::move(next));
+        }
+    }
+
+    // Rebuild the inputs of layers (from, to] from the stored input of `from`
+    template<std::size_t... J>
+    void recompute(std::size_t from, std::size_t to, std::index_sequence<J...>) {
+        ([&] {
+            if constexpr (J > 0) {
+                if (J > from && J <= to) {
+                    std::get<J>(slots_) = make_buffer(
+                        activations_, model_.template layer<J - 1>().forward(*std::get<J - 1>(slots_)));
+                }
+            }
+        }(), ...);
+    }
+
+    template<std::size_t I>
+    void backward_pass(nn_memory::TrackedPtr<OutputAt<I>> grad_output) {
+        if (!std::get<I>(slots_)) {
+            std::size_t from = I;
+            while (!plan_.stored[from]) --from;
+            recompute(from, I, std::index_sequence_for<Layers...>{});
+        }
+        auto& layer = model_.template layer<I>();
+        auto& grads = std::get<I>(*grads_);
+        if constexpr (I == 0) {
+            layer.backward(*std::get<I>(slots_), *grad_output, grads);
+            std::get<I>(slots_).reset();
+        } else {
+            auto grad_input = make_buffer(workspace_, layer.backward(*std::get<I>(slots_), *grad_output, grads));
+            grad_output.reset();
+            std::get<I>(slots_).reset();
+            backward_pass<I - 1>(std::move(grad_input));
+        }
+    }
+
+    static std::vector<std::size_t> activation_sizes() {
+        return {sizeof(typename Layers::Input)..., sizeof(Output)};
+    }
+
+public:
+    CheckpointedModel(Model& model, std::size_t activation_budget_bytes)
+        : model_(model),
+          plan_(plan_checkpoints(activation_sizes(), activation_budget_bytes)),
+          activations_(nn_memory::MemoryTracker::instance().tag("CheckpointedModel",
+                                                                nn_memory::MemoryPurpose::Activations)),
+          workspace_(nn_memory::MemoryTracker::instance().tag("CheckpointedModel",
+                                                              nn_memory::MemoryPurpose::Workspace)),
+          grads_(nn_memory::make_tracked<Grads>(nn_memory::TrackingAllocator<Grads>(workspace_))) {
+        zero_gradients();
+    }
+
+    const CheckpointPlan& plan() const { return plan_; }
+
+    // Activation peak with every layer input stored (no recomputation)
+    static std::size_t full_activation_bytes() {
+        auto sizes = activation_sizes();
+        return checkpoint_detail::evaluate(sizes, std::vector<bool>(num_layers, true)).peak_bytes;
+    }
+
+    // Tracker counters of the activation buffers (current / peak bytes)
+    nn_memory::TagStats& activation_stats() const { return activations_; }
+
+    /**
+     * @brief Forward, loss and backward of one sample; gradients accumulate
+     *
+     * loss_grad(output, grad_output) fills dL/doutput and returns the loss.
+     */
+    template<typename LossGrad>
+    auto accumulate(const Input& input, LossGrad&& loss_grad) {
+        Output output = forward_pass<0>(make_buffer(activations_, input));
+        auto grad_output = nn_memory::make_tracked<Output>(nn_memory::TrackingAllocator<Output>(workspace_));
+        auto loss = loss_grad(static_cast<const Output&>(output), *grad_output);
+        backward_pass<num_layers - 1>(std::move(grad_output));
+        return loss;
+    }
+
+    void zero_gradients() {
+        std::apply([](auto&... g) { (g.zero(), ...); }, *grads_);
+    }
+
+    // Apply the accumulated gradients and clear them
+    template<typename Scalar>
+    void sgd_step(Scalar learning_rate) {
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (model_.template layer<I>().sgd_update(std::get<I>(*grads_), learning_rate), ...);
+        }(std::index_sequence_for<Layers...>{});
+        zero_gradients();
+    }
+
+    const Grads& gradients() const { return *grads_; }
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "tensor_view.hpp"
+#include "thread_pool.hpp"
+#include "memory_tracker.hpp"
+#include "profiler.hpp"
+#include "metrics.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Concatenation and split without copies
+ *
+ * split() and chunk() only narrow a view. For concat, ConcatBuffer plans the
+ * placement up front: it allocates the concatenated output once and hands
+ * producer i the sub-view slot(i), so branches (Inception-style blocks,
+ * attention heads) write their results straight into place and output() is
+ * the concatenation with nothing left to copy. Producers that can only write
+ * dense buffers use concat_into(), the copying fallback: it moves the largest
+ * contiguous runs with memcpy and goes row by row otherwise.
+ */
+
+/**
+ * @brief Pieces of `sizes` elements along axis, as views of the input
+ */
+template<typename T, std::size_t Rank>
+std::vector<TensorView<T, Rank>> split(const TensorView<T, Rank>& input, std::size_t axis,
+                                       const std::vector<std::size_t>& sizes) {
+    std::vector<TensorView<T, Rank>> parts;
+    parts.reserve(sizes.size());
+    std::size_t start = 0;
+    for (std::size_t size : sizes) {
+        parts.push_back(input.narrow(axis, start, size));
+        start += size;
+    }
+    return parts;
+}
+
+// `count` near-equal pieces along axis (the first ones one larger)
+template<typename T, std::size_t Rank>
+std::vector<TensorView<T, Rank>> chunk(const TensorView<T, Rank>& input, std::size_t axis, std::size_t count) {
+    std::vector<std::size_t> sizes(count, input.shape(axis) / count);
+    for (std::size_t i = 0; i < input.shape(axis) % count; ++i) ++sizes[i];
+    return split(input, axis, sizes);
+}
+
+namespace concat_detail {
+
+// Elements per memcpy when dims [from, Rank) of the view are one dense run, else 0
+template<typename T, std::size_t Rank>
+std::size_t dense_run(const TensorView<T, Rank>& v, std::size_t from) {
+    std::ptrdiff_t expected = 1;
+    for (std::size_t d = Rank; d-- > from;) {
+        if (v.shape(d) != 1 && v.stride(d) != expected) return 0;
+        expected *= static_cast<std::ptrdiff_t>(v.shape(d));
+    }
+    return static_cast<std::size_t>(expected);
+}
+
+}  // namespace concat_detail
+
+/**
+ * @brief Copy src into dst (same shape): one memcpy per outer position when
+ * both are dense from `axis` inward, otherwise one copy per last-axis row
+ */
+template<typename T, std::size_t Rank>
+void concat_into(TensorView<T, Rank> dst, ConstView<T, Rank> src, std::size_t axis,
+                 ThreadPool& pool = ThreadPool::global()) {
+    static_assert(std::is_trivially_copyable_v<T>, "concat_into copies with memcpy");
+    using concat_detail::dense_run;
+    NN_METRICS_KERNEL("concat", 0, 2 * sizeof(T) * src.size());
+    constexpr std::size_t last = Rank - 1;
+
+    // Largest axis from which both views are one dense run per outer position
+    std::size_t from = axis;
+    while (from > 0 && dense_run(src, from - 1) && dense_run(dst, from - 1)) --from;
+    const std::size_t run = dense_run(src, from);
+    if (run != 0 && dense_run(dst, from) != 0) {
+        std::uint32_t pinned = 0;
+        for (std::size_t d = from; d < Rank; ++d) pinned |= 1u << d;
+        const Odometer<Rank> blocks(src.shape(), pinned);
+        pool.parallel_ranges(blocks.count(), [&](std::size_t begin, std::size_t end, std::size_t) {
+            Odometer<Rank> it = blocks;
+            it.walk(begin, end, [&](const auto& at) {
+                std::memcpy(dst.data() + dst.offset(at), src.data() + src.offset(at), run * sizeof(T));
+            });
+        });
+        return;
+    }
+
+    const Odometer<Rank> rows(src.shape(), 1u << last);
+    const std::ptrdiff_t width = static_cast<std::ptrdiff_t>(src.shape(last));
+    pool.parallel_ranges(rows.count(), [&](std::size_t begin, std::size_t end, std::size_t) {
+        Odometer<Rank> it = rows;
+        it.walk(begin, end, [&](const auto& at) {
+            const T* in = src.data() + src.offset(at);
+            T* out = dst.data() + dst.offset(at);
+            for (std::ptrdiff_t j = 0; j < width; ++j) out[j * dst.stride(last)] = in[j * src.stride(last)];
+        });
+    });
+}
+
+/**
+ * @brief Concatenation output with one pre-placed slot per producer
+ *
+ *   ConcatBuffer<float, 2> merged({batch, 0}, 1, {128, 128, 256});
+ *   gemm_nt(x, branch0.get_weights(), merged.slot(0));  // written in place
+ *   merged.copy_into(2, view(other_branch_output));     // fallback copy
+ *   TensorView<float, 2> out = merged.output();         // [batch, 512]
+ */
+template<typename T, std::size_t Rank>
+class ConcatBuffer {
+public:
+    using View = TensorView<T, Rank>;
+
+private:
+    std::size_t axis_;
+    std::vector<std::size_t> starts_;
+    std::vector<std::size_t> sizes_;
+    std::vector<T, nn_memory::TrackingAllocator<T>> storage_;
+    View output_;
+
+public:
+    // shape: the output shape with shape[axis] ignored (set to the sum of sizes)
+    ConcatBuffer(typename View::Shape shape, std::size_t axis, std::vector<std::size_t> sizes)
+        : axis_(axis), sizes_(std::move(sizes)),
+          storage_(nn_memory::TrackingAllocator<T>("ConcatBuffer", nn_memory::MemoryPurpose::Activations)) {
+        shape[axis_] = 0;
+        for (std::size_t size : sizes_) {
+            starts_.push_back(shape[axis_]);
+            shape[axis_] += size;
+        }
+        std::size_t total = 1;
+        for (std::size_t extent : shape) total *= extent;
+        storage_.resize(total);
+        output_ = View(storage_.data(), shape);
+    }
+
+    ConcatBuffer(const ConcatBuffer&) = delete;
+    ConcatBuffer& operator=(const ConcatBuffer&) = delete;
+
+    std::size_t num_slots() const { return sizes_.size(); }
+    std::size_t axis() const { return axis_; }
+
+    // Where producer i writes its part
+    View slot(std::size_t i) const { return output_.narrow(axis_, starts_[i], sizes_[i]); }
+
+    // Fallback for a producer that wrote elsewhere
+    void copy_into(std::size_t i, TensorView<const T, Rank> part, ThreadPool& pool = ThreadPool::global()) {
+        concat_into(slot(i), part, axis_, pool);
+    }
+
+    View output() const { return output_; }
+};
+
+/**
+ * @brief Copying concat of views along axis into a dense output
+ */
+template<typename T, std::size_t Rank>
+void concat(const std::vector<TensorView<const T, Rank>>& inputs, std::size_t axis, TensorView<T, Rank> output,
+            ThreadPool& pool = ThreadPool::global()) {
+    NN_PROFILE_ZONE("concat");
+    std::size_t start = 0;
+    for (const auto& input : inputs) {
+        concat_into(output.narrow(axis, start, input.shape(axis)), input, axis, pool);
+        start += input.shape(axis);
+    }
+}
@@ -0,0 +1,445 @@
+#pragma once
+
+#include "tensor.hpp"
+#include "fft.hpp"
+#include "gemm.hpp"
+#include "thread_pool.hpp"
+#include "memory_tracker.hpp"
+#include "profiler.hpp"
+#include "metrics.hpp"
+#include "autotune.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Convolution layers
+ *
+ * Conv1D is the framework convolution (a cross-correlation):
+ *   y[o][t] = bias[o] + sum_i sum_k w[o][i][k] * x[i][t + k]
+ * over zero-padded input. It runs one of two algorithms:
+ *   - direct: one task per (output channel, tile of outputs), the tile kept
+ *     in L1 and updated four taps per pass. Cost grows with Taps.
+ *   - FFT (overlap-save): the padded input is cut into blocks of n samples
+ *     that overlap by Taps - 1. Each block's channels are transformed once,
+ *     multiplied by the precomputed kernel spectra, summed over input
+ *     channels, and transformed back. The first n - Taps + 1 samples of the
+ *     result are exact outputs and the circular wrap lands in the rest. The
+ *     cost per output grows with log n only.
+ * Auto picks the FFT from fft_crossover_taps() on. The kernel spectra depend
+ * only on the weights; they are rebuilt on the first FFT forward after the
+ * weights were handed out for writing.
+ *
+ * Conv2D works on NHWC tensors as an implicit GEMM: output pixels are GEMM
+ * rows, output channels columns, and (kh, kw, c) the reduction, so OHWI
+ * weights are B as stored. The A operand, the im2col matrix, is KH * KW
+ * times the input and is never built: each GEMM tile gathers its patch
+ * slices from the input (one copy per kernel row inside the image, zeros
+ * in the padding) into the mc x kc block the micro-kernel reads as A.
+ */
+
+// Auto: modeled crossover; Tuned: timed once per shape and host (nn_autotune)
+enum class ConvAlgorithm { Auto, Direct, Fft, Tuned };
+
+namespace conv_detail {
+
+// Taps from which ConvAlgorithm::Auto takes the FFT path. Per output, direct
+// costs in * out * taps MACs, overlap-save about in + out transforms plus
+// in * out spectral products; the constants are fitted to benchmark_conv1d
+// (about 105 taps for 1 -> 1 channel, 30 for 4 -> 4, 11 for 16 -> 16)
+constexpr std::size_t fft_crossover_taps(std::size_t in, std::size_t out) {
+    return 5 + 50 * (in + out) / (in * out);
+}
+
+constexpr std::size_t min_fft_block = 1024;  // below this, per-transform overhead dominates
+constexpr std::size_t direct_tile = 512;  // outputs per direct task (L1 resident)
+
+// Modeled work of one overlap-save block of size n: transforms + spectral products
+inline double fft_block_flops(std::size_t in, std::size_t out, std::size_t n) {
+    return 2.5 * static_cast<double>((in + out) * n) * std::log2(static_cast<double>(n)) +
+           8.0 * static_cast<double>(in * out * (n / 2 + 1));
+}
+
+// Block size with the lowest modeled cost per exact output; a larger block
+// must win clearly, it also costs workspace
+inline std::size_t fft_block_size(std::size_t in, std::size_t out, std::size_t taps) {
+    const std::size_t smallest = std::max(min_fft_block, std::bit_ceil(2 * taps));
+    std::size_t best = smallest;
+    double best_cost = fft_block_flops(in, out, smallest) / static_cast<double>(smallest - taps + 1);
+    for (std::size_t n = 2 * smallest; n <= 16 * smallest; n *= 2) {
+        const double cost = fft_block_flops(in, out, n) / static_cast<double>(n - taps + 1);
+        if (cost < 0.95 * best_cost) {
+            best = n;
+            best_cost = cost;
+        }
+    }
+    return best;
+}
+
+// Per-thread buffers of one overlap-save block
+struct FftWorkspace {
+    std::vector<float> segment;
+    std::vector<float> input_re, input_im;  // [in][bins]
+    std::vector<float> acc_re, acc_im;      // [bins]
+};
+
+inline FftWorkspace& fft_workspace() {
+    static thread_local FftWorkspace ws;
+    return ws;
+}
+
+}  // namespace conv_detail
+
+/**
+ * @brief 1-D convolution over [InChannels, length] signals, zero padding of
+ * Padding samples on both sides, stride 1
+ */
+template<std::size_t InChannels, std::size_t OutChannels, std::size_t Taps, std::size_t Padding = 0>
+class Conv1D {
+    static_assert(Taps >= 1, "Conv1D needs at least one tap");
+
+public:
+    using Weights = Tensor<float, OutChannels, InChannels, Taps>;
+    using Bias = Tensor<float, OutChannels>;
+    static constexpr bool prefers_fft = Taps >= conv_detail::fft_crossover_taps(InChannels, OutChannels);
+
+private:
+    template<typename T>
+    using Buffer = std::vector<T, nn_memory::TrackingAllocator<T>>;
+
+    nn_memory::TrackedPtr<Weights> weights_;
+    nn_memory::TrackedPtr<Bias> bias_;
+    RealFft fft_;
+    Buffer<float> spectra_re_;  // [out][in][bins]: conj(FFT(w)) / n
+    Buffer<float> spectra_im_;
+    bool spectra_stale_ = true;
+    Buffer<float> padded_;
+
+    void update_spectra() {
+        NN_PROFILE_ZONE("Conv1D::update_spectra");
+        const std::size_t n = fft_.size(), bins = fft_.bins();
+        spectra_re_.resize(OutChannels * InChannels * bins);
+        spectra_im_.resize(OutChannels * InChannels * bins);
+        std::vector<float> kernel(n);
+        const float scale = 1.0f / static_cast<float>(n);
+        for (std::size_t oi = 0; oi < OutChannels * InChannels; ++oi) {
+            const float* w = weights_->data() + oi * Taps;
+            std::fill(std::copy(w, w + Taps, kernel.begin()), kernel.end(), 0.0f);
+            float* re = spectra_re_.data() + oi * bins;
+            float* im = spectra_im_.data() + oi * bins;
+            fft_.forward(kernel.data(), re, im);
+            for (std::size_t f = 0; f < bins; ++f) {
+                re[f] *= scale;
+                im[f] *= -scale;  // conjugate: correlation, not convolution
+            }
+        }
+        spectra_stale_ = false;
+    }
+
+    void forward_direct(const float* src, std::size_t length, float* output, ThreadPool& pool) const {
+        using conv_detail::direct_tile;
+        const std::size_t out_len = length - Taps + 1;
+        const std::size_t tiles = (out_len + direct_tile - 1) / direct_tile;
+        NN_METRICS_KERNEL("conv1d_direct", 2 * OutChannels * InChannels * Taps * out_len,
+                          sizeof(float) * (InChannels * length + OutChannels * out_len + Weights::total_size));
+        pool.parallel_for(OutChannels * tiles, [&](std::size_t task, std::size_t) {
+            const std::size_t o = task / tiles;
+            const std::size_t t0 = task % tiles * direct_tile;
+            const std::size_t count = std::min(direct_tile, out_len - t0);
+            float* y = output + o * out_len + t0;
+            std::fill(y, y + count, (*bias_)(o));
+            for (std::size_t i = 0; i < InChannels; ++i) {
+                const float* x = src + i * length + t0;
+                const float* w = weights_->data() + (o * InChannels + i) * Taps;
+                std::size_t k = 0;
+                for (; k + 4 <= Taps; k += 4) {
+                    const float w0 = w[k], w1 = w[k + 1], w2 = w[k + 2], w3 = w[k + 3];
+                    const float* xk = x + k;
+                    for (std::size_t t = 0; t < count; ++t) {
+                        y[t] += w0 * xk[t] + w1 * xk[t + 1] + w2 * xk[t + 2] + w3 * xk[t + 3];
+                    }
+                }
+                for (; k < Taps; ++k) {
+                    const float wk = w[k];
+                    for (std::size_t t = 0; t < count; ++t) y[t] += wk * x[t + k];
+                }
+            }
+        });
+    }
+
+    void forward_fft(const float* src, std::size_t length, float* output, ThreadPool& pool) {
+        if (spectra_stale_) update_spectra();
+        const std::size_t n = fft_.size(), bins = fft_.bins();
+        const std::size_t hop = n - Taps + 1;  // exact outputs per block
+        const std::size_t out_len = length - Taps + 1;
+        const std::size_t blocks = (out_len + hop - 1) / hop;
+        NN_METRICS_KERNEL("conv1d_fft", blocks * conv_detail::fft_block_flops(InChannels, OutChannels, n),
+                          sizeof(float) * (InChannels * length + OutChannels * out_len + 2 * spectra_re_.size()));
+        pool.parallel_for(blocks, [&](std::size_t b, std::size_t) {
+            conv_detail::FftWorkspace& ws = conv_detail::fft_workspace();
+            ws.segment.resize(n);
+            ws.input_re.resize(InChannels * bins);
+            ws.input_im.resize(InChannels * bins);
+            ws.acc_re.resize(bins);
+            ws.acc_im.resize(bins);
+
+            const std::size_t t0 = b * hop;
+            const std::size_t available = std::min(n, length - t0);
+            for (std::size_t i = 0; i < InChannels; ++i) {
+                const float* x = src + i * length + t0;
+                std::fill(std::copy(x, x + available, ws.segment.begin()), ws.segment.end(), 0.0f);
+                fft_.forward(ws.segment.data(), ws.input_re.data() + i * bins, ws.input_im.data() + i * bins);
+            }
+
+            const std::size_t count = std::min(hop, out_len - t0);
+            for (std::size_t o = 0; o < OutChannels; ++o) {
+                float* acc_re = ws.acc_re.data();
+                float* acc_im = ws.acc_im.data();
+                std::fill(acc_re, acc_re + bins, 0.0f);
+                std::fill(acc_im, acc_im + bins, 0.0f);
+                for (std::size_t i = 0; i < InChannels; ++i) {
+                    const float* xr = ws.input_re.data() + i * bins;
+                    const float* xi = ws.input_im.data() + i * bins;
+                    const float* wr = spectra_re_.data() + (o * InChannels + i) * bins;
+                    const float* wi = spectra_im_.data() + (o * InChannels + i) * bins;
+                    for (std::size_t f = 0; f < bins; ++f) {
+                        acc_re[f] += xr[f] * wr[f] - xi[f] * wi[f];
+                        acc_im[f] += xr[f] * wi[f] + xi[f] * wr[f];
+                    }
+                }
+                fft_.inverse(acc_re, acc_im, ws.segment.data());
+                float* y = output + o * out_len + t0;
+                const float bias = (*bias_)(o);
+                for (std::size_t t = 0; t < count; ++t) y[t] = ws.segment[t] + bias;
+            }
+        });
+    }
+
+public:
+    Conv1D()
+        : fft_(conv_detail::fft_block_size(InChannels, OutChannels, Taps)),
+          spectra_re_(nn_memory::TrackingAllocator<float>("Conv1D", nn_memory::MemoryPurpose::Weights)),
+          spectra_im_(spectra_re_.get_allocator()),
+          padded_(nn_memory::TrackingAllocator<float>("Conv1D", nn_memory::MemoryPurpose::Activations)) {
+        nn_memory::MemoryOwnerScope owner("Conv1D");
+        weights_ = nn_memory::make_tracked<Weights>(nn_memory::MemoryPurpose::Weights);
+        bias_ = nn_memory::make_tracked<Bias>(nn_memory::MemoryPurpose::Weights);
+    }
+
+    // Writable access invalidates the kernel spectra
+    Weights& get_weights() {
+        spectra_stale_ = true;
+        return *weights_;
+    }
+    const Weights& get_weights() const { return *weights_; }
+    Bias& get_bias() { return *bias_; }
+    const Bias& get_bias() const { return *bias_; }
+
+    // Overlap-save block size of the FFT path
+    std::size_t fft_size() const { return fft_.size(); }
+
+    static constexpr std::size_t output_length(std::size_t length) { return length + 2 * Padding - Taps + 1; }
+
+    /**
+     * @brief input [InChannels, length] -> output [OutChannels, output_length(length)]
+     *
+     * length + 2 * Padding must be at least Taps.
+     */
+    void forward(const float* input, std::size_t length, float* output, ConvAlgorithm algorithm = ConvAlgorithm::Auto,
+                 ThreadPool& pool = ThreadPool::global()) {
+        NN_PROFILE_ZONE("Conv1D::forward");
+        const std::size_t padded = length + 2 * Padding;
+        if (padded < Taps) return;
+        const float* src = input;
+        if constexpr (Padding > 0) {
+            padded_.assign(InChannels * padded, 0.0f);
+            for (std::size_t i = 0; i < InChannels; ++i) {
+                std::copy(input + i * length, input + (i + 1) * length, padded_.data() + i * padded + Padding);
+            }
+            src = padded_.data();
+        }
+        bool fft = algorithm == ConvAlgorithm::Fft || (algorithm == ConvAlgorithm::Auto && prefers_fft);
+        if (algorithm == ConvAlgorithm::Tuned) {
+            const std::size_t extents[] = {InChannels, OutChannels, Taps, padded, pool.size()};
+            fft = nn_autotune::select("conv1d", nn_autotune::shape_key(extents),
+                                      {{"direct", [&] { forward_direct(src, padded, output, pool); }},
+                                       {"fft", [&] { forward_fft(src, padded, output, pool); }}}) == 1;
+        }
+        if (fft) {
+            forward_fft(src, padded, output, pool);
+        } else {
+            forward_direct(src, padded, output, pool);
+        }
+    }
+
+    template<std::size_t Length>
+    Tensor<float, OutChannels, output_length(Length)> forward(const Tensor<float, InChannels, Length>& input,
+                                                              ThreadPool& pool = ThreadPool::global()) {
+        Tensor<float, OutChannels, output_length(Length)> output;
+        forward(input.data(), Length, output.data(), ConvAlgorithm::Auto, pool);
+        return output;
+    }
+};
+
+namespace conv_detail {
+
+struct Geometry {
+    std::size_t height, width, out_height, out_width;
+};
+
+// Kernel geometry fixed at compile time (Conv2D) ...
+template<std::size_t InChannels, std::size_t KernelH, std::size_t KernelW, std::size_t Stride, std::size_t Padding>
+struct StaticPatch {
+    static constexpr std::size_t channels = InChannels;
+    static constexpr std::size_t kernel_h = KernelH;
+    static constexpr std::size_t kernel_w = KernelW;
+    static constexpr std::size_t stride = Stride;
+    static constexpr std::size_t padding = Padding;
+};
+
+// ... or known only at run time (graph executor)
+struct DynamicPatch {
+    std::size_t channels, kernel_h, kernel_w, stride, padding;
+};
+
+/**
+ * @brief Patch of output pixel `pixel` of an NHWC input, elements
+ * [k0, k0 + depth) in (kh, kw, c) order, converted to Dst
+ *
+ * One copy per kernel row inside the image; positions in the padding read
+ * as `pad` (0, or the zero point of quantized input).
+ */
+template<typename Patch, typename Src, typename Dst>
+void gather_patch(const Patch& patch, const Src* input, const Geometry& g, std::size_t pixel, std::size_t k0,
+                  std::size_t depth, Dst* dst, Dst pad) {
+    const std::size_t channels = patch.channels;
+    const std::size_t row = patch.kernel_w * channels;  // one kernel row: contiguous in NHWC
+    const std::size_t ow = pixel % g.out_width;
+    const std::size_t oh = pixel / g.out_width % g.out_height;
+    const std::size_t n = pixel / (g.out_width * g.out_height);
+    const auto padding = static_cast<std::ptrdiff_t>(patch.padding);
+    const std::ptrdiff_t ih0 = static_cast<std::ptrdiff_t>(oh * patch.stride) - padding;
+    const std::ptrdiff_t iw0 = static_cast<std::ptrdiff_t>(ow * patch.stride) - padding;
+    const bool columns_inside =
+        iw0 >= 0 && iw0 + static_cast<std::ptrdiff_t>(patch.kernel_w) <= static_cast<std::ptrdiff_t>(g.width);
+    for (std::size_t k = k0, end = k0 + depth; k < end;) {
+        const std::size_t kh = k / row, within = k % row;
+        const std::size_t run = std::min(row - within, end - k);
+        const std::ptrdiff_t ih = ih0 + static_cast<std::ptrdiff_t>(kh);
+        if (ih < 0 || ih >= static_cast<std::ptrdiff_t>(g.height)) {
+            std::fill(dst, dst + run, pad);
+        } else {
+            const Src* line = input + ((n * g.height + static_cast<std::size_t>(ih)) * g.width) * channels;
+            if (columns_inside) {
+                const Src* src = line + static_cast<std::size_t>(iw0) * channels + within;
+                std::copy(src, src + run, dst);
+            } else {
+                for (std::size_t j = 0; j < run; ++j) {
+                    const std::ptrdiff_t iw = iw0 + static_cast<std::ptrdiff_t>((within + j) / channels);
+                    dst[j] = iw < 0 || iw >= static_cast<std::ptrdiff_t>(g.width)
+                                 ? pad
+                                 : static_cast<Dst>(line[static_cast<std::size_t>(iw) * channels +
+                                                         (within + j) % channels]);
+                }
+            }
+        }
+        dst += run;
+        k += run;
+    }
+}
+
+/**
+ * @brief Float implicit-GEMM convolution: output [pixels, out_channels] =
+ * patches x weights^T + bias, with OHWI weights as the B operand
+ */
+template<typename Patch>
+void conv2d_implicit_gemm(const Patch& patch, const float* input, std::size_t batch, const Geometry& g,
+                          const float* weights, const float* bias, std::size_t out_channels, float* output,
+                          ThreadPool& pool) {
+    using namespace gemm_detail;
+    const std::size_t patch_size = patch.kernel_h * patch.kernel_w * patch.channels;  // GEMM K
+    const std::size_t pixels = batch * g.out_height * g.out_width;                     // GEMM M
+    NN_METRICS_KERNEL("conv2d", 2 * pixels * out_channels * patch_size,
+                      sizeof(float) * (batch * g.height * g.width * patch.channels + out_channels * patch_size +
+                                       pixels * out_channels));
+
+    const std::size_t row_tiles = (pixels + mc - 1) / mc;
+    const std::size_t col_tiles = (out_channels + nc - 1) / nc;
+    pool.parallel_for(row_tiles * col_tiles, [&](std::size_t t, std::size_t) {
+        const std::size_t m0 = t / col_tiles * mc, n0 = t % col_tiles * nc;
+        const std::size_t rows = std::min(mc, pixels - m0);
+        const std::size_t cols = std::min(nc, out_channels - n0);
+        float* c = output + m0 * out_channels;
+        for (std::size_t r = 0; r < rows; ++r) std::copy(bias + n0, bias + n0 + cols, c + r * out_channels + n0);
+        run_tile_gathered(
+            rows, cols, patch_size,
+            [&](std::size_t r, std::size_t k0, std::size_t depth, float* dst) {
+                gather_patch(patch, input, g, m0 + r, k0, depth, dst, 0.0f);
+            },
+            weights, patch_size, n0, c, out_channels);
+    });
+}
+
+}  // namespace conv_detail
+
+/**
+ * @brief 2-D convolution over NHWC input, OHWI weights, NHWC output
+ */
+template<std::size_t InChannels, std::size_t OutChannels, std::size_t KernelH, std::size_t KernelW,
+         std::size_t Stride = 1, std::size_t Padding = 0>
+class Conv2D {
+    static_assert(KernelH >= 1 && KernelW >= 1 && Stride >= 1, "Conv2D needs a non-empty kernel and stride");
+
+public:
+    using Weights = Tensor<float, OutChannels, KernelH, KernelW, InChannels>;
+    using Bias = Tensor<float, OutChannels>;
+    using Patch = conv_detail::StaticPatch<InChannels, KernelH, KernelW, Stride, Padding>;
+    static constexpr std::size_t patch_size = KernelH * KernelW * InChannels;  // GEMM K
+
+private:
+    nn_memory::TrackedPtr<Weights> weights_;
+    nn_memory::TrackedPtr<Bias> bias_;
+
+public:
+    Conv2D() {
+        nn_memory::MemoryOwnerScope owner("Conv2D");
+        weights_ = nn_memory::make_tracked<Weights>(nn_memory::MemoryPurpose::Weights);
+        bias_ = nn_memory::make_tracked<Bias>(nn_memory::MemoryPurpose::Weights);
+    }
+
+    Weights& get_weights() { return *weights_; }
+    const Weights& get_weights() const { return *weights_; }
+    Bias& get_bias() { return *bias_; }
+    const Bias& get_bias() const { return *bias_; }
+
+    static constexpr std::size_t output_height(std::size_t height) {
+        return (height + 2 * Padding - KernelH) / Stride + 1;
+    }
+    static constexpr std::size_t output_width(std::size_t width) {
+        return (width + 2 * Padding - KernelW) / Stride + 1;
+    }
+
+    /**
+     * @brief input [batch, height, width, InChannels] ->
+     * output [batch, output_height(height), output_width(width), OutChannels]
+     */
+    void forward(const float* input, std::size_t batch, std::size_t height, std::size_t width, float* output,
+                 ThreadPool& pool = ThreadPool::global()) const {
+        NN_PROFILE_ZONE("Conv2D::forward");
+        if (height + 2 * Padding < KernelH || width + 2 * Padding < KernelW) return;
+        const conv_detail::Geometry g{height, width, output_height(height), output_width(width)};
+        conv_detail::conv2d_implicit_gemm(Patch{}, input, batch, g, weights_->data(), bias_->data(), OutChannels,
+                                          output, pool);
+    }
+
+    template<std::size_t Batch, std::size_t Height, std::size_t Width>
+    Tensor<float, Batch, output_height(Height), output_width(Width), OutChannels> forward(
+        const Tensor<float, Batch, Height, Width, InChannels>& input, ThreadPool& pool = ThreadPool::global()) const {
+        Tensor<float, Batch, output_height(Height), output_width(Width), OutChannels> output;
+        forward(input.data(), Batch, Height, Width, output.data(), pool);
+        return output;
+    }
+};
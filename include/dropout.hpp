@@ -0,0 +1,192 @@
+#pragma once
+
+#include "tensor.hpp"
+#include "expression_template.hpp"
+#include "nn_compiler.hpp"
+#include "random.hpp"
+#include "profiler.hpp"
+#include "metrics.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Dropout with on-the-fly mask regeneration
+ *
+ * The keep/drop decision of element i is a pure function of (seed, stream,
+ * offset, i) through the counter-based Philox generator, so no mask tensor is
+ * ever stored: forward draws it inside the element-wise loop and backward
+ * draws the identical mask again. DropoutExpression plugs this into the
+ * expression templates; LinearDropoutLayer fuses it into the LinearLayer
+ * epilogue, where dropped outputs also skip their dot product.
+ */
+
+/**
+ * @brief Inverted-dropout mask: keep with probability 1 - p, scale by 1 / (1 - p)
+ */
+class DropoutMask {
+private:
+    nn_random::Philox rng_;
+    std::uint64_t offset_;
+    std::uint64_t threshold_;
+    float scale_;
+
+public:
+    DropoutMask(nn_random::Philox rng, float drop_prob, std::uint64_t offset = 0)
+        : rng_(rng), offset_(offset),
+          threshold_(static_cast<std::uint64_t>((1.0 - static_cast<double>(drop_prob)) * 4294967296.0)),
+          scale_(drop_prob < 1.0f ? 1.0f / (1.0f - drop_prob) : 0.0f) {}
+
+    float scale() const { return scale_; }
+
+    bool keep(std::size_t index) const { return rng_.word(index, offset_) < threshold_; }
+
+    // f(keep, index) for index in [begin, end), on the vectorized batch path
+    template<typename F>
+    void for_each(std::size_t begin, std::size_t end, F&& f) const {
+        rng_.for_each_word(begin, end, offset_, [&](std::uint32_t w, std::size_t i) { f(w < threshold_, i); });
+    }
+
+    // Mask of the `sample`-th row of a batch whose rows have `row_size` elements
+    DropoutMask row(std::size_t sample, std::size_t row_size) const {
+        DropoutMask mask = *this;
+        mask.offset_ += sample * ((row_size + 3) / 4);
+        return mask;
+    }
+};
+
+/**
+ * @brief Expression node: expr * mask, with the mask drawn per element
+ *
+ * Dims is the shape the expression is indexed with (for the flat element id).
+ */
+template<typename Expr, std::size_t... Dims>
+class DropoutExpression : public ExpressionBase<DropoutExpression<Expr, Dims...>> {
+private:
+    static constexpr std::array<std::size_t, sizeof...(Dims)> shape = {Dims...};
+
+    Expr expr_;
+    DropoutMask mask_;
+
+    template<typename... Args>
+    static constexpr std::size_t flat_index(Args... args) {
+        std::array<std::size_t, sizeof...(Dims)> indices = {static_cast<std::size_t>(args)...};
+        std::size_t index = 0;
+        for (std::size_t i = 0; i < sizeof...(Dims); ++i) index = index * shape[i] + indices[i];
+        return index;
+    }
+
+public:
+    DropoutExpression(const Expr& expr, const DropoutMask& mask) : expr_(expr), mask_(mask) {}
+
+    template<std::size_t... Indices>
+    auto eval() const {
+        auto value = expr_.template eval<Indices...>();
+        return mask_.keep(flat_index(Indices...)) ? value * mask_.scale() : decltype(value)(0);
+    }
+
+    template<typename... Args>
+    auto operator()(Args... args) const {
+        static_assert(sizeof...(Args) == sizeof...(Dims), "Number of indices must match dropout shape");
+        auto value = expr_(args...);
+        return mask_.keep(flat_index(args...)) ? value * mask_.scale() : decltype(value)(0);
+    }
+};
+
+// dropout<2, 3>(expr_a + expr_b, mask)
+template<std::size_t... Dims, typename Expr>
+auto dropout(const ExpressionBase<Expr>& expression, const DropoutMask& mask) {
+    return DropoutExpression<Expr, Dims...>(expression.derived(), mask);
+}
+
+// Materialize dropout(x) in one fused pass
+template<typename T, std::size_t... Dims>
+Tensor<T, Dims...> dropout(const Tensor<T, Dims...>& input, const DropoutMask& mask) {
+    Tensor<T, Dims...> output;
+    const T scale = static_cast<T>(mask.scale());
+    mask.for_each(0, input.size(), [&](bool keep, std::size_t i) {
+        output.data()[i] = keep ? input.data()[i] * scale : T(0);
+    });
+    return output;
+}
+
+/**
+ * @brief LinearLayer followed by dropout, fused in the output epilogue
+ *
+ * select_mask(step, sample) picks the mask of one sample of one training
+ * step; backward must see the same selection as the matching forward. With
+ * training(false) the layer is a plain LinearLayer.
+ */
+template<typename T, std::size_t InSize, std::size_t OutSize>
+class LinearDropoutLayer : public Layer<Tensor<T, InSize>, Tensor<T, OutSize>> {
+public:
+    using Gradients = LinearGradients<T, InSize, OutSize>;
+
+private:
+    LinearLayer<T, InSize, OutSize> linear_;
+    nn_random::Philox rng_;
+    float drop_prob_;
+    DropoutMask mask_;
+    bool training_ = true;
+
+    T row_dot(const Tensor<T, InSize>& input, std::size_t i) const {
+        const T* w = linear_.get_weights().data() + i * InSize;
+        T sum = T(0);
+        for (std::size_t j = 0; j < InSize; ++j) sum += input(j) * w[j];
+        return sum + linear_.get_bias()(i);
+    }
+
+public:
+    explicit LinearDropoutLayer(float drop_prob, std::uint64_t seed = 0)
+        : rng_(seed), drop_prob_(drop_prob), mask_(rng_, drop_prob) {}
+
+    void training(bool enabled) { training_ = enabled; }
+    bool is_training() const { return training_; }
+
+    void select_mask(std::uint64_t step, std::size_t sample) {
+        mask_ = DropoutMask(rng_.substream(step), drop_prob_).row(sample, OutSize);
+    }
+
+    const DropoutMask& mask() const { return mask_; }
+
+    Tensor<T, OutSize> forward(const Tensor<T, InSize>& input) const override {
+        if (!training_) return linear_.forward(input);
+        NN_PROFILE_ZONE("LinearDropoutLayer::forward");
+        NN_METRICS_KERNEL("linear_dropout", 2 * InSize * OutSize + OutSize,
+                          sizeof(T) * (OutSize * InSize + InSize + 2 * OutSize));
+        Tensor<T, OutSize> output;
+        const T scale = static_cast<T>(mask_.scale());
+        mask_.for_each(0, OutSize, [&](bool keep, std::size_t i) {
+            output(i) = keep ? row_dot(input, i) * scale : T(0);
+        });
+        return output;
+    }
+
+    // Regenerates the forward mask; dropped outputs contribute no gradient
+    Tensor<T, InSize> backward(const Tensor<T, InSize>& input, const Tensor<T, OutSize>& grad_output,
+                               Gradients& grads) const {
+        if (!training_) return linear_.backward(input, grad_output, grads);
+        NN_PROFILE_ZONE("LinearDropoutLayer::backward");
+        NN_METRICS_KERNEL("linear_dropout_backward", 4 * InSize * OutSize + OutSize,
+                          sizeof(T) * (3 * OutSize * InSize + 2 * InSize + 2 * OutSize));
+        Tensor<T, InSize> grad_input;
+        const T scale = static_cast<T>(mask_.scale());
+        mask_.for_each(0, OutSize, [&](bool keep, std::size_t i) {
+            if (!keep) return;
+            const T g = grad_output(i) * scale;
+            T* gw = grads.weights.data() + i * InSize;
+            const T* w = linear_.get_weights().data() + i * InSize;
+            for (std::size_t j = 0; j < InSize; ++j) {
+                gw[j] += g * input(j);
+                grad_input(j) += g * w[j];
+            }
+            grads.bias(i) += g;
+        });
+        return grad_input;
+    }
+
+    void sgd_update(const Gradients& grads, T learning_rate) { linear_.sgd_update(grads, learning_rate); }
+
+    auto& linear() { return linear_; }
+    const auto& linear() const { return linear_; }
+};
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <numbers>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Real-input FFT of power-of-two size
+ *
+ * A real transform of size n runs as a complex transform of size n / 2 on
+ * the even / odd samples packed as re / im, followed by one twiddle pass
+ * that separates the two spectra. The complex transform is a Stockham
+ * autosort FFT (no bit-reversal pass) on split re / im arrays: radix-4
+ * stages, plus one radix-2 stage when log2(n / 2) is odd. Each stage
+ * ping-pongs between two buffers and keeps its innermost loop over
+ * contiguous elements, so the butterflies vectorize. Twiddles for every
+ * stage are computed once, in double precision, when the plan is built.
+ *
+ * Spectra hold the n / 2 + 1 non-negative frequency bins. The inverse is
+ * unnormalized: inverse(forward(x)) == n * x.
+ */
+
+namespace fft_detail {
+
+struct Stage {
+    std::size_t radix;
+    std::size_t length;   // sub-transform length n of this stage
+    std::size_t stride;   // s: number of interleaved sub-transforms
+    std::size_t twiddle;  // offset of this stage's tables (radix - 1 rows of n / radix)
+};
+
+// One pass over all sub-transforms: x -> y
+inline void radix2(const Stage& st, const float* tr, const float* ti, const float* __restrict xr,
+                   const float* __restrict xi, float* __restrict yr, float* __restrict yi) {
+    const std::size_t m = st.length / 2, s = st.stride;
+    for (std::size_t p = 0; p < m; ++p) {
+        const float wr = tr[p], wi = ti[p];
+        for (std::size_t q = 0; q < s; ++q) {
+            const float ar = xr[q + s * p], ai = xi[q + s * p];
+            const float br = xr[q + s * (p + m)], bi = xi[q + s * (p + m)];
+            const float dr = ar - br, di = ai - bi;
+            yr[q + s * 2 * p] = ar + br;
+            yi[q + s * 2 * p] = ai + bi;
+            yr[q + s * (2 * p + 1)] = dr * wr - di * wi;
+            yi[q + s * (2 * p + 1)] = dr * wi + di * wr;
+        }
+    }
+}
+
+#if defined(__GNUC__)
+// GCC leaves the q loop scalar (too many streams to prove disjoint), so the
+// butterflies are also instantiated on vector-extension registers
+typedef float vfloat __attribute__((vector_size(16)));
+constexpr std::size_t lanes = sizeof(vfloat) / sizeof(float);
+
+template<typename V>
+inline V load(const float* p) {
+    V v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+template<typename V>
+inline void store(float* p, V v) {
+    std::memcpy(p, &v, sizeof(v));
+}
+#else
+template<typename V>
+inline V load(const float* p) {
+    return *p;
+}
+
+template<typename V>
+inline void store(float* p, V v) {
+    *p = v;
+}
+#endif
+
+// Forward radix-4 butterfly: inputs at in + {0, 1, 2, 3} * step, outputs at
+// out + {0, 1, 2, 3} * s; output r takes twiddle w_r = w^(r p)
+template<typename V>
+inline void butterfly4(const float* xr, const float* xi, std::size_t in, std::size_t step, float* yr, float* yi,
+                       std::size_t out, std::size_t s, const float (&w)[6]) {
+    const V ar = load<V>(xr + in), ai = load<V>(xi + in);
+    const V br = load<V>(xr + in + step), bi = load<V>(xi + in + step);
+    const V cr = load<V>(xr + in + 2 * step), ci = load<V>(xi + in + 2 * step);
+    const V dr = load<V>(xr + in + 3 * step), di = load<V>(xi + in + 3 * step);
+    const V apc_r = ar + cr, apc_i = ai + ci;
+    const V amc_r = ar - cr, amc_i = ai - ci;
+    const V bpd_r = br + dr, bpd_i = bi + di;
+    const V jbmd_r = bi - di, jbmd_i = dr - br;  // -i * (b - d)
+    const V u1r = amc_r + jbmd_r, u1i = amc_i + jbmd_i;
+    const V u2r = apc_r - bpd_r, u2i = apc_i - bpd_i;
+    const V u3r = amc_r - jbmd_r, u3i = amc_i - jbmd_i;
+    store<V>(yr + out, apc_r + bpd_r);
+    store<V>(yi + out, apc_i + bpd_i);
+    store<V>(yr + out + s, u1r * w[0] - u1i * w[1]);
+    store<V>(yi + out + s, u1r * w[1] + u1i * w[0]);
+    store<V>(yr + out + 2 * s, u2r * w[2] - u2i * w[3]);
+    store<V>(yi + out + 2 * s, u2r * w[3] + u2i * w[2]);
+    store<V>(yr + out + 3 * s, u3r * w[4] - u3i * w[5]);
+    store<V>(yi + out + 3 * s, u3r * w[5] + u3i * w[4]);
+}
+
+inline void radix4(const Stage& st, const float* tr, const float* ti, const float* xr, const float* xi,
+                   float* yr, float* yi) {
+    const std::size_t m = st.length / 4, s = st.stride;
+    for (std::size_t p = 0; p < m; ++p) {
+        const float w[6] = {tr[p], ti[p], tr[p + m], ti[p + m], tr[p + 2 * m], ti[p + 2 * m]};
+        std::size_t q = 0;
+#if defined(__GNUC__)
+        for (; q + lanes <= s; q += lanes) butterfly4<vfloat>(xr, xi, q + s * p, s * m, yr, yi, q + 4 * s * p, s, w);
+#endif
+        for (; q < s; ++q) butterfly4<float>(xr, xi, q + s * p, s * m, yr, yi, q + 4 * s * p, s, w);
+    }
+}
+
+inline std::vector<float>& scratch(std::size_t n) {
+    static thread_local std::vector<float> buffer;
+    if (buffer.size() < n) buffer.resize(n);
+    return buffer;
+}
+
+}  // namespace fft_detail
+
+class RealFft {
+private:
+    std::size_t size_ = 0;
+    std::size_t half_ = 0;
+    std::vector<fft_detail::Stage> stages_;
+    std::vector<float> twiddle_re_, twiddle_im_;
+    std::vector<float> post_re_, post_im_;  // exp(-2 pi i k / n), k in [0, n / 2]
+
+    // Forward complex FFT of size half_ in place on (re, im), using (tmp_re, tmp_im)
+    void complex_forward(float* re, float* im, float* tmp_re, float* tmp_im) const {
+        float *xr = re, *xi = im, *yr = tmp_re, *yi = tmp_im;
+        for (const auto& st : stages_) {
+            const float* tr = twiddle_re_.data() + st.twiddle;
+            const float* ti = twiddle_im_.data() + st.twiddle;
+            if (st.radix == 4) {
+                fft_detail::radix4(st, tr, ti, xr, xi, yr, yi);
+            } else {
+                fft_detail::radix2(st, tr, ti, xr, xi, yr, yi);
+            }
+            std::swap(xr, yr);
+            std::swap(xi, yi);
+        }
+        if (xr != re) {
+            std::copy(xr, xr + half_, re);
+            std::copy(xi, xi + half_, im);
+        }
+    }
+
+public:
+    // size: a power of two, at least 4
+    explicit RealFft(std::size_t size) : size_(size), half_(size / 2) {
+        constexpr double two_pi = 2.0 * std::numbers::pi;
+        std::size_t length = half_, stride = 1;
+        while (length > 1) {
+            // One radix-2 stage up front when log2(n / 2) is odd, radix-4 after
+            const std::size_t radix = stride == 1 && std::countr_zero(half_) % 2 == 1 ? 2 : 4;
+            const std::size_t m = length / radix;
+            stages_.push_back({radix, length, stride, twiddle_re_.size()});
+            for (std::size_t r = 1; r < radix; ++r) {
+                for (std::size_t p = 0; p < m; ++p) {
+                    const double angle = -two_pi * static_cast<double>(r * p) / static_cast<double>(length);
+                    twiddle_re_.push_back(static_cast<float>(std::cos(angle)));
+                    twiddle_im_.push_back(static_cast<float>(std::sin(angle)));
+                }
+            }
+            length = m;
+            stride *= radix;
+        }
+        for (std::size_t k = 0; k <= half_; ++k) {
+            const double angle = -two_pi * static_cast<double>(k) / static_cast<double>(size_);
+            post_re_.push_back(static_cast<float>(std::cos(angle)));
+            post_im_.push_back(static_cast<float>(std::sin(angle)));
+        }
+    }
+
+    std::size_t size() const { return size_; }
+    std::size_t bins() const { return half_ + 1; }
+
+    // x[size] -> re[bins], im[bins]
+    void forward(const float* x, float* re, float* im) const {
+        auto& buffer = fft_detail::scratch(4 * half_);
+        float* zr = buffer.data();
+        float* zi = zr + half_;
+        for (std::size_t j = 0; j < half_; ++j) {
+            zr[j] = x[2 * j];
+            zi[j] = x[2 * j + 1];
+        }
+        complex_forward(zr, zi, zi + half_, zi + 2 * half_);
+
+        // Z = FFT(even) + i FFT(odd): E = (Z[k] + conj Z[-k]) / 2, O = (Z[k] - conj Z[-k]) / 2i
+        for (std::size_t k = 0; k <= half_; ++k) {
+            const std::size_t a = k == half_ ? 0 : k;
+            const std::size_t b = k == 0 ? 0 : half_ - k;
+            const float er = 0.5f * (zr[a] + zr[b]), ei = 0.5f * (zi[a] - zi[b]);
+            const float or_ = 0.5f * (zi[a] + zi[b]), oi = -0.5f * (zr[a] - zr[b]);
+            re[k] = er + or_ * post_re_[k] - oi * post_im_[k];
+            im[k] = ei + or_ * post_im_[k] + oi * post_re_[k];
+        }
+    }
+
+    // re[bins], im[bins] -> x[size], scaled by size()
+    void inverse(const float* re, const float* im, float* x) const {
+        auto& buffer = fft_detail::scratch(4 * half_);
+        float* zr = buffer.data();
+        float* zi = zr + half_;
+        // 2E = X[k] + conj X[n/2 - k], 2O = (X[k] - conj X[n/2 - k]) / w^k, Z = 2E + 2iO;
+        // the complex inverse runs as a forward FFT with re and im swapped
+        for (std::size_t k = 0; k < half_; ++k) {
+            const std::size_t b = half_ - k;
+            const float er = re[k] + re[b], ei = im[k] - im[b];
+            const float dr = re[k] - re[b], di = im[k] + im[b];
+            const float or_ = dr * post_re_[k] + di * post_im_[k];
+            const float oi = di * post_re_[k] - dr * post_im_[k];
+            zr[k] = er - oi;
+            zi[k] = ei + or_;
+        }
+        complex_forward(zi, zr, zi + half_, zi + 2 * half_);
+        for (std::size_t j = 0; j < half_; ++j) {
+            x[2 * j] = zr[j];
+            x[2 * j + 1] = zi[j];
+        }
+    }
+};
@@ -0,0 +1,236 @@
+#pragma once
+
+#include "thread_pool.hpp"
+#include "tensor_view.hpp"
+#include "profiler.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief Packed, cache-blocked single-precision GEMM: C = A * B^T (+ bias)
+ *
+ * A is [M, K] and B is [N, K], both row-major, i.e. B has the layout of
+ * LinearLayer weights ([Out, In]), so C rows are layer outputs. Work is cut
+ * into tiles of mc rows x nc columns. A tile packs each kc-deep slice of its
+ * B columns k-major into a thread-local buffer and runs an mr x nr
+ * register-blocked micro-kernel over it: per k, one broadcast of A times two
+ * vector registers of the packed panel per row. Tiles are claimed
+ * dynamically from the thread pool; grouped_gemm() puts the tiles of many
+ * independent problems (e.g. MoE experts) into one launch. For an A that is
+ * computed rather than stored (convolution patches), run_tile_gathered()
+ * gathers one mc x kc block at a time for the same micro-kernel.
+ */
+
+namespace gemm_detail {
+
+#ifdef __AVX__
+constexpr std::size_t vec_bytes = 32;
+#else
+constexpr std::size_t vec_bytes = 16;
+#endif
+constexpr std::size_t vec_lanes = vec_bytes / sizeof(float);
+constexpr std::size_t nr = 2 * vec_lanes;  // two vector registers per accumulator row
+constexpr std::size_t mr = 4;
+constexpr std::size_t kc = 256;
+constexpr std::size_t nc = 64;
+constexpr std::size_t mc = 128;
+
+// Pack B rows [n0, n0 + cols) x depth [k0, k0 + depth) as depth x nr panels
+inline void pack_b(const float* b, std::size_t ldb, std::size_t n0, std::size_t cols,
+                   std::size_t k0, std::size_t depth, float* packed) {
+    for (std::size_t p = 0; p < cols; p += nr) {
+        const std::size_t width = std::min(nr, cols - p);
+        float* panel = packed + p * depth;
+        for (std::size_t k = 0; k < depth; ++k) {
+            std::size_t j = 0;
+            for (; j < width; ++j) panel[k * nr + j] = b[(n0 + p + j) * ldb + k0 + k];
+            for (; j < nr; ++j) panel[k * nr + j] = 0.0f;
+        }
+    }
+}
+
+#if defined(__GNUC__)
+// Left to itself GCC vectorizes the k loop (with transposes) instead of the
+// nr-wide rows, so the accumulators are spelled as vector-extension registers
+typedef float vfloat __attribute__((vector_size(vec_bytes)));
+
+inline vfloat load(const float* p) {
+    vfloat v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// c[MR x cols] += a[MR x depth] * panel; cols <= nr
+template<std::size_t MR>
+inline void micro_kernel(std::size_t depth, const float* a, std::size_t lda, const float* panel,
+                         float* c, std::size_t ldc, std::size_t cols) {
+    vfloat acc[MR][2] = {};
+    for (std::size_t k = 0; k < depth; ++k) {
+        const vfloat b0 = load(panel + k * nr);
+        const vfloat b1 = load(panel + k * nr + vec_lanes);
+        for (std::size_t r = 0; r < MR; ++r) {
+            const vfloat av = vfloat{} + a[r * lda + k];
+            acc[r][0] += av * b0;
+            acc[r][1] += av * b1;
+        }
+    }
+    for (std::size_t r = 0; r < MR; ++r) {
+        float row[nr];
+        std::memcpy(row, acc[r], sizeof(row));
+        for (std::size_t j = 0; j < cols; ++j) c[r * ldc + j] += row[j];
+    }
+}
+#else
+template<std::size_t MR>
+inline void micro_kernel(std::size_t depth, const float* a, std::size_t lda, const float* panel,
+                         float* c, std::size_t ldc, std::size_t cols) {
+    float acc[MR][nr] = {};
+    for (std::size_t k = 0; k < depth; ++k) {
+        const float* bk = panel + k * nr;
+        for (std::size_t r = 0; r < MR; ++r) {
+            const float av = a[r * lda + k];
+            for (std::size_t j = 0; j < nr; ++j) acc[r][j] += av * bk[j];
+        }
+    }
+    for (std::size_t r = 0; r < MR; ++r) {
+        for (std::size_t j = 0; j < cols; ++j) c[r * ldc + j] += acc[r][j];
+    }
+}
+#endif
+
+inline std::vector<float>& pack_buffer() {
+    static thread_local std::vector<float> buffer(nc * kc);
+    return buffer;
+}
+
+// One tile: rows [m0, m0 + rows) x cols [n0, n0 + cols) of C, full K
+inline void run_tile(std::size_t rows, std::size_t cols, std::size_t K, const float* a, std::size_t lda,
+                     const float* b, std::size_t ldb, std::size_t n0, float* c, std::size_t ldc) {
+    float* packed = pack_buffer().data();
+    for (std::size_t k0 = 0; k0 < K; k0 += kc) {
+        const std::size_t depth = std::min(kc, K - k0);
+        pack_b(b, ldb, n0, cols, k0, depth, packed);
+        for (std::size_t p = 0; p < cols; p += nr) {
+            const std::size_t width = std::min(nr, cols - p);
+            const float* panel = packed + p * depth;
+            std::size_t r = 0;
+            for (; r + mr <= rows; r += mr) {
+                micro_kernel<mr>(depth, a + r * lda + k0, lda, panel, c + r * ldc + n0 + p, ldc, width);
+            }
+            for (; r < rows; ++r) {
+                micro_kernel<1>(depth, a + r * lda + k0, lda, panel, c + r * ldc + n0 + p, ldc, width);
+            }
+        }
+    }
+}
+
+// A block of run_tile_gathered: mc rows x kc
+inline std::vector<float>& a_block_buffer() {
+    static thread_local std::vector<float> buffer(mc * kc);
+    return buffer;
+}
+
+/**
+ * @brief run_tile for an A that is never materialized (implicit GEMM)
+ *
+ * load_a(row, k0, depth, dst) writes A[row][k0, k0 + depth) to dst. Per kc
+ * slice the tile's rows are gathered into an mc x kc block (the same cache
+ * footprint as a packed A) that the micro-kernel reads in place of A, e.g.
+ * convolution patches read straight from the input tensor.
+ */
+template<typename LoadA>
+inline void run_tile_gathered(std::size_t rows, std::size_t cols, std::size_t K, LoadA&& load_a, const float* b,
+                              std::size_t ldb, std::size_t n0, float* c, std::size_t ldc) {
+    float* packed = pack_buffer().data();
+    float* a = a_block_buffer().data();
+    for (std::size_t k0 = 0; k0 < K; k0 += kc) {
+        const std::size_t depth = std::min(kc, K - k0);
+        for (std::size_t r = 0; r < rows; ++r) load_a(r, k0, depth, a + r * depth);
+        pack_b(b, ldb, n0, cols, k0, depth, packed);
+        for (std::size_t p = 0; p < cols; p += nr) {
+            const std::size_t width = std::min(nr, cols - p);
+            const float* panel = packed + p * depth;
+            std::size_t r = 0;
+            for (; r + mr <= rows; r += mr) {
+                micro_kernel<mr>(depth, a + r * depth, depth, panel, c + r * ldc + n0 + p, ldc, width);
+            }
+            for (; r < rows; ++r) {
+                micro_kernel<1>(depth, a + r * depth, depth, panel, c + r * ldc + n0 + p, ldc, width);
+            }
+        }
+    }
+}
+
+}  // namespace gemm_detail
+
+/**
+ * @brief One GEMM of a grouped launch: C[M, N] = A[M, K] * B[N, K]^T (+ bias)
+ */
+struct GemmProblem {
+    std::size_t M = 0, N = 0, K = 0;
+    const float* a = nullptr;
+    std::size_t lda = 0;
+    const float* b = nullptr;
+    std::size_t ldb = 0;
+    float* c = nullptr;
+    std::size_t ldc = 0;
+    const float* bias = nullptr;  // [N] or null: C is overwritten either way
+};
+
+/**
+ * @brief Run many independent GEMMs with different row counts in one parallel launch
+ */
+inline void grouped_gemm(const std::vector<GemmProblem>& problems, ThreadPool& pool = ThreadPool::global()) {
+    NN_PROFILE_ZONE("grouped_gemm");
+    using namespace gemm_detail;
+
+    struct Tile {
+        std::size_t problem, m0, n0;
+    };
+    std::vector<Tile> tiles;
+    std::size_t flops = 0, bytes = 0;
+    for (std::size_t p = 0; p < problems.size(); ++p) {
+        const GemmProblem& g = problems[p];
+        for (std::size_t m0 = 0; m0 < g.M; m0 += mc) {
+            for (std::size_t n0 = 0; n0 < g.N; n0 += nc) tiles.push_back({p, m0, n0});
+        }
+        flops += 2 * g.M * g.N * g.K;
+        bytes += sizeof(float) * (g.M * g.K + g.N * g.K + g.M * g.N);
+    }
+    NN_METRICS_KERNEL("gemm", flops, bytes);
+    (void)flops;
+    (void)bytes;
+
+    pool.parallel_for(tiles.size(), [&](std::size_t t, std::size_t) {
+        const Tile& tile = tiles[t];
+        const GemmProblem& g = problems[tile.problem];
+        const std::size_t rows = std::min(mc, g.M - tile.m0);
+        const std::size_t cols = std::min(nc, g.N - tile.n0);
+        float* c = g.c + tile.m0 * g.ldc;
+        for (std::size_t r = 0; r < rows; ++r) {
+            for (std::size_t j = 0; j < cols; ++j) {
+                c[r * g.ldc + tile.n0 + j] = g.bias ? g.bias[tile.n0 + j] : 0.0f;
+            }
+        }
+        run_tile(rows, cols, g.K, g.a + tile.m0 * g.lda, g.lda, g.b, g.ldb, tile.n0, c, g.ldc);
+    });
+}
+
+// C[M, N] = A[M, K] * B[N, K]^T (+ bias), dense row-major operands
+inline void gemm_nt(std::size_t M, std::size_t N, std::size_t K, const float* a, const float* b, float* c,
+                    const float* bias = nullptr, ThreadPool& pool = ThreadPool::global()) {
+    grouped_gemm({GemmProblem{M, N, K, a, K, b, K, c, N, bias}}, pool);
+}
+
+// View form, e.g. writing into a column block of a wider output; every
+// operand needs unit stride along its last axis
+inline void gemm_nt(TensorView<const float, 2> a, TensorView<const float, 2> b, TensorView<float, 2> c,
+                    const float* bias = nullptr, ThreadPool& pool = ThreadPool::global()) {
+    grouped_gemm({GemmProblem{c.shape(0), c.shape(1), a.shape(1), a.data(), static_cast<std::size_t>(a.stride(0)),
+                              b.data(), static_cast<std::size_t>(b.stride(0)), c.data(),
+                              static_cast<std::size_t>(c.stride(0)), bias}},
+                 pool);
+}
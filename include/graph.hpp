@@ -0,0 +1,780 @@
+#pragma once
+
+#include "tensor.hpp"
+#include "nn_compiler.hpp"
+#include "gemm.hpp"
+#include "conv.hpp"
+#include "thread_pool.hpp"
+#include "memory_tracker.hpp"
+#include "profiler.hpp"
+#include "autotune.hpp"
+#include "snapshot.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Runtime graph executor for models described in a file
+ *
+ * Everything else in the tree is wired at compile time; a Graph is read at
+ * run time instead, so a new architecture needs a new file, not a rebuild.
+ * The text format, one statement per line ('#' starts a comment):
+ *
+ *   nn_graph 1
+ *   input x 2 32 784                     # name, rank, dims
+ *   param fc1.w 2 128 784                # name, rank, dims, then the values
+ *   0.0132 -0.0071 ...
+ *   node linear h1 x fc1.w fc1.b         # op, output, inputs, key=value attrs
+ *   node relu h2 h1
+ *   node conv2d y img k b stride=1 pad=1
+ *   output y
+ *
+ * GraphExecutor turns a Graph into a plan once: nodes in topological order
+ * (the file order does not matter), a kernel per node from a KernelRegistry,
+ * and one activation arena whose offsets come from the values' lifetimes,
+ * so buffers of values that are never live together are shared. run() is
+ * then a loop over pre-resolved kernel calls. For warm restarts a Graph can
+ * also be saved to a snapshot (snapshot.hpp) and loaded with its params
+ * read from the mapping in place, skipping the text parse.
+ *
+ * Kernels are type-erased behind Kernel::run. Per op, the registry tries its
+ * factories newest first; a factory declines a node by returning no kernel.
+ * The builtin ones handle any shape (GEMM, implicit-GEMM conv). On top of
+ * them, register_linear<In, Out>() and register_conv2d<...>() add factories
+ * that bind a node to the compile-time LinearLayer / Conv2D instantiation
+ * when its shapes and attributes match that instantiation exactly. With
+ * KernelSelection::Tuned, every accepting kernel of a node is timed at plan
+ * time instead and the fastest is kept; the choice is cached per host and
+ * node shape (autotune.hpp), so only the first plan pays for the timing.
+ */
+
+namespace nn_graph {
+
+using Shape = std::vector<std::size_t>;
+
+inline std::size_t elements(const Shape& shape) {
+    std::size_t n = 1;
+    for (std::size_t extent : shape) n *= extent;
+    return n;
+}
+
+constexpr std::size_t max_rank = 8;
+constexpr std::size_t max_elements = std::size_t(1) << 28;  // 1 GiB of floats per value
+
+// Why a shape read from a file is unusable; empty if it is fine. Bounding it
+// keeps a corrupt file from reaching an allocation that would throw.
+inline std::string shape_error(const Shape& shape) {
+    if (shape.size() > max_rank) {
+        return "rank " + std::to_string(shape.size()) + " is above " + std::to_string(max_rank);
+    }
+    std::size_t n = 1;
+    for (std::size_t extent : shape) {
+        if (extent == 0) return "zero extent";
+        if (extent > max_elements / n) return "more than " + std::to_string(max_elements) + " elements";
+        n *= extent;
+    }
+    return {};
+}
+
+struct Node {
+    std::string op;
+    std::string output;
+    std::vector<std::string> inputs;
+    std::map<std::string, std::int64_t> attrs;
+
+    std::int64_t attr(const std::string& key, std::int64_t fallback) const {
+        auto it = attrs.find(key);
+        return it == attrs.end() ? fallback : it->second;
+    }
+};
+
+struct Param {
+    Shape shape;
+    std::vector<float, nn_memory::TrackingAllocator<float>> data{
+        nn_memory::TrackingAllocator<float>("Graph", nn_memory::MemoryPurpose::Weights)};
+    const float* mapped = nullptr;         // values in a snapshot mapping instead of data
+    std::shared_ptr<const void> mapping;  // keeps mapped alive
+
+    const float* values() const { return mapped != nullptr ? mapped : data.data(); }
+};
+
+/**
+ * @brief Model description: graph inputs, parameters, nodes, outputs
+ */
+class Graph {
+public:
+    std::vector<std::pair<std::string, Shape>> inputs;
+    std::map<std::string, Param> params;
+    std::vector<Node> nodes;
+    std::vector<std::string> outputs;
+
+    void add_input(const std::string& name, Shape shape) { inputs.emplace_back(name, std::move(shape)); }
+
+    // Zero-filled; the caller writes the values
+    Param& add_param(const std::string& name, Shape shape) {
+        Param& p = params[name];
+        p.data.assign(elements(shape), 0.0f);
+        p.mapped = nullptr;
+        p.mapping.reset();
+        p.shape = std::move(shape);
+        return p;
+    }
+
+    void add_node(std::string op, std::string output, std::vector<std::string> node_inputs,
+                  std::map<std::string, std::int64_t> attrs = {}) {
+        nodes.push_back({std::move(op), std::move(output), std::move(node_inputs), std::move(attrs)});
+    }
+
+    void add_output(const std::string& name) { outputs.push_back(name); }
+
+    void write(std::ostream& out) const {
+        auto write_shape = [&](const Shape& shape) {
+            out << ' ' << shape.size();
+            for (std::size_t extent : shape) out << ' ' << extent;
+        };
+        out << "nn_graph 1\n";
+        for (const auto& [name, shape] : inputs) {
+            out << "input " << name;
+            write_shape(shape);
+            out << '\n';
+        }
+        const auto precision = out.precision(9);  // round-trips every float
+        for (const auto& [name, param] : params) {
+            out << "param " << name;
+            write_shape(param.shape);
+            const float* values = param.values();
+            for (std::size_t i = 0; i < elements(param.shape); ++i) out << (i % 16 ? ' ' : '\n') << values[i];
+            out << '\n';
+        }
+        out.precision(precision);
+        for (const Node& node : nodes) {
+            out << "node " << node.op << ' ' << node.output;
+            for (const auto& input : node.inputs) out << ' ' << input;
+            for (const auto& [key, value] : node.attrs) out << ' ' << key << '=' << value;
+            out << '\n';
+        }
+        for (const auto& name : outputs) out << "output " << name << '\n';
+    }
+
+    /**
+     * @brief nullopt and a message on malformed input
+     *
+     * Shapes are bounded (max_rank, max_elements, no zero extents), so a
+     * corrupt file is reported rather than reaching an allocation that throws.
+     */
+    static std::optional<Graph> parse(std::istream& in, std::string& error) {
+        Graph graph;
+        std::string line, keyword;
+        std::size_t line_number = 0;
+        auto fail = [&](const std::string& what) {
+            error = "line " + std::to_string(line_number) + ": " + what;
+            return std::nullopt;
+        };
+        // Empty or the reason the shape is bad
+        auto read_shape = [](std::istream& s, Shape& shape) -> std::string {
+            std::size_t rank = 0;
+            if (!(s >> rank)) return "missing rank";
+            if (rank > max_rank) return "rank " + std::to_string(rank) + " is above " + std::to_string(max_rank);
+            shape.resize(rank);
+            for (auto& extent : shape) {
+                if (!(s >> extent)) return "missing extent";
+            }
+            return shape_error(shape);
+        };
+
+        bool header = false;
+        while (std::getline(in, line)) {
+            ++line_number;
+            line = line.substr(0, line.find('#'));
+            std::istringstream s(line);
+            if (!(s >> keyword)) continue;
+            if (!header) {
+                int version = 0;
+                if (keyword != "nn_graph" || !(s >> version) || version != 1) return fail("expected 'nn_graph 1'");
+                header = true;
+            } else if (keyword == "input") {
+                std::string name;
+                Shape shape;
+                if (!(s >> name)) return fail("bad input");
+                if (auto why = read_shape(s, shape); !why.empty()) return fail("input " + name + ": " + why);
+                graph.add_input(name, std::move(shape));
+            } else if (keyword == "param") {
+                std::string name;
+                Shape shape;
+                if (!(s >> name)) return fail("bad param");
+                if (auto why = read_shape(s, shape); !why.empty()) return fail("param " + name + ": " + why);
+                Param& param = graph.add_param(name, std::move(shape));
+                for (float& value : param.data) {  // values may continue over the following lines
+                    while (!(s >> value)) {
+                        if (!s.eof() || !std::getline(in, line)) return fail("param " + name + " is short of values");
+                        ++line_number;
+                        s.clear();
+                        s.str(line);
+                    }
+                }
+            } else if (keyword == "node") {
+                Node node;
+                if (!(s >> node.op >> node.output)) return fail("bad node");
+                for (std::string token; s >> token;) {
+                    const auto eq = token.find('=');
+                    if (eq == std::string::npos) {
+                        node.inputs.push_back(token);
+                    } else {
+                        std::istringstream value(token.substr(eq + 1));
+                        if (!(value >> node.attrs[token.substr(0, eq)])) return fail("bad attribute " + token);
+                    }
+                }
+                graph.nodes.push_back(std::move(node));
+            } else if (keyword == "output") {
+                std::string name;
+                if (!(s >> name)) return fail("bad output");
+                graph.add_output(name);
+            } else {
+                return fail("unknown statement '" + keyword + "'");
+            }
+        }
+        if (!header) return fail("empty model");
+        return graph;
+    }
+
+    /**
+     * @brief Sections name.graph (the text format without params), name.params
+     * (one "name rank dims... offset" line each) and name.values (all values)
+     */
+    void save(nn_snapshot::Writer& writer, const std::string& name) const {
+        Graph structure;
+        structure.inputs = inputs;
+        structure.nodes = nodes;
+        structure.outputs = outputs;
+        std::ostringstream text, index;
+        structure.write(text);
+        std::vector<float> values;
+        for (const auto& [param_name, param] : params) {
+            index << param_name << ' ' << param.shape.size();
+            for (std::size_t extent : param.shape) index << ' ' << extent;
+            index << ' ' << values.size() << '\n';
+            values.insert(values.end(), param.values(), param.values() + elements(param.shape));
+            values.resize((values.size() + 15) / 16 * 16, 0.0f);  // 64-byte aligned params
+        }
+        writer.add(name + ".graph", text.str());
+        writer.add(name + ".params", index.str());
+        writer.add(name + ".values", std::span<const float>(values));
+    }
+
+    // The graph saved as name, its params read from the mapping in place
+    static std::optional<Graph> load(std::shared_ptr<const nn_snapshot::Snapshot> snapshot, const std::string& name,
+                                     std::string& error) {
+        if (!snapshot->contains(name + ".graph") || !snapshot->contains(name + ".params")) {
+            error = "snapshot has no graph '" + name + "'";
+            return std::nullopt;
+        }
+        std::istringstream text(snapshot->text(name + ".graph"));
+        std::optional<Graph> graph = parse(text, error);
+        if (!graph) return std::nullopt;
+        const auto bytes = snapshot->bytes(name + ".values");
+        const auto* values = reinterpret_cast<const float*>(bytes.data());
+        const std::size_t count = bytes.size() / sizeof(float);
+        std::istringstream index(snapshot->text(name + ".params"));
+        for (std::string line; std::getline(index, line);) {
+            std::istringstream s(line);
+            std::string param_name;
+            std::size_t rank = 0, offset = 0;
+            Param param;
+            bool ok = s >> param_name >> rank && rank <= max_rank;
+            param.shape.resize(ok ? rank : 0);
+            for (auto& extent : param.shape) ok = ok && static_cast<bool>(s >> extent);
+            ok = ok && shape_error(param.shape).empty();
+            if (!ok || !(s >> offset) || offset > count || elements(param.shape) > count - offset) {
+                error = "bad param entry '" + line + "' in graph '" + name + "'";
+                return std::nullopt;
+            }
+            param.mapped = values + offset;
+            param.mapping = snapshot;
+            graph->params[param_name] = std::move(param);
+        }
+        return graph;
+    }
+};
+
+/**
+ * @brief Type-erased compute of one node; inputs in node order
+ */
+class Kernel {
+public:
+    virtual ~Kernel() = default;
+    virtual void run(const float* const* inputs, float* output, ThreadPool& pool) = 0;
+};
+
+// What a factory sees of a node when the plan is built
+struct NodeContext {
+    const Node& node;
+    std::vector<Shape> shapes;            // per input
+    std::vector<const float*> constants;  // per input: parameter data, null for activations
+};
+
+// A factory's answer: kernel == nullptr declines the node
+struct Binding {
+    std::unique_ptr<Kernel> kernel;
+    Shape shape;        // of the output
+    std::string label;  // which kernel, for plan dumps
+};
+
+using KernelFactory = std::function<Binding(const NodeContext&)>;
+
+namespace graph_detail {
+
+// Kernel from a lambda run(inputs, output, pool)
+template<typename F>
+class LambdaKernel : public Kernel {
+private:
+    F f_;
+
+public:
+    explicit LambdaKernel(F f) : f_(std::move(f)) {}
+    void run(const float* const* inputs, float* output, ThreadPool& pool) override { f_(inputs, output, pool); }
+};
+
+template<typename F>
+Binding make_binding(Shape shape, std::string label, F f) {
+    return {std::make_unique<LambdaKernel<F>>(std::move(f)), std::move(shape), std::move(label)};
+}
+
+// linear: x [..., K], w [N, K], optional b [N] -> [..., N]
+inline Binding linear(const NodeContext& ctx) {
+    const auto& s = ctx.shapes;
+    if (s.size() < 2 || s[0].empty() || s[1].size() != 2 || s[1][1] != s[0].back() || s[0].back() == 0) return {};
+    if (s.size() > 2 && s[2] != Shape{s[1][0]}) return {};
+    const std::size_t K = s[1][1], N = s[1][0], M = elements(s[0]) / K;
+    const bool bias = s.size() > 2;
+    Shape out = s[0];
+    out.back() = N;
+    return make_binding(out, "gemm", [=](const float* const* in, float* y, ThreadPool& pool) {
+        gemm_nt(M, N, K, in[0], in[1], y, bias ? in[2] : nullptr, pool);
+    });
+}
+
+inline Binding relu(const NodeContext& ctx) {
+    if (ctx.shapes.size() != 1) return {};
+    const std::size_t n = elements(ctx.shapes[0]);
+    return make_binding(ctx.shapes[0], "relu", [=](const float* const* in, float* y, ThreadPool& pool) {
+        pool.parallel_ranges(n, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t i = begin; i < end; ++i) y[i] = std::max(in[0][i], 0.0f);
+        });
+    });
+}
+
+inline Binding add(const NodeContext& ctx) {
+    if (ctx.shapes.size() != 2 || ctx.shapes[0] != ctx.shapes[1]) return {};
+    const std::size_t n = elements(ctx.shapes[0]);
+    return make_binding(ctx.shapes[0], "add", [=](const float* const* in, float* y, ThreadPool& pool) {
+        pool.parallel_ranges(n, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t i = begin; i < end; ++i) y[i] = in[0][i] + in[1][i];
+        });
+    });
+}
+
+struct Conv2DShape {
+    std::size_t batch, height, width, channels, out_channels, kernel_h, kernel_w, stride, padding;
+};
+
+// conv2d: x [B, H, W, C], w [O, KH, KW, C], optional b [O]; attrs stride, pad
+inline std::optional<Conv2DShape> conv2d_shape(const NodeContext& ctx) {
+    const auto& s = ctx.shapes;
+    if (s.size() < 2 || s[0].size() != 4 || s[1].size() != 4 || s[1][3] != s[0][3]) return std::nullopt;
+    if (s.size() > 2 && s[2] != Shape{s[1][0]}) return std::nullopt;
+    const auto stride = ctx.node.attr("stride", 1), padding = ctx.node.attr("pad", 0);
+    if (stride < 1 || padding < 0 || stride > std::int64_t(max_elements) || padding > std::int64_t(max_elements)) {
+        return std::nullopt;
+    }
+    Conv2DShape c{s[0][0], s[0][1], s[0][2], s[0][3], s[1][0], s[1][1], s[1][2],
+                  static_cast<std::size_t>(stride), static_cast<std::size_t>(padding)};
+    if (c.height + 2 * c.padding < c.kernel_h || c.width + 2 * c.padding < c.kernel_w) return std::nullopt;
+    return c;
+}
+
+inline conv_detail::Geometry geometry(const Conv2DShape& c) {
+    return {c.height, c.width, (c.height + 2 * c.padding - c.kernel_h) / c.stride + 1,
+            (c.width + 2 * c.padding - c.kernel_w) / c.stride + 1};
+}
+
+inline Binding conv2d(const NodeContext& ctx) {
+    const auto c = conv2d_shape(ctx);
+    if (!c) return {};
+    const conv_detail::Geometry g = geometry(*c);
+    const conv_detail::DynamicPatch patch{c->channels, c->kernel_h, c->kernel_w, c->stride, c->padding};
+    const bool bias = ctx.shapes.size() > 2;
+    std::vector<float> zeros(bias ? 0 : c->out_channels, 0.0f);
+    return make_binding({c->batch, g.out_height, g.out_width, c->out_channels}, "implicit-gemm conv2d",
+                [=, zeros = std::move(zeros)](const float* const* in, float* y, ThreadPool& pool) {
+                    conv_detail::conv2d_implicit_gemm(patch, in[0], c->batch, g, in[1], bias ? in[2] : zeros.data(),
+                                                      c->out_channels, y, pool);
+                });
+}
+
+}  // namespace graph_detail
+
+class KernelRegistry {
+private:
+    std::map<std::string, std::vector<KernelFactory>> factories_;
+
+public:
+    // Tried before the factories already registered for op
+    void add(const std::string& op, KernelFactory factory) { factories_[op].push_back(std::move(factory)); }
+
+    Binding bind(const NodeContext& ctx) const {
+        auto it = factories_.find(ctx.node.op);
+        if (it == factories_.end()) return {};
+        for (auto f = it->second.rbegin(); f != it->second.rend(); ++f) {
+            Binding binding = (*f)(ctx);
+            if (binding.kernel) return binding;
+        }
+        return {};
+    }
+
+    // Every kernel that accepts the node, in the order bind() tries them
+    std::vector<Binding> bind_all(const NodeContext& ctx) const {
+        std::vector<Binding> bindings;
+        auto it = factories_.find(ctx.node.op);
+        if (it == factories_.end()) return bindings;
+        for (auto f = it->second.rbegin(); f != it->second.rend(); ++f) {
+            Binding binding = (*f)(ctx);
+            if (binding.kernel) bindings.push_back(std::move(binding));
+        }
+        return bindings;
+    }
+
+    // Shape-generic kernels for every op of the format
+    static KernelRegistry builtin() {
+        KernelRegistry registry;
+        registry.add("linear", graph_detail::linear);
+        registry.add("relu", graph_detail::relu);
+        registry.add("add", graph_detail::add);
+        registry.add("conv2d", graph_detail::conv2d);
+        return registry;
+    }
+};
+
+/**
+ * @brief Bind linear nodes on one [In] vector, with constant [Out, In]
+ * weights and [Out] bias, to LinearLayer<float, In, Out>
+ *
+ * LinearLayer is a matrix-vector kernel; batched inputs are left to the GEMM.
+ */
+template<std::size_t In, std::size_t Out>
+void register_linear(KernelRegistry& registry) {
+    registry.add("linear", [](const NodeContext& ctx) -> Binding {
+        const auto& s = ctx.shapes;
+        if (s.size() != 3 || s[0].empty() || s[0].back() != In || elements(s[0]) != In || s[1] != Shape{Out, In} ||
+            s[2] != Shape{Out} || !ctx.constants[1] || !ctx.constants[2]) {
+            return {};
+        }
+        using Layer = LinearLayer<float, In, Out>;
+        std::shared_ptr<Layer> layer = nn_memory::make_tracked<Layer>(nn_memory::MemoryPurpose::Weights);
+        std::copy(ctx.constants[1], ctx.constants[1] + Out * In, layer->get_weights().data());
+        std::copy(ctx.constants[2], ctx.constants[2] + Out, layer->get_bias().data());
+        Shape out = s[0];
+        out.back() = Out;
+        return graph_detail::make_binding(
+            out, "LinearLayer<" + std::to_string(In) + ", " + std::to_string(Out) + ">",
+            [=](const float* const* in, float* y, ThreadPool&) {
+                Tensor<float, In> x;
+                std::copy(in[0], in[0] + In, x.data());
+                const Tensor<float, Out> result = layer->forward(x);
+                std::copy(result.data(), result.data() + Out, y);
+            });
+    });
+}
+
+/**
+ * @brief Bind conv2d nodes with constant OHWI weights and bias, matching
+ * channels, kernel, stride and padding, to that Conv2D instantiation
+ */
+template<std::size_t InChannels, std::size_t OutChannels, std::size_t KernelH, std::size_t KernelW,
+         std::size_t Stride = 1, std::size_t Padding = 0>
+void register_conv2d(KernelRegistry& registry) {
+    registry.add("conv2d", [](const NodeContext& ctx) -> Binding {
+        using Conv = Conv2D<InChannels, OutChannels, KernelH, KernelW, Stride, Padding>;
+        const auto c = graph_detail::conv2d_shape(ctx);
+        if (!c || ctx.shapes.size() != 3 || !ctx.constants[1] || !ctx.constants[2] ||
+            c->channels != InChannels || c->out_channels != OutChannels || c->kernel_h != KernelH ||
+            c->kernel_w != KernelW || c->stride != Stride || c->padding != Padding) {
+            return {};
+        }
+        std::shared_ptr<Conv> conv = nn_memory::make_tracked<Conv>(nn_memory::MemoryPurpose::Weights);
+        std::copy(ctx.constants[1], ctx.constants[1] + Conv::Weights::total_size, conv->get_weights().data());
+        std::copy(ctx.constants[2], ctx.constants[2] + OutChannels, conv->get_bias().data());
+        const conv_detail::Geometry g = graph_detail::geometry(*c);
+        return graph_detail::make_binding(
+            {c->batch, g.out_height, g.out_width, OutChannels},
+            "Conv2D<" + std::to_string(InChannels) + ", " + std::to_string(OutChannels) + ", " +
+                std::to_string(KernelH) + "x" + std::to_string(KernelW) + ">",
+            [=](const float* const* in, float* y, ThreadPool& pool) {
+                conv->forward(in[0], c->batch, c->height, c->width, y, pool);
+            });
+    });
+}
+
+// FirstMatch: the newest factory that accepts a node; Tuned: the fastest
+// accepting kernel, timed once per node shape and host (nn_autotune)
+enum class KernelSelection { FirstMatch, Tuned };
+
+/**
+ * @brief A Graph planned for execution: kernels bound, arena laid out
+ */
+class GraphExecutor {
+private:
+    static constexpr std::size_t alignment = 16;  // floats (64 bytes) between arena buffers
+
+    struct Value {
+        Shape shape;
+        const float* constant = nullptr;  // parameter data
+        std::size_t offset = 0;           // in the arena, for activations
+        std::size_t first = 0, last = 0;  // steps that write / last read it
+    };
+
+    struct Step {
+        std::unique_ptr<Kernel> kernel;
+        std::vector<const float*> inputs;
+        float* output = nullptr;
+        std::string value;  // the node's output
+        std::string label;  // of the kernel
+        std::vector<Binding> alternatives;  // KernelSelection::Tuned, until timed
+    };
+
+    Graph graph_;
+    std::map<std::string, Value> values_;
+    std::vector<Step> steps_;
+    std::vector<float, nn_memory::TrackingAllocator<float>> arena_{
+        nn_memory::TrackingAllocator<float>("GraphExecutor", nn_memory::MemoryPurpose::Activations)};
+    std::size_t unshared_ = 0;
+
+    GraphExecutor() = default;
+
+    // Kahn's algorithm over the node -> node edges; empty if there is a cycle
+    std::vector<std::size_t> topological_order() const {
+        std::map<std::string, std::size_t> producer;
+        for (std::size_t i = 0; i < graph_.nodes.size(); ++i) producer[graph_.nodes[i].output] = i;
+        std::vector<std::size_t> pending(graph_.nodes.size(), 0);
+        std::vector<std::vector<std::size_t>> consumers(graph_.nodes.size());
+        for (std::size_t i = 0; i < graph_.nodes.size(); ++i) {
+            for (const auto& input : graph_.nodes[i].inputs) {
+                auto it = producer.find(input);
+                if (it == producer.end()) continue;
+                consumers[it->second].push_back(i);
+                ++pending[i];
+            }
+        }
+        std::vector<std::size_t> order;
+        for (std::size_t i = 0; i < graph_.nodes.size(); ++i) {
+            if (pending[i] == 0) order.push_back(i);
+        }
+        for (std::size_t head = 0; head < order.size(); ++head) {
+            for (std::size_t next : consumers[order[head]]) {
+                if (--pending[next] == 0) order.push_back(next);
+            }
+        }
+        if (order.size() != graph_.nodes.size()) order.clear();
+        return order;
+    }
+
+    static std::size_t padded(const Shape& shape) { return (elements(shape) + alignment - 1) / alignment * alignment; }
+
+    // First fit by address among the buffers whose lifetimes overlap
+    void plan_arena(const std::vector<std::string>& activations) {
+        std::vector<const Value*> placed;
+        std::size_t total = 0;
+        for (const auto& name : activations) {
+            Value& v = values_[name];
+            std::vector<std::pair<std::size_t, std::size_t>> busy;
+            for (const Value* other : placed) {
+                if (other->first <= v.last && v.first <= other->last) {
+                    busy.emplace_back(other->offset, other->offset + padded(other->shape));
+                }
+            }
+            std::sort(busy.begin(), busy.end());
+            std::size_t offset = 0;
+            for (const auto& [begin, end] : busy) {
+                if (offset + padded(v.shape) <= begin) break;
+                offset = std::max(offset, end);
+            }
+            v.offset = offset;
+            placed.push_back(&v);
+            total = std::max(total, offset + padded(v.shape));
+            unshared_ += elements(v.shape);
+        }
+        arena_.assign(total, 0.0f);
+    }
+
+    // "graph.op" / "input shapes;attrs;threads" key of a node for nn_autotune
+    std::pair<std::string, std::string> tuning_key(const Node& node, const ThreadPool& pool) const {
+        std::string shape;
+        for (const auto& input : node.inputs) shape += nn_autotune::shape_key(values_.at(input).shape) + ';';
+        for (const auto& [key, value] : node.attrs) shape += key + '=' + std::to_string(value) + ';';
+        return {"graph." + node.op, shape + 't' + std::to_string(pool.size())};
+    }
+
+    // Keeps the fastest of each step's kernel and its alternatives
+    void tune(const std::vector<std::size_t>& order, ThreadPool& pool, nn_autotune::Cache& cache) {
+        for (std::size_t step = 0; step < steps_.size(); ++step) {
+            Step& s = steps_[step];
+            if (s.alternatives.empty()) continue;
+            const Node& node = graph_.nodes[order[step]];
+            s.alternatives.insert(s.alternatives.begin(), Binding{std::move(s.kernel), {}, s.label});
+            std::vector<nn_autotune::Candidate> candidates;
+            for (Binding& b : s.alternatives) {
+                candidates.push_back({b.label, [&, kernel = b.kernel.get()] {
+                                          kernel->run(s.inputs.data(), s.output, pool);
+                                      }});
+            }
+            const auto [op, shape] = tuning_key(node, pool);
+            Binding& best = s.alternatives[nn_autotune::select(op, shape, candidates, cache)];
+            s.kernel = std::move(best.kernel);
+            s.label = best.label;
+            s.alternatives.clear();
+        }
+    }
+
+public:
+    GraphExecutor(const GraphExecutor&) = delete;
+    GraphExecutor& operator=(const GraphExecutor&) = delete;
+
+    // nullptr and a message when a node has unknown inputs, no matching kernel, or the graph a cycle
+    static std::unique_ptr<GraphExecutor> create(Graph graph, const KernelRegistry& registry, std::string& error,
+                                                 KernelSelection selection = KernelSelection::FirstMatch,
+                                                 ThreadPool& pool = ThreadPool::global(),
+                                                 nn_autotune::Cache& cache = nn_autotune::Cache::instance()) {
+        std::unique_ptr<GraphExecutor> exec(new GraphExecutor());
+        exec->graph_ = std::move(graph);
+        const Graph& g = exec->graph_;
+        auto& values = exec->values_;
+
+        std::vector<std::string> activations;
+        for (const auto& [name, param] : g.params) {
+            values[name].shape = param.shape;
+            values[name].constant = param.values();
+        }
+        for (const auto& [name, shape] : g.inputs) {
+            if (values.count(name)) {
+                error = "value '" + name + "' is defined twice";
+                return nullptr;
+            }
+            values[name].shape = shape;
+            activations.push_back(name);
+        }
+        for (const Node& node : g.nodes) {
+            if (values.count(node.output)) {
+                error = "value '" + node.output + "' is defined twice";
+                return nullptr;
+            }
+            values[node.output];
+        }
+
+        const std::vector<std::size_t> order = exec->topological_order();
+        if (order.size() != g.nodes.size()) {
+            error = "the graph has a cycle";
+            return nullptr;
+        }
+        for (std::size_t step = 0; step < order.size(); ++step) {
+            const Node& node = g.nodes[order[step]];
+            NodeContext ctx{node, {}, {}};
+            for (const auto& input : node.inputs) {
+                auto it = values.find(input);
+                if (it == values.end()) {
+                    error = "node '" + node.output + "' reads undefined value '" + input + "'";
+                    return nullptr;
+                }
+                ctx.shapes.push_back(it->second.shape);
+                ctx.constants.push_back(it->second.constant);
+                it->second.last = step;
+            }
+            std::vector<Binding> bindings;
+            if (selection == KernelSelection::Tuned) {
+                bindings = registry.bind_all(ctx);
+            } else {
+                bindings.push_back(registry.bind(ctx));
+            }
+            if (bindings.empty() || !bindings[0].kernel) {
+                error = "no " + node.op + " kernel accepts the inputs of node '" + node.output + "'";
+                return nullptr;
+            }
+            if (auto why = shape_error(bindings[0].shape); !why.empty()) {
+                error = "node '" + node.output + "' output: " + why;
+                return nullptr;
+            }
+            Value& out = values[node.output];
+            out.shape = std::move(bindings[0].shape);
+            out.first = out.last = step;
+            activations.push_back(node.output);
+            Step s{std::move(bindings[0].kernel), {}, nullptr, node.output, bindings[0].label, {}};
+            for (std::size_t i = 1; i < bindings.size(); ++i) {
+                if (bindings[i].shape == out.shape) s.alternatives.push_back(std::move(bindings[i]));
+            }
+            exec->steps_.push_back(std::move(s));
+        }
+        for (const auto& [name, shape] : g.inputs) values[name].last = order.size();  // reusable across runs
+        for (const auto& name : g.outputs) {
+            auto it = values.find(name);
+            if (it == values.end() || it->second.constant) {
+                error = "output '" + name + "' is not computed by the graph";
+                return nullptr;
+            }
+            it->second.last = order.size();  // alive after the last step
+        }
+
+        exec->plan_arena(activations);
+        for (std::size_t step = 0; step < order.size(); ++step) {
+            const Node& node = g.nodes[order[step]];
+            Step& s = exec->steps_[step];
+            for (const auto& input : node.inputs) s.inputs.push_back(exec->data(input));
+            s.output = exec->arena_.data() + values[node.output].offset;
+        }
+        exec->tune(order, pool, cache);
+        return exec;
+    }
+
+    void run(ThreadPool& pool = ThreadPool::global()) {
+        NN_PROFILE_ZONE("GraphExecutor::run");
+        for (Step& step : steps_) step.kernel->run(step.inputs.data(), step.output, pool);
+    }
+
+    // One step of run(), for callers that interleave work between layers (nn_scheduler)
+    void run_step(std::size_t step, ThreadPool& pool = ThreadPool::global()) {
+        Step& s = steps_[step];
+        s.kernel->run(s.inputs.data(), s.output, pool);
+    }
+
+    // Buffer of a graph input (write before run()) or any activation; null if unknown
+    float* input(const std::string& name) {
+        auto it = values_.find(name);
+        return it == values_.end() || it->second.constant ? nullptr : arena_.data() + it->second.offset;
+    }
+
+    const float* data(const std::string& name) const {
+        auto it = values_.find(name);
+        if (it == values_.end()) return nullptr;
+        return it->second.constant ? it->second.constant : arena_.data() + it->second.offset;
+    }
+
+    const float* output(const std::string& name) const { return data(name); }
+
+    const Shape& shape(const std::string& name) const { return values_.at(name).shape; }
+
+    std::size_t num_steps() const { return steps_.size(); }
+    std::string step_label(std::size_t step) const { return steps_[step].value + " = " + steps_[step].label; }
+
+    // Arena size vs. one buffer per activation
+    std::size_t arena_bytes() const { return sizeof(float) * arena_.size(); }
+    std::size_t unshared_bytes() const { return sizeof(float) * unshared_; }
+};
+
+}  // namespace nn_graph
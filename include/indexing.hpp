@@ -0,0 +1,435 @@
+#pragma once
+
+#include "tensor_view.hpp"
+#include "thread_pool.hpp"
+#include "profiler.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Indexing primitives: index_select, gather, scatter, scatter_add, index_add
+ *
+ * All kernels take TensorViews and an axis. Work is split into rows along
+ * the last axis, so the inner loop is either a contiguous row copy (when a
+ * whole row is picked by one index) or an indexed element run:
+ *   - element runs of float / int32 use hardware gathers (AVX-512 or AVX2,
+ *     when the build enables them and the offsets fit in 32 bits), otherwise
+ *     a scalar loop that prefetches a fixed distance ahead;
+ *   - row copies prefetch the source rows a few rows ahead, which is what
+ *     hides the misses of random embedding-style lookups.
+ * Scatter-add never uses atomics: tasks own disjoint output lines, and where
+ * there are too few lines to go around (1-D scatter_add, index_add of rows)
+ * the updates are counting-sorted by target and each thread reduces whole
+ * segments, in source order, so results are deterministic.
+ *
+ * Indices are int32 and must be in range; they are not checked.
+ */
+
+namespace indexing_detail {
+
+constexpr std::size_t prefetch_distance = 16;  // elements ahead in element runs
+constexpr std::size_t prefetch_rows = 8;       // rows ahead in row copies
+constexpr std::size_t cache_line = 64;
+constexpr std::size_t column_chunk = 256;      // last-axis chunk per scatter task
+
+inline void prefetch(const void* p) {
+#if defined(__GNUC__)
+    __builtin_prefetch(p);
+#else
+    (void)p;
+#endif
+}
+
+template<typename T>
+inline void prefetch_row(const T* row, std::size_t n) {
+    const char* p = reinterpret_cast<const char*>(row);
+    for (std::size_t b = 0; b < n * sizeof(T); b += cache_line) prefetch(p + b);
+}
+
+template<typename T>
+constexpr bool hw_gather_type = std::is_same_v<T, float> || std::is_same_v<T, std::int32_t>;
+
+/**
+ * @brief dst[j * dst_stride] = base[idx[j * idx_stride] * scale + j * lane], j < n
+ *
+ * fits_int32: every offset fits in an int32 (required by hardware gathers).
+ */
+template<typename T>
+inline void gather_run(const T* base, const std::int32_t* idx, std::ptrdiff_t idx_stride, std::ptrdiff_t scale,
+                       std::ptrdiff_t lane, T* dst, std::ptrdiff_t dst_stride, std::size_t n, bool fits_int32) {
+    std::size_t j = 0;
+#if defined(__AVX512F__) || defined(__AVX2__)
+    if constexpr (hw_gather_type<T>) {
+        if (fits_int32 && idx_stride == 1 && dst_stride == 1) {
+#if defined(__AVX512F__)
+            constexpr std::size_t width = 16;
+            const __m512i vscale = _mm512_set1_epi32(static_cast<int>(scale));
+            const __m512i step = _mm512_set1_epi32(static_cast<int>(lane * width));
+            __m512i lanes = _mm512_mullo_epi32(
+                _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+                _mm512_set1_epi32(static_cast<int>(lane)));
+            for (; j + width <= n; j += width) {
+                const __m512i offsets = _mm512_add_epi32(
+                    _mm512_mullo_epi32(_mm512_loadu_si512(idx + j), vscale), lanes);
+                // Masked form with a zero source: the unmasked intrinsic trips
+                // -Wmaybe-uninitialized inside GCC's own header
+                if constexpr (std::is_same_v<T, float>) {
+                    _mm512_storeu_ps(dst + j,
+                                     _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xFFFF, offsets, base, 4));
+                } else {
+                    _mm512_storeu_si512(dst + j, _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xFFFF,
+                                                                             offsets, base, 4));
+                }
+                lanes = _mm512_add_epi32(lanes, step);
+            }
+#else
+            constexpr std::size_t width = 8;
+            const __m256i vscale = _mm256_set1_epi32(static_cast<int>(scale));
+            const __m256i step = _mm256_set1_epi32(static_cast<int>(lane * width));
+            __m256i lanes = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                               _mm256_set1_epi32(static_cast<int>(lane)));
+            for (; j + width <= n; j += width) {
+                const __m256i offsets = _mm256_add_epi32(
+                    _mm256_mullo_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + j)), vscale),
+                    lanes);
+                if constexpr (std::is_same_v<T, float>) {
+                    _mm256_storeu_ps(dst + j, _mm256_i32gather_ps(base, offsets, 4));
+                } else {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + j),
+                                        _mm256_i32gather_epi32(reinterpret_cast<const int*>(base), offsets, 4));
+                }
+                lanes = _mm256_add_epi32(lanes, step);
+            }
+#endif
+        }
+    }
+#else
+    (void)fits_int32;
+#endif
+    for (; j < n; ++j) {
+        if (j + prefetch_distance < n) {
+            const std::size_t a = j + prefetch_distance;
+            prefetch(base + idx[static_cast<std::ptrdiff_t>(a) * idx_stride] * scale +
+                     static_cast<std::ptrdiff_t>(a) * lane);
+        }
+        dst[static_cast<std::ptrdiff_t>(j) * dst_stride] =
+            base[idx[static_cast<std::ptrdiff_t>(j) * idx_stride] * scale + static_cast<std::ptrdiff_t>(j) * lane];
+    }
+}
+
+template<typename T>
+inline void copy_run(const T* src, std::ptrdiff_t src_stride, T* dst, std::ptrdiff_t dst_stride, std::size_t n) {
+    if (src_stride == 1 && dst_stride == 1 && std::is_trivially_copyable_v<T>) {
+        std::memcpy(dst, src, n * sizeof(T));
+        return;
+    }
+    for (std::ptrdiff_t j = 0; j < static_cast<std::ptrdiff_t>(n); ++j) dst[j * dst_stride] = src[j * src_stride];
+}
+
+template<typename T>
+inline void add_run(const T* src, std::ptrdiff_t src_stride, T* dst, std::ptrdiff_t dst_stride, std::size_t n) {
+    if (src_stride == 1 && dst_stride == 1) {
+        for (std::size_t j = 0; j < n; ++j) dst[j] += src[j];
+        return;
+    }
+    for (std::ptrdiff_t j = 0; j < static_cast<std::ptrdiff_t>(n); ++j) dst[j * dst_stride] += src[j * src_stride];
+}
+
+// Largest |offset| reachable through `axis` plus a run along the last axis
+template<typename T, std::size_t Rank>
+inline bool offsets_fit_int32(const TensorView<T, Rank>& v, std::size_t axis, std::size_t run) {
+    const auto magnitude = [](std::ptrdiff_t s) { return static_cast<std::size_t>(s < 0 ? -s : s); };
+    const std::size_t span = v.shape(axis) * magnitude(v.stride(axis)) + run * magnitude(v.stride(Rank - 1));
+    return span <= static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max());
+}
+
+// Counting sort of positions [0, n) by target[p] in [0, targets), stable.
+// Returns segment offsets; order receives the positions grouped by target.
+inline std::vector<std::size_t> sort_by_target(const std::int32_t* target, std::ptrdiff_t stride, std::size_t n,
+                                               std::size_t targets, std::vector<std::uint32_t>& order,
+                                               ThreadPool& pool) {
+    const std::size_t parts = std::max<std::size_t>(1, std::min(pool.size(), n / 4096));
+    std::vector<std::size_t> counts(parts * (targets + 1), 0);
+    const auto part_range = [&](std::size_t part, std::size_t& begin, std::size_t& end) {
+        begin = n * part / parts;
+        end = n * (part + 1) / parts;
+    };
+    pool.parallel_for(parts, [&](std::size_t part, std::size_t) {
+        std::size_t begin, end;
+        part_range(part, begin, end);
+        std::size_t* hist = counts.data() + part * (targets + 1);
+        for (std::size_t p = begin; p < end; ++p) ++hist[target[static_cast<std::ptrdiff_t>(p) * stride]];
+    });
+    // Segment starts; part-major within each target keeps the sort stable
+    std::vector<std::size_t> offsets(targets + 1, 0);
+    std::size_t running = 0;
+    for (std::size_t t = 0; t < targets; ++t) {
+        offsets[t] = running;
+        for (std::size_t part = 0; part < parts; ++part) {
+            std::size_t& c = counts[part * (targets + 1) + t];
+            const std::size_t count = c;
+            c = running;
+            running += count;
+        }
+    }
+    offsets[targets] = running;
+    order.resize(n);
+    pool.parallel_for(parts, [&](std::size_t part, std::size_t) {
+        std::size_t begin, end;
+        part_range(part, begin, end);
+        std::size_t* next = counts.data() + part * (targets + 1);
+        for (std::size_t p = begin; p < end; ++p) {
+            order[next[target[static_cast<std::ptrdiff_t>(p) * stride]]++] = static_cast<std::uint32_t>(p);
+        }
+    });
+    return offsets;
+}
+
+}  // namespace indexing_detail
+
+/**
+ * @brief dst = src with axis `axis` re-indexed: dst[.., j, ..] = src[.., indices[j], ..]
+ *
+ * dst.shape(axis) == indices.size(); all other extents match src.
+ */
+template<typename T, std::size_t Rank>
+void index_select(ConstView<T, Rank> src, std::size_t axis, std::span<const std::int32_t> indices,
+                  TensorView<T, Rank> dst, ThreadPool& pool = ThreadPool::global()) {
+    NN_PROFILE_ZONE("index_select");
+    NN_METRICS_KERNEL("index_select", 0, 2 * sizeof(T) * dst.size());
+    using namespace indexing_detail;
+    constexpr std::size_t last = Rank - 1;
+    const std::size_t width = dst.shape(last);
+    const Odometer<Rank> rows(dst.shape(), 1u << last);
+
+    if (axis == last) {
+        const bool fits = offsets_fit_int32(src, last, 0);
+        pool.parallel_ranges(rows.count(), [&](std::size_t begin, std::size_t end, std::size_t) {
+            Odometer<Rank> it = rows;
+            it.walk(begin, end, [&](const auto& index) {
+                gather_run(src.data() + src.offset(index), indices.data(), 1, src.stride(last), 0,
+                           dst.data() + dst.offset(index), dst.stride(last), width, fits);
+            });
+        });
+        return;
+    }
+
+    // Whole rows: one source row per destination row, prefetched ahead
+    const auto source_row = [&](std::array<std::size_t, Rank> index) {
+        index[axis] = static_cast<std::size_t>(indices[index[axis]]);
+        return src.data() + src.offset(index);
+    };
+    pool.parallel_ranges(rows.count(), [&](std::size_t begin, std::size_t end, std::size_t) {
+        Odometer<Rank> ahead = rows;
+        ahead.seek(begin);
+        std::size_t prefetched = begin;
+        for (; prefetched < std::min(end, begin + prefetch_rows); ++prefetched, ahead.next()) {
+            prefetch_row(source_row(ahead.index()), width);
+        }
+        Odometer<Rank> it = rows;
+        it.walk(begin, end, [&](const auto& index) {
+            if (prefetched < end) {
+                prefetch_row(source_row(ahead.index()), width);
+                ahead.next();
+                ++prefetched;
+            }
+            copy_run(source_row(index), src.stride(last), dst.data() + dst.offset(index), dst.stride(last), width);
+        });
+    });
+}
+
+/**
+ * @brief dst[p] = src[p with p[axis] = index[p]]; index has the shape of dst
+ */
+template<typename T, std::size_t Rank>
+void gather(ConstView<T, Rank> src, std::size_t axis, ConstView<std::int32_t, Rank> index,
+            TensorView<T, Rank> dst, ThreadPool& pool = ThreadPool::global()) {
+    NN_PROFILE_ZONE("gather");
+    NN_METRICS_KERNEL("gather", 0, (2 * sizeof(T) + sizeof(std::int32_t)) * dst.size());
+    using namespace indexing_detail;
+    constexpr std::size_t last = Rank - 1;
+    const std::size_t width = dst.shape(last);
+    const Odometer<Rank> rows(dst.shape(), 1u << last);
+    const std::ptrdiff_t scale = src.stride(axis);
+    const std::ptrdiff_t lane = axis == last ? 0 : src.stride(last);
+    const bool fits = offsets_fit_int32(src, axis, axis == last ? 0 : width);
+
+    pool.parallel_ranges(rows.count(), [&](std::size_t begin, std::size_t end, std::size_t) {
+        Odometer<Rank> it = rows;
+        it.walk(begin, end, [&](std::array<std::size_t, Rank> at) {
+            const std::int32_t* idx = index.data() + index.offset(at);
+            T* out = dst.data() + dst.offset(at);
+            at[axis] = 0;
+            gather_run(src.data() + src.offset(at), idx, index.stride(last), scale, lane, out, dst.stride(last),
+                       width, fits);
+        });
+    });
+}
+
+namespace indexing_detail {
+
+// Shared walk of scatter / scatter_add: op(dst_element, src_element). Each
+// task owns the destination lines of its fixed (non-axis) coordinates.
+template<typename T, std::size_t Rank, typename Op>
+void scatter_lines(TensorView<T, Rank> dst, std::size_t axis, ConstView<std::int32_t, Rank> index,
+                   ConstView<T, Rank> src, ThreadPool& pool, Op op) {
+    constexpr std::size_t last = Rank - 1;
+    if (axis == last) {
+        const Odometer<Rank> rows(src.shape(), 1u << last);
+        const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(src.shape(last));
+        pool.parallel_ranges(rows.count(), [&](std::size_t begin, std::size_t end, std::size_t) {
+            Odometer<Rank> it = rows;
+            it.walk(begin, end, [&](std::array<std::size_t, Rank> at) {
+                const std::int32_t* idx = index.data() + index.offset(at);
+                const T* in = src.data() + src.offset(at);
+                T* out = dst.data() + dst.offset(at);
+                for (std::ptrdiff_t j = 0; j < n; ++j) {
+                    op(out[idx[j * index.stride(last)] * dst.stride(last)], in[j * src.stride(last)]);
+                }
+            });
+        });
+        return;
+    }
+
+    // Lines along `axis` (a rank-1 view only has the last axis)
+    if constexpr (Rank > 1) {
+        // The last axis is cut into chunks across tasks
+        const Odometer<Rank> lines(src.shape(), (1u << axis) | (1u << last));
+        const std::size_t width = src.shape(last);
+        const std::size_t chunks = (width + column_chunk - 1) / column_chunk;
+        pool.parallel_for(lines.count() * chunks, [&](std::size_t task, std::size_t) {
+            Odometer<Rank> it = lines;
+            it.seek(task / chunks);
+            std::array<std::size_t, Rank> at = it.index();
+            const std::size_t j0 = (task % chunks) * column_chunk, j1 = std::min(width, j0 + column_chunk);
+            for (std::size_t k = 0; k < src.shape(axis); ++k) {
+                at[axis] = k;
+                at[last] = 0;
+                const std::int32_t* idx = index.data() + index.offset(at);
+                const T* in = src.data() + src.offset(at);
+                at[axis] = 0;
+                T* out = dst.data() + dst.offset(at);
+                for (std::size_t j = j0; j < j1; ++j) {
+                    const std::ptrdiff_t col = static_cast<std::ptrdiff_t>(j);
+                    op(out[idx[col * index.stride(last)] * dst.stride(axis) + col * dst.stride(last)],
+                       in[col * src.stride(last)]);
+                }
+            }
+        });
+    }
+}
+
+}  // namespace indexing_detail
+
+/**
+ * @brief dst[p with p[axis] = index[p]] = src[p]; index has the shape of src
+ *
+ * With duplicate targets in one line the last write wins.
+ */
+template<typename T, std::size_t Rank>
+void scatter(TensorView<T, Rank> dst, std::size_t axis, ConstView<std::int32_t, Rank> index,
+             ConstView<T, Rank> src, ThreadPool& pool = ThreadPool::global()) {
+    NN_PROFILE_ZONE("scatter");
+    NN_METRICS_KERNEL("scatter", 0, (2 * sizeof(T) + sizeof(std::int32_t)) * src.size());
+    indexing_detail::scatter_lines(dst, axis, index, src, pool, [](T& out, const T& in) { out = in; });
+}
+
+/**
+ * @brief dst[p with p[axis] = index[p]] += src[p], without atomics
+ *
+ * Many lines: tasks own disjoint destination lines. Few long lines along the
+ * last axis (e.g. 1-D histograms): sort-then-segment-reduce per line.
+ */
+template<typename T, std::size_t Rank>
+void scatter_add(TensorView<T, Rank> dst, std::size_t axis, ConstView<std::int32_t, Rank> index,
+                 ConstView<T, Rank> src, ThreadPool& pool = ThreadPool::global()) {
+    NN_PROFILE_ZONE("scatter_add");
+    NN_METRICS_KERNEL("scatter_add", src.size(), (3 * sizeof(T) + sizeof(std::int32_t)) * src.size());
+    if (src.size() == 0) return;
+    using namespace indexing_detail;
+    constexpr std::size_t last = Rank - 1;
+    const Odometer<Rank> rows(src.shape(), 1u << last);
+    if (axis != last || rows.count() >= pool.size()) {
+        scatter_lines(dst, axis, index, src, pool, [](T& out, const T& in) { out += in; });
+        return;
+    }
+
+    const std::size_t n = src.shape(last), targets = dst.shape(last);
+    std::vector<std::uint32_t> order;
+    Odometer<Rank> it = rows;
+    it.walk(0, rows.count(), [&](const auto& at) {
+        const std::int32_t* idx = index.data() + index.offset(at);
+        const T* in = src.data() + src.offset(at);
+        T* out = dst.data() + dst.offset(at);
+        const auto offsets = sort_by_target(idx, index.stride(last), n, targets, order, pool);
+        pool.parallel_ranges(targets, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t t = begin; t < end; ++t) {
+                T sum = out[static_cast<std::ptrdiff_t>(t) * dst.stride(last)];
+                for (std::size_t s = offsets[t]; s < offsets[t + 1]; ++s) sum += in[order[s] * src.stride(last)];
+                out[static_cast<std::ptrdiff_t>(t) * dst.stride(last)] = sum;
+            }
+        });
+    });
+}
+
+/**
+ * @brief dst[.., indices[k], ..] += src[.., k, ..] along axis, without atomics
+ *
+ * The slices are counting-sorted by target; each thread accumulates whole
+ * target slices, adding their sources in increasing k.
+ */
+template<typename T, std::size_t Rank>
+void index_add(TensorView<T, Rank> dst, std::size_t axis, std::span<const std::int32_t> indices,
+               ConstView<T, Rank> src, ThreadPool& pool = ThreadPool::global()) {
+    NN_PROFILE_ZONE("index_add");
+    NN_METRICS_KERNEL("index_add", src.size(), 3 * sizeof(T) * src.size());
+    if (src.size() == 0) return;
+    using namespace indexing_detail;
+    constexpr std::size_t last = Rank - 1;
+    std::vector<std::uint32_t> order;
+    const auto offsets = sort_by_target(indices.data(), 1, indices.size(), dst.shape(axis), order, pool);
+
+    // One slice = rows along the last axis (single elements when axis is last)
+    const Odometer<Rank> rows(src.shape(), (1u << axis) | (1u << last));
+    const std::size_t width = axis == last ? 1 : src.shape(last);
+    pool.parallel_ranges(dst.shape(axis), [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t t = begin; t < end; ++t) {
+            for (std::size_t s = offsets[t]; s < offsets[t + 1]; ++s) {
+                if (s + 1 < offsets[t + 1]) {
+                    prefetch_row(src.data() + static_cast<std::ptrdiff_t>(order[s + 1]) * src.stride(axis), width);
+                }
+                Odometer<Rank> it = rows;
+                it.walk(0, rows.count(), [&](std::array<std::size_t, Rank> at) {
+                    at[axis] = order[s];
+                    const T* in = src.data() + src.offset(at);
+                    at[axis] = t;
+                    add_run(in, src.stride(last), dst.data() + dst.offset(at), dst.stride(last), width);
+                });
+            }
+        }
+    });
+}
+
+// Tensor conveniences
+template<typename T, std::size_t... SrcDims, std::size_t... DstDims>
+void index_select(const Tensor<T, SrcDims...>& src, std::size_t axis, std::span<const std::int32_t> indices,
+                  Tensor<T, DstDims...>& dst, ThreadPool& pool = ThreadPool::global()) {
+    index_select(view(src), axis, indices, view(dst), pool);
+}
+
+template<typename T, std::size_t... SrcDims, std::size_t... Dims>
+void gather(const Tensor<T, SrcDims...>& src, std::size_t axis, const Tensor<std::int32_t, Dims...>& index,
+            Tensor<T, Dims...>& dst, ThreadPool& pool = ThreadPool::global()) {
+    gather(view(src), axis, view(index), view(dst), pool);
+}
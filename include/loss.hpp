@@ -0,0 +1,179 @@
+#pragma once
+
+#include "tensor.hpp"
+#include "thread_pool.hpp"
+#include "profiler.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+/**
+ * @brief Fused softmax + cross-entropy loss and gradient
+ *
+ * loss = logsumexp(x) - x[label] and dL/dx = softmax(x) - onehot(label),
+ * computed in two streaming passes over the logits without materializing
+ * probabilities:
+ *   1. online max/sum: per block of loss_block elements, take the block max,
+ *      rescale the running sum once if the max grew, then add exp(x - max)
+ *      (one exp per element, the block is still in L1 for the second loop)
+ *   2. gradient: exp(x - max) / sum - onehot, written straight to grad
+ * For float, exp is a branch-free Cephes-style polynomial (rel. error ~1e-7)
+ * that the compiler vectorizes, unlike the libm call.
+ */
+
+namespace loss_detail {
+
+constexpr std::size_t loss_block = 512;
+// Independent accumulator lanes let the reductions vectorize without -ffast-math
+constexpr std::size_t loss_lanes = 16;
+
+// exp(x) for x <= 0 as reached by (x - max); inputs below -87 (and -inf)
+// flush to ~1e-38. The clamp is done on the bit pattern with masks: float
+// compares count as control flow under -ftrapping-math and block vectorization.
+inline float fast_exp(float x) {
+    constexpr std::int32_t lo = std::bit_cast<std::int32_t>(-87.0f);
+    std::int32_t xi = std::bit_cast<std::int32_t>(x);
+    std::int32_t clamp = -static_cast<std::int32_t>((xi < 0) & (xi > lo));
+    x = std::bit_cast<float>((lo & clamp) | (xi & ~clamp));
+    // x = n * ln2 + r, |r| <= ln2 / 2; rounding via the 1.5 * 2^23 trick
+    float n = x * 1.44269504088896341f + 12582912.0f;
+    n -= 12582912.0f;
+    float r = x - n * 0.693359375f;
+    r -= n * -2.12194440e-4f;
+    float p = 1.9875691500e-4f;
+    p = p * r + 1.3981999507e-3f;
+    p = p * r + 8.3334519073e-3f;
+    p = p * r + 4.1665795894e-2f;
+    p = p * r + 1.6666665459e-1f;
+    p = p * r + 5.0000001201e-1f;
+    p = p * r * r + r + 1.0f;
+    std::int32_t bits = (static_cast<std::int32_t>(n) + 127) << 23;
+    return p * std::bit_cast<float>(bits);
+}
+
+template<typename T>
+inline T exp_kernel(T x) {
+    if constexpr (std::is_same_v<T, float>) {
+        return fast_exp(x);
+    } else {
+        return std::exp(x);
+    }
+}
+
+// Max of n (> 0, multiple of loss_lanes) values. Floats are compared as
+// order-preserving integer keys, which vectorize where float compares do not.
+template<typename T>
+inline T block_lane_max(const T* x, std::size_t n) {
+    if constexpr (std::is_same_v<T, float>) {
+        auto key = [](float v) {
+            std::int32_t i = std::bit_cast<std::int32_t>(v);
+            return i ^ ((i >> 31) & 0x7FFFFFFF);
+        };
+        std::int32_t lane_max[loss_lanes];
+        for (std::size_t l = 0; l < loss_lanes; ++l) lane_max[l] = key(x[0]);
+        for (std::size_t i = 0; i < n; i += loss_lanes) {
+            for (std::size_t l = 0; l < loss_lanes; ++l) {
+                lane_max[l] = std::max(lane_max[l], key(x[i + l]));
+            }
+        }
+        std::int32_t best = lane_max[0];
+        for (std::size_t l = 1; l < loss_lanes; ++l) best = std::max(best, lane_max[l]);
+        return std::bit_cast<float>(best ^ ((best >> 31) & 0x7FFFFFFF));
+    } else {
+        T best = x[0];
+        for (std::size_t i = 1; i < n; ++i) best = x[i] > best ? x[i] : best;
+        return best;
+    }
+}
+
+template<typename T>
+struct OnlineSoftmaxState {
+    T max = -std::numeric_limits<T>::infinity();
+    T sum = T(0);
+};
+
+template<typename T>
+inline OnlineSoftmaxState<T> online_max_sum(const T* logits, std::size_t vocab) {
+    OnlineSoftmaxState<T> state;
+    for (std::size_t begin = 0; begin < vocab; begin += loss_block) {
+        const std::size_t end = begin + loss_block < vocab ? begin + loss_block : vocab;
+        const std::size_t vec_end = begin + (end - begin) / loss_lanes * loss_lanes;
+
+        T block_max = block_lane_max(logits + begin, vec_end - begin);
+        for (std::size_t i = vec_end; i < end; ++i) {
+            block_max = logits[i] > block_max ? logits[i] : block_max;
+        }
+        if (block_max > state.max) {
+            state.sum *= std::exp(state.max - block_max);
+            state.max = block_max;
+        }
+
+        const T m = state.max;
+        T lane_sum[loss_lanes] = {};
+        for (std::size_t i = begin; i < vec_end; i += loss_lanes) {
+            for (std::size_t l = 0; l < loss_lanes; ++l) lane_sum[l] += exp_kernel(logits[i + l] - m);
+        }
+        T block_sum = T(0);
+        for (std::size_t l = 0; l < loss_lanes; ++l) block_sum += lane_sum[l];
+        for (std::size_t i = vec_end; i < end; ++i) block_sum += exp_kernel(logits[i] - m);
+        state.sum += block_sum;
+    }
+    return state;
+}
+
+}  // namespace loss_detail
+
+// Fused loss/gradient over one row of `vocab` logits; grad may not alias logits.
+// The gradient is multiplied by grad_scale (e.g. 1/batch for a mean loss).
+template<typename T>
+inline T softmax_cross_entropy_row(const T* logits, std::size_t vocab, std::size_t label,
+                                   T* grad_logits, T grad_scale = T(1)) {
+    NN_PROFILE_ZONE("softmax_cross_entropy");
+    NN_METRICS_KERNEL("softmax_cross_entropy", 4 * vocab, 3 * sizeof(T) * vocab);
+
+    const auto state = loss_detail::online_max_sum(logits, vocab);
+    const T m = state.max;
+    const T scale = grad_scale / state.sum;
+    for (std::size_t i = 0; i < vocab; ++i) {
+        grad_logits[i] = loss_detail::exp_kernel(logits[i] - m) * scale;
+    }
+    grad_logits[label] -= grad_scale;
+
+    return std::log(state.sum) + m - logits[label];
+}
+
+// Loss only (inference/evaluation): a single pass
+template<typename T>
+inline T cross_entropy_row(const T* logits, std::size_t vocab, std::size_t label) {
+    const auto state = loss_detail::online_max_sum(logits, vocab);
+    return std::log(state.sum) + state.max - logits[label];
+}
+
+template<typename T, std::size_t Vocab>
+T softmax_cross_entropy(const Tensor<T, Vocab>& logits, std::size_t label,
+                        Tensor<T, Vocab>& grad_logits) {
+    return softmax_cross_entropy_row(logits.data(), Vocab, label, grad_logits.data());
+}
+
+// Batched mean loss; rows are independent and run in parallel on the pool
+template<typename T, std::size_t Batch, std::size_t Vocab>
+T softmax_cross_entropy(const Tensor<T, Batch, Vocab>& logits,
+                        const std::array<std::size_t, Batch>& labels,
+                        Tensor<T, Batch, Vocab>& grad_logits,
+                        ThreadPool& pool = ThreadPool::global()) {
+    std::array<T, Batch> row_loss{};
+    const T inv_batch = T(1) / static_cast<T>(Batch);
+    pool.parallel_for(Batch, [&](std::size_t b, std::size_t) {
+        row_loss[b] = softmax_cross_entropy_row(logits.data() + b * Vocab, Vocab, labels[b],
+                                                grad_logits.data() + b * Vocab, inv_batch);
+    });
+    T total = T(0);
+    for (std::size_t b = 0; b < Batch; ++b) total += row_loss[b];
+    return total * inv_batch;
+}
@@ -0,0 +1,282 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Live tensor memory accounting
+ *
+ * Tensor storage is a std::array, so a Tensor lives wherever its owner puts
+ * it. Large weights, activations and scratch buffers can be moved to the heap
+ * through the opt-in TrackingAllocator / make_tracked(), which tag every
+ * allocation with its owning layer and purpose. MemoryTracker keeps current
+ * and peak bytes per tag (and in total) with lock-free counters, and can dump
+ * a snapshot or the list of tags that still hold memory (leaks) on demand.
+ */
+
+namespace nn_memory {
+
+enum class MemoryPurpose { Weights, Activations, Workspace, Other };
+
+inline const char* purpose_name(MemoryPurpose purpose) {
+    switch (purpose) {
+        case MemoryPurpose::Weights: return "weights";
+        case MemoryPurpose::Activations: return "activations";
+        case MemoryPurpose::Workspace: return "workspace";
+        default: return "other";
+    }
+}
+
+/**
+ * @brief Byte counters of one (owner, purpose) tag
+ */
+class TagStats {
+private:
+    std::string owner_;
+    MemoryPurpose purpose_;
+    std::atomic<std::int64_t> current_{0};
+    std::atomic<std::int64_t> peak_{0};
+    std::atomic<std::uint64_t> allocations_{0};
+    std::atomic<std::uint64_t> frees_{0};
+
+public:
+    TagStats(std::string owner, MemoryPurpose purpose)
+        : owner_(std::move(owner)), purpose_(purpose) {}
+
+    // Returns the new current byte count
+    std::int64_t on_allocate(std::size_t bytes) {
+        std::int64_t now = current_.fetch_add(static_cast<std::int64_t>(bytes),
+                                              std::memory_order_relaxed) +
+                           static_cast<std::int64_t>(bytes);
+        std::int64_t peak = peak_.load(std::memory_order_relaxed);
+        while (now > peak && !peak_.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+        }
+        allocations_.fetch_add(1, std::memory_order_relaxed);
+        return now;
+    }
+
+    void on_deallocate(std::size_t bytes) {
+        current_.fetch_sub(static_cast<std::int64_t>(bytes), std::memory_order_relaxed);
+        frees_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void reset_peak() { peak_.store(current_.load(std::memory_order_relaxed)); }
+
+    const std::string& owner() const { return owner_; }
+    MemoryPurpose purpose() const { return purpose_; }
+    std::int64_t current_bytes() const { return current_.load(std::memory_order_relaxed); }
+    std::int64_t peak_bytes() const { return peak_.load(std::memory_order_relaxed); }
+    std::uint64_t allocations() const { return allocations_.load(std::memory_order_relaxed); }
+    std::uint64_t frees() const { return frees_.load(std::memory_order_relaxed); }
+};
+
+struct MemorySnapshotEntry {
+    std::string owner;
+    MemoryPurpose purpose;
+    std::int64_t current_bytes;
+    std::int64_t peak_bytes;
+    std::uint64_t allocations;
+    std::uint64_t frees;
+};
+
+/**
+ * @brief Process-wide registry of tagged allocation counters
+ */
+class MemoryTracker {
+private:
+    mutable std::mutex mutex_;
+    std::map<std::pair<std::string, MemoryPurpose>, std::unique_ptr<TagStats>> tags_;
+    TagStats total_{"total", MemoryPurpose::Other};
+
+    MemoryTracker() = default;
+
+public:
+    static MemoryTracker& instance() {
+        static MemoryTracker tracker;
+        return tracker;
+    }
+
+    MemoryTracker(const MemoryTracker&) = delete;
+    MemoryTracker& operator=(const MemoryTracker&) = delete;
+
+    // Tags are never removed, so the returned stats stay valid
+    TagStats& tag(const std::string& owner, MemoryPurpose purpose) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& slot = tags_[{owner, purpose}];
+        if (!slot) slot = std::make_unique<TagStats>(owner, purpose);
+        return *slot;
+    }
+
+    void on_allocate(TagStats& stats, std::size_t bytes) {
+        stats.on_allocate(bytes);
+        total_.on_allocate(bytes);
+    }
+
+    void on_deallocate(TagStats& stats, std::size_t bytes) {
+        stats.on_deallocate(bytes);
+        total_.on_deallocate(bytes);
+    }
+
+    std::int64_t current_bytes() const { return total_.current_bytes(); }
+    std::int64_t peak_bytes() const { return total_.peak_bytes(); }
+
+    // Restart peak tracking from the current footprint (e.g. per training step)
+    void reset_peaks() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& [key, stats] : tags_) stats->reset_peak();
+        total_.reset_peak();
+    }
+
+    std::vector<MemorySnapshotEntry> snapshot() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<MemorySnapshotEntry> entries;
+        entries.reserve(tags_.size());
+        for (const auto& [key, stats] : tags_) {
+            entries.push_back({stats->owner(), stats->purpose(), stats->current_bytes(),
+                               stats->peak_bytes(), stats->allocations(), stats->frees()});
+        }
+        return entries;
+    }
+
+    void dump(std::ostream& out = std::cout) const {
+        auto entries = snapshot();
+        out << "\nTensor Memory Snapshot:\n";
+        out << "  " << std::left << std::setw(32) << "Owner" << std::setw(13) << "Purpose"
+            << std::right << std::setw(14) << "Current (B)" << std::setw(14) << "Peak (B)"
+            << std::setw(10) << "Allocs" << std::setw(10) << "Frees" << "\n";
+        out << "  " << std::string(91, '-') << "\n";
+        for (const auto& e : entries) {
+            out << "  " << std::left << std::setw(32) << e.owner << std::setw(13)
+                << purpose_name(e.purpose) << std::right << std::setw(14) << e.current_bytes
+                << std::setw(14) << e.peak_bytes << std::setw(10) << e.allocations
+                << std::setw(10) << e.frees << "\n";
+        }
+        out << "  " << std::left << std::setw(45) << "Total" << std::right << std::setw(14)
+            << current_bytes() << std::setw(14) << peak_bytes() << "\n";
+    }
+
+    // Tags that still hold memory; at shutdown these are leaks
+    std::vector<MemorySnapshotEntry> live() const {
+        std::vector<MemorySnapshotEntry> entries;
+        for (auto& e : snapshot()) {
+            if (e.current_bytes != 0) entries.push_back(e);
+        }
+        return entries;
+    }
+};
+
+namespace detail {
+inline thread_local const char* current_owner = "unowned";
+}
+
+/**
+ * @brief Sets the default owner for tagged allocations on this thread
+ */
+class MemoryOwnerScope {
+private:
+    const char* previous_;
+
+public:
+    explicit MemoryOwnerScope(const char* owner) : previous_(detail::current_owner) {
+        detail::current_owner = owner;
+    }
+    ~MemoryOwnerScope() { detail::current_owner = previous_; }
+
+    MemoryOwnerScope(const MemoryOwnerScope&) = delete;
+    MemoryOwnerScope& operator=(const MemoryOwnerScope&) = delete;
+};
+
+/**
+ * @brief Standard allocator that accounts its bytes to one tag
+ *
+ * Usable with any allocator-aware container:
+ *   std::vector<float, TrackingAllocator<float>> buf(n, TrackingAllocator<float>(MemoryPurpose::Workspace));
+ */
+template<typename T>
+class TrackingAllocator {
+private:
+    TagStats* stats_;
+
+    template<typename U>
+    friend class TrackingAllocator;
+
+public:
+    using value_type = T;
+
+    explicit TrackingAllocator(MemoryPurpose purpose = MemoryPurpose::Other)
+        : stats_(&MemoryTracker::instance().tag(detail::current_owner, purpose)) {}
+
+    TrackingAllocator(const std::string& owner, MemoryPurpose purpose)
+        : stats_(&MemoryTracker::instance().tag(owner, purpose)) {}
+
+    // Account to an already looked-up tag (no registry lookup)
+    explicit TrackingAllocator(TagStats& stats) noexcept : stats_(&stats) {}
+
+    template<typename U>
+    TrackingAllocator(const TrackingAllocator<U>& other) noexcept : stats_(other.stats_) {}
+
+    T* allocate(std::size_t n) {
+        std::size_t bytes = n * sizeof(T);
+        T* p = static_cast<T*>(::operator new(bytes, std::align_val_t(alignof(T) > 64 ? alignof(T) : 64)));
+        MemoryTracker::instance().on_allocate(*stats_, bytes);
+        return p;
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        MemoryTracker::instance().on_deallocate(*stats_, n * sizeof(T));
+        ::operator delete(p, std::align_val_t(alignof(T) > 64 ? alignof(T) : 64));
+    }
+
+    TagStats& stats() const { return *stats_; }
+
+    template<typename U>
+    bool operator==(const TrackingAllocator<U>& other) const { return stats_ == other.stats_; }
+};
+
+/**
+ * @brief Deleter for objects created by make_tracked()
+ */
+template<typename T>
+struct TrackedDeleter {
+    TrackingAllocator<T> allocator;
+
+    void operator()(T* p) const noexcept {
+        p->~T();
+        TrackingAllocator<T>(allocator).deallocate(p, 1);
+    }
+};
+
+template<typename T>
+using TrackedPtr = std::unique_ptr<T, TrackedDeleter<T>>;
+
+/**
+ * @brief Construct a T (typically a Tensor or layer) on the heap, accounted to a tag
+ */
+template<typename T, typename... Args>
+TrackedPtr<T> make_tracked(TrackingAllocator<T> allocator, Args&&... args) {
+    T* p = allocator.allocate(1);
+    try {
+        ::new (static_cast<void*>(p)) T(std::forward<Args>(args)...);
+    } catch (...) {
+        allocator.deallocate(p, 1);
+        throw;
+    }
+    return TrackedPtr<T>(p, TrackedDeleter<T>{allocator});
+}
+
+template<typename T, typename... Args>
+TrackedPtr<T> make_tracked(MemoryPurpose purpose, Args&&... args) {
+    return make_tracked<T>(TrackingAllocator<T>(purpose), std::forward<Args>(args)...);
+}
+
+}  // namespace nn_memory
@@ -0,0 +1,556 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * @brief Production metrics for inference kernels
+ *
+ * Counters (calls, FLOPs, bytes) and a latency histogram are kept per
+ * (model, layer type) series. Every series is split into cache-line aligned
+ * per-thread shards, so the hot path is one relaxed atomic add on a line no
+ * other thread writes; shards are summed only when the metrics are scraped.
+ * Queue depth is a per-model gauge plus a histogram of observed depths.
+ *
+ * render_prometheus() produces the Prometheus text exposition format, which
+ * MetricsServer serves on a local port and MetricsFileWriter writes to a file
+ * periodically (e.g. for the node_exporter textfile collector).
+ *
+ * Kernel instrumentation (NN_METRICS_KERNEL) compiles to nothing unless
+ * NN_META_ENABLE_METRICS is defined (CMake option NN_META_METRICS).
+ */
+
+namespace nn_metrics {
+
+constexpr std::size_t kShards = 32;
+constexpr std::size_t kLatencyBuckets = 24;  // 1us .. 2^22us (~4s), then +Inf
+constexpr std::size_t kDepthBuckets = 12;    // 0, 1, 2, 4 .. 1024, then +Inf
+
+namespace detail {
+
+inline std::size_t this_thread_shard() {
+    static std::atomic<std::size_t> next{0};
+    thread_local const std::size_t shard = next.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return shard;
+}
+
+// Bucket i holds latencies <= 2^i microseconds
+inline std::size_t latency_bucket(std::uint64_t ns) {
+    std::uint64_t us = (ns + 999) / 1000;
+    std::size_t bucket = 0;
+    while (bucket < kLatencyBuckets && (std::uint64_t(1) << bucket) < us) ++bucket;
+    return bucket;
+}
+
+// Bucket 0 holds depth 0, bucket i > 0 holds depths <= 2^(i-1)
+inline std::size_t depth_bucket(std::int64_t depth) {
+    if (depth <= 0) return 0;
+    std::size_t bucket = 1;
+    while (bucket < kDepthBuckets && (std::int64_t(1) << (bucket - 1)) < depth) ++bucket;
+    return bucket;
+}
+
+inline std::string escape_label(const std::string& value) {
+    std::string out;
+    for (char c : value) {
+        if (c == '\\' || c == '"') out += '\\';
+        if (c == '\n') { out += "\\n"; continue; }
+        out += c;
+    }
+    return out;
+}
+
+inline std::string format_double(double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.9g", value);
+    return buf;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Sharded counters and latency histogram of one (model, layer) series
+ */
+class KernelSeries {
+private:
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> calls{0};
+        std::atomic<std::uint64_t> flops{0};
+        std::atomic<std::uint64_t> bytes{0};
+        std::atomic<std::uint64_t> latency_ns{0};
+        std::array<std::atomic<std::uint64_t>, kLatencyBuckets + 1> buckets{};
+    };
+
+    std::string model_;
+    std::string layer_;
+    std::array<Shard, kShards> shards_;
+
+public:
+    struct Snapshot {
+        std::uint64_t calls = 0;
+        std::uint64_t flops = 0;
+        std::uint64_t bytes = 0;
+        std::uint64_t latency_ns = 0;
+        std::array<std::uint64_t, kLatencyBuckets + 1> buckets{};
+    };
+
+    KernelSeries(std::string model, std::string layer)
+        : model_(std::move(model)), layer_(std::move(layer)) {}
+
+    void record(std::uint64_t latency_ns, std::uint64_t flops, std::uint64_t bytes) {
+        Shard& shard = shards_[detail::this_thread_shard()];
+        shard.calls.fetch_add(1, std::memory_order_relaxed);
+        shard.flops.fetch_add(flops, std::memory_order_relaxed);
+        shard.bytes.fetch_add(bytes, std::memory_order_relaxed);
+        shard.latency_ns.fetch_add(latency_ns, std::memory_order_relaxed);
+        shard.buckets[detail::latency_bucket(latency_ns)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Snapshot snapshot() const {
+        Snapshot total;
+        for (const auto& shard : shards_) {
+            total.calls += shard.calls.load(std::memory_order_relaxed);
+            total.flops += shard.flops.load(std::memory_order_relaxed);
+            total.bytes += shard.bytes.load(std::memory_order_relaxed);
+            total.latency_ns += shard.latency_ns.load(std::memory_order_relaxed);
+            for (std::size_t i = 0; i <= kLatencyBuckets; ++i) {
+                total.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+            }
+        }
+        return total;
+    }
+
+    const std::string& model() const { return model_; }
+    const std::string& layer() const { return layer_; }
+};
+
+/**
+ * @brief Queue depth gauge of one model, with a histogram of observed depths
+ */
+class QueueSeries {
+private:
+    std::string model_;
+    std::atomic<std::int64_t> depth_{0};
+    std::array<std::atomic<std::uint64_t>, kDepthBuckets + 1> buckets_{};
+    std::atomic<std::uint64_t> observations_{0};
+    std::atomic<std::uint64_t> depth_sum_{0};
+
+public:
+    explicit QueueSeries(std::string model) : model_(std::move(model)) {}
+
+    // Adjust the gauge and record the depth seen by this enqueue/dequeue
+    void add(std::int64_t delta) {
+        std::int64_t depth = depth_.fetch_add(delta, std::memory_order_relaxed) + delta;
+        buckets_[detail::depth_bucket(depth)].fetch_add(1, std::memory_order_relaxed);
+        observations_.fetch_add(1, std::memory_order_relaxed);
+        depth_sum_.fetch_add(static_cast<std::uint64_t>(depth > 0 ? depth : 0),
+                             std::memory_order_relaxed);
+    }
+
+    std::int64_t depth() const { return depth_.load(std::memory_order_relaxed); }
+    std::uint64_t observations() const { return observations_.load(std::memory_order_relaxed); }
+    std::uint64_t depth_sum() const { return depth_sum_.load(std::memory_order_relaxed); }
+    std::uint64_t bucket(std::size_t i) const { return buckets_[i].load(std::memory_order_relaxed); }
+    const std::string& model() const { return model_; }
+};
+
+/**
+ * @brief Process-wide registry of metric series
+ */
+class MetricsRegistry {
+private:
+    mutable std::mutex mutex_;
+    std::map<std::pair<std::string, std::string>, std::unique_ptr<KernelSeries>> kernels_;
+    std::map<std::string, std::unique_ptr<QueueSeries>> queues_;
+
+    MetricsRegistry() = default;
+
+public:
+    static MetricsRegistry& instance() {
+        static MetricsRegistry registry;
+        return registry;
+    }
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    // Series are never removed, so returned references stay valid
+    KernelSeries& kernel(const std::string& model, const std::string& layer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& slot = kernels_[{model, layer}];
+        if (!slot) slot = std::make_unique<KernelSeries>(model, layer);
+        return *slot;
+    }
+
+    QueueSeries& queue(const std::string& model) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& slot = queues_[model];
+        if (!slot) slot = std::make_unique<QueueSeries>(model);
+        return *slot;
+    }
+
+    std::string render_prometheus() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::ostringstream out;
+
+        std::map<std::pair<std::string, std::string>, KernelSeries::Snapshot> snapshots;
+        for (const auto& [key, series] : kernels_) snapshots[key] = series->snapshot();
+
+        auto labels = [](const std::pair<std::string, std::string>& key) {
+            return "model=\"" + detail::escape_label(key.first) + "\",layer=\"" +
+                   detail::escape_label(key.second) + "\"";
+        };
+        auto counter = [&](const char* name, const char* help,
+                           std::uint64_t KernelSeries::Snapshot::*field) {
+            out << "# HELP " << name << ' ' << help << '\n';
+            out << "# TYPE " << name << " counter\n";
+            for (const auto& [key, snap] : snapshots) {
+                out << name << '{' << labels(key) << "} " << snap.*field << '\n';
+            }
+        };
+        counter("nn_kernel_calls_total", "Kernel invocations.", &KernelSeries::Snapshot::calls);
+        counter("nn_kernel_flops_total", "Floating point operations executed by kernels.",
+                &KernelSeries::Snapshot::flops);
+        counter("nn_kernel_bytes_total", "Bytes read and written by kernels.",
+                &KernelSeries::Snapshot::bytes);
+
+        out << "# HELP nn_kernel_latency_seconds Kernel latency.\n";
+        out << "# TYPE nn_kernel_latency_seconds histogram\n";
+        for (const auto& [key, snap] : snapshots) {
+            std::uint64_t cumulative = 0;
+            for (std::size_t i = 0; i < kLatencyBuckets; ++i) {
+                cumulative += snap.buckets[i];
+                out << "nn_kernel_latency_seconds_bucket{" << labels(key) << ",le=\""
+                    << detail::format_double(double(std::uint64_t(1) << i) * 1e-6) << "\"} "
+                    << cumulative << '\n';
+            }
+            out << "nn_kernel_latency_seconds_bucket{" << labels(key) << ",le=\"+Inf\"} "
+                << snap.calls << '\n';
+            out << "nn_kernel_latency_seconds_sum{" << labels(key) << "} "
+                << detail::format_double(double(snap.latency_ns) * 1e-9) << '\n';
+            out << "nn_kernel_latency_seconds_count{" << labels(key) << "} " << snap.calls << '\n';
+        }
+
+        if (!queues_.empty()) {
+            out << "# HELP nn_queue_depth Requests waiting for execution.\n";
+            out << "# TYPE nn_queue_depth gauge\n";
+            for (const auto& [model, series] : queues_) {
+                out << "nn_queue_depth{model=\"" << detail::escape_label(model) << "\"} "
+                    << series->depth() << '\n';
+            }
+            out << "# HELP nn_queue_depth_observed Queue depth seen at enqueue/dequeue.\n";
+            out << "# TYPE nn_queue_depth_observed histogram\n";
+            for (const auto& [model, series] : queues_) {
+                std::string label = "model=\"" + detail::escape_label(model) + "\"";
+                std::uint64_t cumulative = 0;
+                for (std::size_t i = 0; i < kDepthBuckets; ++i) {
+                    cumulative += series->bucket(i);
+                    std::int64_t le = i == 0 ? 0 : (std::int64_t(1) << (i - 1));
+                    out << "nn_queue_depth_observed_bucket{" << label << ",le=\"" << le << "\"} "
+                        << cumulative << '\n';
+                }
+                out << "nn_queue_depth_observed_bucket{" << label << ",le=\"+Inf\"} "
+                    << series->observations() << '\n';
+                out << "nn_queue_depth_observed_sum{" << label << "} " << series->depth_sum() << '\n';
+                out << "nn_queue_depth_observed_count{" << label << "} "
+                    << series->observations() << '\n';
+            }
+        }
+        return out.str();
+    }
+};
+
+namespace detail {
+
+inline thread_local const char* current_model = "default";
+
+// Per-thread cache of (model, layer) -> series, keyed by the literal pointers
+inline KernelSeries& kernel_series(const char* layer) {
+    struct Key {
+        const char* model;
+        const char* layer;
+        bool operator==(const Key& other) const {
+            return model == other.model && layer == other.layer;
+        }
+    };
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const {
+            return std::hash<const void*>{}(key.model) * 31 + std::hash<const void*>{}(key.layer);
+        }
+    };
+    thread_local std::unordered_map<Key, KernelSeries*, KeyHash> cache;
+    Key key{current_model, layer};
+    auto it = cache.find(key);
+    if (it == cache.end()) {
+        it = cache.emplace(key, &MetricsRegistry::instance().kernel(key.model, key.layer)).first;
+    }
+    return *it->second;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Attributes kernel metrics on this thread to a model while alive
+ *
+ * The name must outlive the scope (string literals or long-lived model names).
+ */
+class ModelScope {
+private:
+    const char* previous_;
+
+public:
+    explicit ModelScope(const char* model) : previous_(detail::current_model) {
+        detail::current_model = model;
+    }
+    ~ModelScope() { detail::current_model = previous_; }
+
+    ModelScope(const ModelScope&) = delete;
+    ModelScope& operator=(const ModelScope&) = delete;
+};
+
+inline void queue_depth_add(const std::string& model, std::int64_t delta) {
+    MetricsRegistry::instance().queue(model).add(delta);
+}
+
+inline std::string render_prometheus() {
+    return MetricsRegistry::instance().render_prometheus();
+}
+
+/**
+ * @brief Times one kernel call and records it on destruction
+ *
+ * Literal type so that it can sit inside constexpr kernels; it only reads the
+ * clock when evaluated at runtime.
+ */
+class KernelMetricGuard {
+private:
+    const char* layer_;
+    std::uint64_t flops_;
+    std::uint64_t bytes_;
+    std::int64_t start_ns_ = 0;
+
+    static std::int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+public:
+    constexpr KernelMetricGuard(const char* layer, std::uint64_t flops, std::uint64_t bytes)
+        : layer_(layer), flops_(flops), bytes_(bytes) {
+        if (!std::is_constant_evaluated()) start_ns_ = now_ns();
+    }
+
+    constexpr ~KernelMetricGuard() {
+        if (!std::is_constant_evaluated()) {
+            std::int64_t elapsed = now_ns() - start_ns_;
+            detail::kernel_series(layer_).record(static_cast<std::uint64_t>(elapsed > 0 ? elapsed : 0),
+                                                 flops_, bytes_);
+        }
+    }
+
+    KernelMetricGuard(const KernelMetricGuard&) = delete;
+    KernelMetricGuard& operator=(const KernelMetricGuard&) = delete;
+};
+
+/**
+ * @brief Serves render_prometheus() over HTTP on a local port
+ */
+class MetricsServer {
+private:
+    int listen_fd_ = -1;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+
+    void serve() {
+        while (running_.load()) {
+            pollfd pfd{listen_fd_, POLLIN, 0};
+            if (poll(&pfd, 1, 200) <= 0) continue;
+            int client = accept(listen_fd_, nullptr, nullptr);
+            if (client < 0) continue;
+
+            // Any request gets the metrics page; read and discard the request head
+            char request[1024];
+            pollfd cfd{client, POLLIN, 0};
+            if (poll(&cfd, 1, 1000) > 0) {
+                (void)recv(client, request, sizeof(request), 0);
+            }
+            std::string body = render_prometheus();
+            std::string response =
+                "HTTP/1.0 200 OK\r\n"
+                "Content-Type: text/plain; version=0.0.4\r\n"
+                "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                "Connection: close\r\n\r\n" + body;
+            std::size_t sent = 0;
+            while (sent < response.size()) {
+                ssize_t n = send(client, response.data() + sent, response.size() - sent, 0);
+                if (n <= 0) break;
+                sent += static_cast<std::size_t>(n);
+            }
+            close(client);
+        }
+    }
+
+public:
+    MetricsServer() = default;
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+    ~MetricsServer() { stop(); }
+
+    // Bind to 127.0.0.1:port (0 picks a free port); returns false on failure
+    bool start(std::uint16_t port) {
+        if (running_.load()) return false;
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_fd_ < 0) return false;
+        int reuse = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            listen(listen_fd_, 16) != 0) {
+            close(listen_fd_);
+            listen_fd_ = -1;
+            return false;
+        }
+        running_.store(true);
+        thread_ = std::thread([this] { serve(); });
+        return true;
+    }
+
+    void stop() {
+        if (!running_.exchange(false)) return;
+        if (thread_.joinable()) thread_.join();
+        close(listen_fd_);
+        listen_fd_ = -1;
+    }
+
+    std::uint16_t port() const {
+        sockaddr_in addr{};
+        socklen_t len = sizeof(addr);
+        if (listen_fd_ < 0 ||
+            getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+            return 0;
+        }
+        return ntohs(addr.sin_port);
+    }
+};
+
+/**
+ * @brief Periodically writes render_prometheus() to a file (atomically, via rename)
+ */
+class MetricsFileWriter {
+private:
+    std::string path_;
+    std::chrono::milliseconds interval_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+    std::thread thread_;
+
+public:
+    MetricsFileWriter(std::string path, std::chrono::milliseconds interval)
+        : path_(std::move(path)), interval_(interval) {
+        thread_ = std::thread([this] {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!cv_.wait_for(lock, interval_, [this] { return stopping_; })) {
+                lock.unlock();
+                write_now();
+                lock.lock();
+            }
+        });
+    }
+
+    MetricsFileWriter(const MetricsFileWriter&) = delete;
+    MetricsFileWriter& operator=(const MetricsFileWriter&) = delete;
+
+    // Stops the writer thread and writes a final snapshot
+    ~MetricsFileWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+        write_now();
+    }
+
+    bool write_now() const {
+        std::string tmp = path_ + ".tmp";
+        {
+            std::ofstream out(tmp);
+            if (!out) return false;
+            out << render_prometheus();
+            if (!out) return false;
+        }
+        return std::rename(tmp.c_str(), path_.c_str()) == 0;
+    }
+};
+
+/**
+ * @brief Starts the exporters requested by the environment for its lifetime
+ *
+ * NN_META_METRICS_PORT serves metrics on 127.0.0.1:<port>; NN_META_METRICS_FILE
+ * writes them every NN_META_METRICS_INTERVAL_MS (default 5000) and on exit.
+ */
+class ScopedMetricsExport {
+private:
+    std::unique_ptr<MetricsServer> server_;
+    std::unique_ptr<MetricsFileWriter> writer_;
+
+public:
+    static ScopedMetricsExport from_env() {
+        ScopedMetricsExport exporter;
+        if (const char* port = std::getenv("NN_META_METRICS_PORT")) {
+            exporter.server_ = std::make_unique<MetricsServer>();
+            if (!exporter.server_->start(static_cast<std::uint16_t>(std::atoi(port)))) {
+                exporter.server_.reset();
+            }
+        }
+        if (const char* path = std::getenv("NN_META_METRICS_FILE")) {
+            const char* interval = std::getenv("NN_META_METRICS_INTERVAL_MS");
+            int ms = interval != nullptr ? std::atoi(interval) : 5000;
+            exporter.writer_ = std::make_unique<MetricsFileWriter>(
+                path, std::chrono::milliseconds(ms > 0 ? ms : 5000));
+        }
+        return exporter;
+    }
+
+    const MetricsServer* server() const { return server_.get(); }
+};
+
+}  // namespace nn_metrics
+
+#define NN_METRICS_CONCAT_IMPL(a, b) a##b
+#define NN_METRICS_CONCAT(a, b) NN_METRICS_CONCAT_IMPL(a, b)
+
+#ifdef NN_META_ENABLE_METRICS
+#define NN_METRICS_KERNEL(layer, flops, bytes) \
+    ::nn_metrics::KernelMetricGuard NN_METRICS_CONCAT(nn_kernel_metric_, __LINE__) { \
+        layer, static_cast<std::uint64_t>(flops), static_cast<std::uint64_t>(bytes) }
+#else
+#define NN_METRICS_KERNEL(layer, flops, bytes) ((void)0)
+#endif
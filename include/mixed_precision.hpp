@@ -0,0 +1,236 @@
+#pragma once
+
+#include "tensor.hpp"
+#include "nn_compiler.hpp"
+#include "memory_tracker.hpp"
+#include "profiler.hpp"
+#include "metrics.hpp"
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief BF16 mixed-precision training with dynamic loss scaling
+ *
+ * Activations and a working copy of the weights are stored as bfloat16 (the
+ * upper half of an IEEE float), halving their memory and bandwidth. Every
+ * product is accumulated in FP32, and the optimizer keeps FP32 master weights
+ * in the wrapped LinearLayer. The loss gradient is multiplied by a dynamic
+ * loss scale so small gradients survive. Unscaling and the overflow (inf/nan)
+ * check ride along the last gradient accumulation pass, and the SGD update is
+ * fused with the BF16 weight refresh in one more pass over the parameters.
+ * Overflowing steps are skipped and the scale backs off.
+ */
+
+/**
+ * @brief Brain floating point: 1 sign, 8 exponent, 7 mantissa bits
+ */
+struct bfloat16 {
+    std::uint16_t bits = 0;
+
+    constexpr bfloat16() = default;
+
+    // Round to nearest even; NaN stays a (quiet) NaN
+    constexpr explicit bfloat16(float value) : bits(from_float_bits(std::bit_cast<std::uint32_t>(value))) {}
+
+    constexpr operator float() const { return std::bit_cast<float>(static_cast<std::uint32_t>(bits) << 16); }
+
+    static constexpr std::uint16_t from_float_bits(std::uint32_t u) {
+        std::uint32_t rounded = (u + 0x7FFFu + ((u >> 16) & 1u)) >> 16;
+        std::uint32_t quiet_nan = (u >> 16) | 0x40u;
+        return static_cast<std::uint16_t>((u & 0x7FFFFFFFu) > 0x7F800000u ? quiet_nan : rounded);
+    }
+};
+
+static_assert(sizeof(bfloat16) == 2, "bfloat16 must be 16 bits");
+
+// Elementwise FP32 -> BF16 (plain integer ops, so the loop vectorizes)
+inline void to_bfloat16(const float* src, bfloat16* dst, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        dst[i].bits = bfloat16::from_float_bits(std::bit_cast<std::uint32_t>(src[i]));
+    }
+}
+
+template<std::size_t... Dims>
+Tensor<bfloat16, Dims...> to_bfloat16(const Tensor<float, Dims...>& src) {
+    Tensor<bfloat16, Dims...> dst;
+    to_bfloat16(src.data(), dst.data(), src.size());
+    return dst;
+}
+
+namespace mp_detail {
+
+constexpr std::size_t dot_lanes = 16;
+
+// FP32-accumulated BF16 dot product with independent lanes
+inline float dot(const bfloat16* a, const bfloat16* b, std::size_t n) {
+    float lane[dot_lanes] = {};
+    const std::size_t vec_end = n / dot_lanes * dot_lanes;
+    for (std::size_t i = 0; i < vec_end; i += dot_lanes) {
+        for (std::size_t l = 0; l < dot_lanes; ++l) lane[l] += float(a[i + l]) * float(b[i + l]);
+    }
+    float sum = 0.0f;
+    for (std::size_t l = 0; l < dot_lanes; ++l) sum += lane[l];
+    for (std::size_t i = vec_end; i < n; ++i) sum += float(a[i]) * float(b[i]);
+    return sum;
+}
+
+// Exponent all ones: inf or nan
+inline std::uint32_t non_finite(float value) {
+    return (std::bit_cast<std::uint32_t>(value) & 0x7F800000u) == 0x7F800000u;
+}
+
+}  // namespace mp_detail
+
+/**
+ * @brief Dynamic loss scale: back off on overflow, grow after a clean streak
+ */
+class DynamicLossScaler {
+public:
+    static constexpr float max_scale = 16777216.0f;  // 2^24
+
+private:
+    float scale_;
+    float growth_factor_;
+    float backoff_factor_;
+    std::size_t growth_interval_;
+    std::size_t clean_steps_ = 0;
+    std::size_t skipped_steps_ = 0;
+
+public:
+    explicit DynamicLossScaler(float initial_scale = 65536.0f, std::size_t growth_interval = 2000,
+                               float growth_factor = 2.0f, float backoff_factor = 0.5f)
+        : scale_(initial_scale), growth_factor_(growth_factor), backoff_factor_(backoff_factor),
+          growth_interval_(growth_interval) {}
+
+    float scale() const { return scale_; }
+    std::size_t skipped_steps() const { return skipped_steps_; }
+
+    // Record one step's outcome; returns whether its update may be applied
+    bool update(bool overflow) {
+        if (overflow) {
+            scale_ *= backoff_factor_;
+            if (scale_ < 1.0f) scale_ = 1.0f;
+            clean_steps_ = 0;
+            ++skipped_steps_;
+            return false;
+        }
+        if (++clean_steps_ == growth_interval_) {
+            if (scale_ * growth_factor_ < max_scale) scale_ *= growth_factor_;
+            clean_steps_ = 0;
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Mixed-precision SGD for a LinearLayer head (MSE loss)
+ *
+ * The layer holds the FP32 master weights; the trainer owns their BF16 copy
+ * and the FP32 gradient buffer (both tracked).
+ */
+template<std::size_t InSize, std::size_t OutSize>
+class MixedPrecisionTrainer {
+public:
+    using Layer = LinearLayer<float, InSize, OutSize>;
+    using Gradients = LinearGradients<float, InSize, OutSize>;
+    using Input = Tensor<bfloat16, InSize>;
+    using Output = Tensor<bfloat16, OutSize>;
+    using Target = Tensor<float, OutSize>;
+
+private:
+    Layer& layer_;
+    float learning_rate_;
+    DynamicLossScaler scaler_;
+    nn_memory::TrackedPtr<Tensor<bfloat16, OutSize, InSize>> weights_bf16_;
+    nn_memory::TrackedPtr<Gradients> grads_;
+
+public:
+    MixedPrecisionTrainer(Layer& layer, float learning_rate, DynamicLossScaler scaler = DynamicLossScaler())
+        : layer_(layer), learning_rate_(learning_rate), scaler_(scaler) {
+        nn_memory::MemoryOwnerScope owner("MixedPrecisionTrainer");
+        weights_bf16_ = nn_memory::make_tracked<Tensor<bfloat16, OutSize, InSize>>(nn_memory::MemoryPurpose::Weights);
+        grads_ = nn_memory::make_tracked<Gradients>(nn_memory::MemoryPurpose::Workspace);
+        refresh_weights();
+    }
+
+    // Re-derive the BF16 copy after the master weights were changed elsewhere
+    void refresh_weights() {
+        to_bfloat16(layer_.get_weights().data(), weights_bf16_->data(), OutSize * InSize);
+    }
+
+    // BF16 in, FP32 accumulate (+ FP32 bias), BF16 out
+    Tensor<float, OutSize> forward_fp32(const Input& input) const {
+        NN_PROFILE_ZONE("MixedPrecision::forward");
+        NN_METRICS_KERNEL("linear_bf16", 2 * InSize * OutSize + OutSize,
+                          sizeof(bfloat16) * (OutSize * InSize + InSize + OutSize));
+        Tensor<float, OutSize> output;
+        for (std::size_t i = 0; i < OutSize; ++i) {
+            output(i) = mp_detail::dot(input.data(), weights_bf16_->data() + i * InSize, InSize) +
+                        layer_.get_bias()(i);
+        }
+        return output;
+    }
+
+    Output forward(const Input& input) const { return to_bfloat16(forward_fp32(input)); }
+
+    /**
+     * @brief One SGD step on mean squared error; returns the mean loss
+     *
+     * Returns the loss even when the step was skipped for overflow. The last
+     * sample's accumulation pass also unscales the gradients and checks them
+     * for inf/nan, so the overflow check costs no pass of its own.
+     */
+    float train_step(const Input* inputs, const Target* targets, std::size_t batch) {
+        if (batch == 0) return 0.0f;
+        NN_PROFILE_ZONE("MixedPrecision::train_step");
+        Gradients& grads = *grads_;
+        grads.zero();
+        const float grad_scale = scaler_.scale() / static_cast<float>(batch);
+        const float inv_scale = 1.0f / scaler_.scale();
+
+        float loss = 0.0f;
+        std::uint32_t bad = 0;  // inf/nan seen while unscaling
+        for (std::size_t b = 0; b < batch; ++b) {
+            Tensor<float, OutSize> output = forward_fp32(inputs[b]);
+            const bfloat16* x = inputs[b].data();
+            const bool last = b + 1 == batch;
+            for (std::size_t i = 0; i < OutSize; ++i) {
+                const float diff = output(i) - targets[b](i);
+                loss += 0.5f * diff * diff;
+                const float g = diff * grad_scale;  // scaled dL/doutput
+                float* row = grads.weights.data() + i * InSize;
+                if (!last) {
+                    for (std::size_t j = 0; j < InSize; ++j) row[j] += g * float(x[j]);
+                    grads.bias(i) += g;
+                    continue;
+                }
+                // Final accumulation: unscale and check in the same pass (an
+                // earlier inf/nan survives the additions)
+                for (std::size_t j = 0; j < InSize; ++j) {
+                    row[j] = (row[j] + g * float(x[j])) * inv_scale;
+                    bad |= mp_detail::non_finite(row[j]);
+                }
+                grads.bias(i) = (grads.bias(i) + g) * inv_scale;
+                bad |= mp_detail::non_finite(grads.bias(i));
+            }
+        }
+
+        if (scaler_.update(bad != 0)) {
+            // FP32 master update fused with the BF16 refresh
+            float* w = layer_.get_weights().data();
+            bfloat16* w_bf16 = weights_bf16_->data();
+            const float* gw = grads.weights.data();
+            for (std::size_t e = 0; e < OutSize * InSize; ++e) {
+                w[e] -= learning_rate_ * gw[e];
+                w_bf16[e].bits = bfloat16::from_float_bits(std::bit_cast<std::uint32_t>(w[e]));
+            }
+            for (std::size_t i = 0; i < OutSize; ++i) layer_.get_bias()(i) -= learning_rate_ * grads.bias(i);
+        }
+        return loss / static_cast<float>(batch);
+    }
+
+    const DynamicLossScaler& scaler() const { return scaler_; }
+    // Unscaled gradients of the last step
+    const Gradients& gradients() const { return *grads_; }
+};
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "tensor.hpp"
+#include "nn_compiler.hpp"
+#include "gemm.hpp"
+#include "thread_pool.hpp"
+#include "memory_tracker.hpp"
+#include "profiler.hpp"
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Mixture-of-experts layer: router, token permutation, grouped GEMM
+ *
+ * One forward step over a batch of tokens:
+ *   1. route:    router logits (one GEMM), softmax over experts, top-k gates
+ *                renormalized to sum to 1
+ *   2. permute:  counting sort of the (token, slot) assignments by expert, so
+ *                each expert's input rows are one contiguous block
+ *   3. experts:  every expert's LinearLayer over its block in a single
+ *                grouped_gemm() launch (row counts differ per expert)
+ *   4. combine:  un-permute, each token summing its k expert rows weighted by
+ *                their gates (fixed slot order, so results are deterministic)
+ */
+
+template<std::size_t InSize, std::size_t OutSize, std::size_t Experts, std::size_t TopK>
+class MixtureOfExperts {
+    static_assert(TopK >= 1 && TopK <= Experts, "TopK must be in [1, Experts]");
+
+public:
+    using Expert = LinearLayer<float, InSize, OutSize>;
+    using Router = LinearLayer<float, InSize, Experts>;
+
+    // Where each (token, slot) went and with what weight
+    struct Routing {
+        std::vector<std::uint32_t> expert;              // [tokens * TopK]
+        std::vector<float> gate;                        // [tokens * TopK]
+        std::vector<std::uint32_t> row;                 // [tokens * TopK] row in the permuted buffer
+        std::array<std::size_t, Experts + 1> offsets{};  // expert e owns rows [offsets[e], offsets[e + 1])
+    };
+
+private:
+    template<typename T>
+    using Buffer = std::vector<T, nn_memory::TrackingAllocator<T>>;
+
+    nn_memory::TrackedPtr<Router> router_;
+    std::vector<nn_memory::TrackedPtr<Expert>> experts_;
+    Buffer<float> logits_;
+    Buffer<float> permuted_;
+    Buffer<float> expert_out_;
+    Routing routing_;
+
+    void route(const float* tokens, std::size_t num_tokens, ThreadPool& pool) {
+        NN_PROFILE_ZONE("moe::route");
+        logits_.resize(num_tokens * Experts);
+        gemm_nt(num_tokens, Experts, InSize, tokens, router_->get_weights().data(), logits_.data(),
+                router_->get_bias().data(), pool);
+
+        routing_.expert.resize(num_tokens * TopK);
+        routing_.gate.resize(num_tokens * TopK);
+        pool.parallel_ranges(num_tokens, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t t = begin; t < end; ++t) {
+                const float* z = logits_.data() + t * Experts;
+                // Top-k by repeated max (E is small); softmax restricted to
+                // the chosen experts equals renormalized full-softmax gates
+                bool taken[Experts] = {};
+                std::uint32_t* chosen = routing_.expert.data() + t * TopK;
+                float* gate = routing_.gate.data() + t * TopK;
+                for (std::size_t s = 0; s < TopK; ++s) {
+                    std::size_t best = Experts;
+                    for (std::size_t e = 0; e < Experts; ++e) {
+                        if (!taken[e] && (best == Experts || z[e] > z[best])) best = e;
+                    }
+                    taken[best] = true;
+                    chosen[s] = static_cast<std::uint32_t>(best);
+                }
+                const float top = z[chosen[0]];
+                float sum = 0.0f;
+                for (std::size_t s = 0; s < TopK; ++s) sum += gate[s] = std::exp(z[chosen[s]] - top);
+                for (std::size_t s = 0; s < TopK; ++s) gate[s] /= sum;
+            }
+        });
+    }
+
+    void permute(const float* tokens, std::size_t num_tokens, ThreadPool& pool) {
+        NN_PROFILE_ZONE("moe::permute");
+        const std::size_t assignments = num_tokens * TopK;
+        std::array<std::size_t, Experts + 1> next{};
+        for (std::size_t a = 0; a < assignments; ++a) ++next[routing_.expert[a] + 1];
+        for (std::size_t e = 0; e < Experts; ++e) next[e + 1] += next[e];
+        routing_.offsets = next;
+
+        routing_.row.resize(assignments);
+        for (std::size_t a = 0; a < assignments; ++a) {
+            routing_.row[a] = static_cast<std::uint32_t>(next[routing_.expert[a]]++);
+        }
+
+        permuted_.resize(assignments * InSize);
+        pool.parallel_ranges(assignments, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t a = begin; a < end; ++a) {
+                const float* src = tokens + (a / TopK) * InSize;
+                std::copy(src, src + InSize, permuted_.data() + routing_.row[a] * InSize);
+            }
+        });
+    }
+
+    void run_experts(ThreadPool& pool) {
+        expert_out_.resize(routing_.row.size() * OutSize);
+        std::vector<GemmProblem> problems;
+        for (std::size_t e = 0; e < Experts; ++e) {
+            const std::size_t begin = routing_.offsets[e];
+            const std::size_t rows = routing_.offsets[e + 1] - begin;
+            if (rows == 0) continue;
+            problems.push_back({rows, OutSize, InSize, permuted_.data() + begin * InSize, InSize,
+                                experts_[e]->get_weights().data(), InSize,
+                                expert_out_.data() + begin * OutSize, OutSize,
+                                experts_[e]->get_bias().data()});
+        }
+        grouped_gemm(problems, pool);
+    }
+
+    void combine(std::size_t num_tokens, float* output, ThreadPool& pool) {
+        NN_PROFILE_ZONE("moe::combine");
+        pool.parallel_ranges(num_tokens, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t t = begin; t < end; ++t) {
+                float* out = output + t * OutSize;
+                for (std::size_t j = 0; j < OutSize; ++j) out[j] = 0.0f;
+                for (std::size_t s = 0; s < TopK; ++s) {
+                    const float g = routing_.gate[t * TopK + s];
+                    const float* y = expert_out_.data() + routing_.row[t * TopK + s] * OutSize;
+                    for (std::size_t j = 0; j < OutSize; ++j) out[j] += g * y[j];
+                }
+            }
+        });
+    }
+
+public:
+    MixtureOfExperts()
+        : logits_(nn_memory::TrackingAllocator<float>("MixtureOfExperts", nn_memory::MemoryPurpose::Activations)),
+          permuted_(logits_.get_allocator()),
+          expert_out_(logits_.get_allocator()) {
+        nn_memory::MemoryOwnerScope owner("MixtureOfExperts");
+        router_ = nn_memory::make_tracked<Router>(nn_memory::MemoryPurpose::Weights);
+        for (std::size_t e = 0; e < Experts; ++e) {
+            experts_.push_back(nn_memory::make_tracked<Expert>(nn_memory::MemoryPurpose::Weights));
+        }
+    }
+
+    Router& router() { return *router_; }
+    Expert& expert(std::size_t e) { return *experts_[e]; }
+    const Expert& expert(std::size_t e) const { return *experts_[e]; }
+
+    /**
+     * @brief output[t] = sum_k gate(t, k) * expert_k(tokens[t])
+     *
+     * tokens is [num_tokens, InSize] and output [num_tokens, OutSize], row-major.
+     */
+    void forward(const float* tokens, std::size_t num_tokens, float* output,
+                 ThreadPool& pool = ThreadPool::global()) {
+        NN_PROFILE_ZONE("moe::forward");
+        if (num_tokens == 0) return;
+        route(tokens, num_tokens, pool);
+        permute(tokens, num_tokens, pool);
+        run_experts(pool);
+        combine(num_tokens, output, pool);
+    }
+
+    template<std::size_t Tokens>
+    Tensor<float, Tokens, OutSize> forward(const Tensor<float, Tokens, InSize>& tokens,
+                                           ThreadPool& pool = ThreadPool::global()) {
+        Tensor<float, Tokens, OutSize> output;
+        forward(tokens.data(), Tokens, output.data(), pool);
+        return output;
+    }
+
+    // Routing of the last forward (e.g. for load-balancing statistics)
+    const Routing& routing() const { return routing_; }
+};
@@ -2,8 +2,12 @@
 
 #include "tensor.hpp"
 #include "expression_template.hpp"
+#include "profiler.hpp"
+#include "metrics.hpp"
 #include <array>
+#include <tuple>
 #include <type_traits>
+#include <utility>
 
 /**
  * @brief NN Compiler utilities using Metaprogramming
@@ -23,6 +27,8 @@ constexpr auto get_tensor_shape(const Tensor<T, Dims...>&) {
 // Matrix multiplication kernel (compile-time optimized)
 template<typename T, std::size_t M, std::size_t N, std::size_t K>
 constexpr Tensor<T, M, K> matmul(const Tensor<T, M, N>& a, const Tensor<T, N, K>& b) {
+    NN_PROFILE_ZONE("matmul");
+    NN_METRICS_KERNEL("matmul", 2 * M * N * K, sizeof(T) * (M * N + N * K + M * K));
     Tensor<T, M, K> result;
     
     // Compile-time unrolled loops for small matrices
@@ -58,6 +64,8 @@ constexpr Tensor<T, M, K> matmul(const Tensor<T, M, N>& a, const Tensor<T, N, K>
 // ReLU activation function (compile-time optimized)
 template<typename T, std::size_t... Dims>
 constexpr Tensor<T, Dims...> relu(const Tensor<T, Dims...>& input) {
+    NN_PROFILE_ZONE("relu");
+    NN_METRICS_KERNEL("relu", input.size(), 2 * sizeof(T) * input.size());
     Tensor<T, Dims...> output;
     
     if constexpr (Tensor<T, Dims...>::total_size <= 16) {
@@ -98,9 +106,24 @@ public:
     virtual OutputType forward(const InputType& input) const = 0;
 };
 
+// Parameter gradients of a LinearLayer
+template<typename T, std::size_t InSize, std::size_t OutSize>
+struct LinearGradients {
+    Tensor<T, OutSize, InSize> weights;
+    Tensor<T, OutSize> bias;
+    
+    constexpr void zero() {
+        for (std::size_t i = 0; i < weights.size(); ++i) weights.data()[i] = T(0);
+        for (std::size_t i = 0; i < bias.size(); ++i) bias.data()[i] = T(0);
+    }
+};
+
 // Linear (Fully Connected) Layer
 template<typename T, std::size_t InSize, std::size_t OutSize>
 class LinearLayer : public Layer<Tensor<T, InSize>, Tensor<T, OutSize>> {
+public:
+    using Gradients = LinearGradients<T, InSize, OutSize>;
+    
 private:
     Tensor<T, OutSize, InSize> weights_;
     Tensor<T, OutSize> bias_;
@@ -112,6 +135,9 @@ public:
         : weights_(w), bias_(b) {}
     
     constexpr Tensor<T, OutSize> forward(const Tensor<T, InSize>& input) const {
+        NN_PROFILE_ZONE("LinearLayer::forward");
+        NN_METRICS_KERNEL("linear", 2 * InSize * OutSize + OutSize,
+                          sizeof(T) * (OutSize * InSize + InSize + 2 * OutSize));
         // Compute: output = input * weights^T + bias
         // weights_ is [OutSize, InSize], so we compute: output[i] = sum(input[j] * weights_[i][j]) + bias[i]
         Tensor<T, OutSize> output;
@@ -127,12 +153,134 @@ public:
         return output;
     }
     
+    // Backward pass: accumulates dL/dW and dL/db into grads, returns dL/dinput
+    constexpr Tensor<T, InSize> backward(const Tensor<T, InSize>& input,
+                                         const Tensor<T, OutSize>& grad_output,
+                                         LinearGradients<T, InSize, OutSize>& grads) const {
+        NN_PROFILE_ZONE("LinearLayer::backward");
+        NN_METRICS_KERNEL("linear_backward", 4 * InSize * OutSize + OutSize,
+                          sizeof(T) * (3 * OutSize * InSize + 2 * InSize + 2 * OutSize));
+        Tensor<T, InSize> grad_input;
+        
+        for (std::size_t i = 0; i < OutSize; ++i) {
+            const T g = grad_output(i);
+            for (std::size_t j = 0; j < InSize; ++j) {
+                grads.weights(i, j) += g * input(j);
+                grad_input(j) += g * weights_(i, j);
+            }
+            grads.bias(i) += g;
+        }
+        
+        return grad_input;
+    }
+    
+    // Parameter gradients only, for heads whose input needs no gradient
+    constexpr void accumulate_gradients(const Tensor<T, InSize>& input,
+                                        const Tensor<T, OutSize>& grad_output,
+                                        LinearGradients<T, InSize, OutSize>& grads) const {
+        NN_PROFILE_ZONE("LinearLayer::accumulate_gradients");
+        NN_METRICS_KERNEL("linear_weight_grad", 2 * InSize * OutSize + OutSize,
+                          sizeof(T) * (2 * OutSize * InSize + InSize + 2 * OutSize));
+        for (std::size_t i = 0; i < OutSize; ++i) {
+            const T g = grad_output(i);
+            for (std::size_t j = 0; j < InSize; ++j) {
+                grads.weights(i, j) += g * input(j);
+            }
+            grads.bias(i) += g;
+        }
+    }
+    
+    // Plain SGD step on accumulated gradients
+    constexpr void sgd_update(const LinearGradients<T, InSize, OutSize>& grads, T learning_rate) {
+        for (std::size_t i = 0; i < weights_.size(); ++i) {
+            weights_.data()[i] -= learning_rate * grads.weights.data()[i];
+        }
+        for (std::size_t i = 0; i < bias_.size(); ++i) {
+            bias_.data()[i] -= learning_rate * grads.bias.data()[i];
+        }
+    }
+    
     constexpr auto& get_weights() { return weights_; }
     constexpr const auto& get_weights() const { return weights_; }
     constexpr auto& get_bias() { return bias_; }
     constexpr const auto& get_bias() const { return bias_; }
 };
 
+// Gradient buffer of parameter-free layers
+struct NoGradients {
+    constexpr void zero() {}
+};
+
+// ReLU as a layer, so it can be composed in a Sequential model
+template<typename T, std::size_t Size>
+class ReLULayer : public Layer<Tensor<T, Size>, Tensor<T, Size>> {
+public:
+    using Gradients = NoGradients;
+    
+    constexpr Tensor<T, Size> forward(const Tensor<T, Size>& input) const {
+        return relu(input);
+    }
+    
+    constexpr Tensor<T, Size> backward(const Tensor<T, Size>& input,
+                                       const Tensor<T, Size>& grad_output,
+                                       NoGradients&) const {
+        Tensor<T, Size> grad_input;
+        for (std::size_t i = 0; i < Size; ++i) {
+            grad_input.data()[i] = input.data()[i] > T(0) ? grad_output.data()[i] : T(0);
+        }
+        return grad_input;
+    }
+    
+    constexpr void sgd_update(const NoGradients&, T) {}
+};
+
+// Sequential model: a compile-time chain of layers, each Output feeding the next Input
+template<typename... Layers>
+class Sequential {
+public:
+    static constexpr std::size_t num_layers = sizeof...(Layers);
+    static_assert(num_layers > 0, "Sequential needs at least one layer");
+    
+    template<std::size_t I>
+    using LayerAt = std::tuple_element_t<I, std::tuple<Layers...>>;
+    
+    using Input = typename LayerAt<0>::Input;
+    using Output = typename LayerAt<num_layers - 1>::Output;
+    
+private:
+    std::tuple<Layers...> layers_;
+    
+    template<std::size_t... I>
+    static constexpr bool chained(std::index_sequence<I...>) {
+        return (std::is_same_v<typename LayerAt<I>::Output, typename LayerAt<I + 1>::Input> && ...);
+    }
+    static_assert(chained(std::make_index_sequence<num_layers - 1>{}),
+                  "Each layer's Output must match the next layer's Input");
+    
+    template<std::size_t I>
+    constexpr Output forward_from(const typename LayerAt<I>::Input& input) const {
+        if constexpr (I + 1 == num_layers) {
+            return std::get<I>(layers_).forward(input);
+        } else {
+            return forward_from<I + 1>(std::get<I>(layers_).forward(input));
+        }
+    }
+    
+public:
+    constexpr Sequential() = default;
+    constexpr explicit Sequential(const Layers&... layers) : layers_(layers...) {}
+    
+    constexpr Output forward(const Input& input) const {
+        return forward_from<0>(input);
+    }
+    
+    template<std::size_t I>
+    constexpr auto& layer() { return std::get<I>(layers_); }
+    
+    template<std::size_t I>
+    constexpr const auto& layer() const { return std::get<I>(layers_); }
+};
+
 // Compile-time constant calculations
 namespace constexpr_utils {
     // Calculate factorial at compile time
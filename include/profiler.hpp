@@ -0,0 +1,453 @@
+#pragma once
+
+#include <atomic>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+/**
+ * @brief Opt-in in-process sampling profiler
+ *
+ * A SIGPROF timer (setitimer(ITIMER_PROF)) interrupts the process at a fixed
+ * CPU-time frequency. The signal handler records the interrupted thread's
+ * stack of instrumented kernel zones (NN_PROFILE_ZONE("matmul"), ...) and its
+ * frame-pointer call chain into a fixed-size lock-free table, so no allocation
+ * or locking happens in signal context. write_folded() emits one
+ * "frame;frame;zone;frame count" line per unique stack, the input format of
+ * flamegraph.pl, inferno and speedscope.
+ *
+ * Zones compile to nothing unless NN_META_ENABLE_PROFILER is defined. The CMake
+ * option NN_META_PROFILER defines it and also builds with frame pointers and
+ * exported symbols so the call chains can be unwound and symbolized.
+ */
+
+namespace nn_profiler {
+
+constexpr std::size_t kMaxZoneDepth = 16;
+constexpr std::size_t kMaxFrames = 32;
+constexpr std::size_t kStackSlots = 4096;  // distinct stacks kept per session
+
+namespace detail {
+
+// Per-thread zone stack, read by the signal handler of the same thread
+struct ThreadState {
+    const char* zones[kMaxZoneDepth];
+    std::uintptr_t zone_frames[kMaxZoneDepth];
+    volatile std::sig_atomic_t depth;
+    std::uintptr_t stack_lo;
+    std::uintptr_t stack_hi;
+};
+
+// constinit keeps the TLS access free of lazy-init wrappers (signal-safe)
+constinit inline thread_local ThreadState tls_state{};
+
+struct StackSlot {
+    std::atomic<std::uint32_t> state{0};  // 0 empty, 1 being filled, 2 ready
+    std::uint64_t hash = 0;
+    std::atomic<std::uint64_t> count{0};
+    std::uint32_t num_zones = 0;
+    std::uint32_t num_frames = 0;
+    const char* zones[kMaxZoneDepth] = {};
+    std::uintptr_t zone_frames[kMaxZoneDepth] = {};
+    std::uintptr_t pcs[kMaxFrames] = {};
+    std::uintptr_t fps[kMaxFrames] = {};
+};
+
+inline StackSlot g_slots[kStackSlots];
+inline std::atomic<bool> g_running{false};
+inline std::atomic<bool> g_unwind{true};
+inline std::atomic<std::uint64_t> g_samples{0};
+inline std::atomic<std::uint64_t> g_dropped{0};
+
+// Record the calling thread's stack bounds so the unwinder never leaves them
+inline void register_thread() {
+    ThreadState& ts = tls_state;
+    if (ts.stack_hi != 0) return;
+    void* addr = nullptr;
+    std::size_t size = 0;
+#if defined(__APPLE__)
+    pthread_t self = pthread_self();
+    std::uintptr_t hi = reinterpret_cast<std::uintptr_t>(pthread_get_stackaddr_np(self));
+    size = pthread_get_stacksize_np(self);
+    addr = reinterpret_cast<void*>(hi - size);
+#else
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) return;
+    pthread_attr_getstack(&attr, &addr, &size);
+    pthread_attr_destroy(&attr);
+#endif
+    ts.stack_lo = reinterpret_cast<std::uintptr_t>(addr);
+    ts.stack_hi = ts.stack_lo + size;
+}
+
+inline bool push_zone(const char* name, std::uintptr_t frame) {
+    ThreadState& ts = tls_state;
+    if (ts.stack_hi == 0 && g_running.load(std::memory_order_relaxed)) {
+        register_thread();
+    }
+    std::sig_atomic_t depth = ts.depth;
+    if (depth >= static_cast<std::sig_atomic_t>(kMaxZoneDepth)) {
+        ts.depth = depth + 1;  // keep push/pop balanced, but do not record
+        return true;
+    }
+    ts.zones[depth] = name;
+    ts.zone_frames[depth] = frame;
+    std::atomic_signal_fence(std::memory_order_release);
+    ts.depth = depth + 1;
+    return true;
+}
+
+inline void pop_zone() {
+    ThreadState& ts = tls_state;
+    std::atomic_signal_fence(std::memory_order_release);
+    ts.depth = ts.depth - 1;
+}
+
+inline std::uint64_t mix(std::uint64_t h, std::uint64_t v) {
+    h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    return h;
+}
+
+// Registers of the interrupted context: program counter and frame pointer
+inline bool context_registers(void* ucontext, std::uintptr_t& pc, std::uintptr_t& fp) {
+    auto* uc = static_cast<ucontext_t*>(ucontext);
+#if defined(__linux__) && defined(__x86_64__)
+    pc = static_cast<std::uintptr_t>(uc->uc_mcontext.gregs[REG_RIP]);
+    fp = static_cast<std::uintptr_t>(uc->uc_mcontext.gregs[REG_RBP]);
+    return true;
+#elif defined(__linux__) && defined(__aarch64__)
+    pc = static_cast<std::uintptr_t>(uc->uc_mcontext.pc);
+    fp = static_cast<std::uintptr_t>(uc->uc_mcontext.regs[29]);
+    return true;
+#elif defined(__APPLE__) && defined(__x86_64__)
+    pc = static_cast<std::uintptr_t>(uc->uc_mcontext->__ss.__rip);
+    fp = static_cast<std::uintptr_t>(uc->uc_mcontext->__ss.__rbp);
+    return true;
+#elif defined(__APPLE__) && defined(__aarch64__)
+    pc = static_cast<std::uintptr_t>(uc->uc_mcontext->__ss.__pc);
+    fp = static_cast<std::uintptr_t>(uc->uc_mcontext->__ss.__fp);
+    return true;
+#else
+    (void)uc; (void)pc; (void)fp;
+    return false;
+#endif
+}
+
+inline void on_sigprof(int, siginfo_t*, void* ucontext) {
+    if (!g_running.load(std::memory_order_relaxed)) return;
+    const ThreadState& ts = tls_state;
+    std::atomic_signal_fence(std::memory_order_acquire);
+
+    std::uint32_t num_zones = static_cast<std::uint32_t>(ts.depth);
+    if (num_zones > kMaxZoneDepth) num_zones = kMaxZoneDepth;
+
+    // Frame-pointer walk, restricted to this thread's registered stack
+    std::uintptr_t pcs[kMaxFrames];
+    std::uintptr_t fps[kMaxFrames];
+    std::uint32_t num_frames = 0;
+    std::uintptr_t pc = 0, fp = 0;
+    if (g_unwind.load(std::memory_order_relaxed) && ts.stack_hi != 0 &&
+        context_registers(ucontext, pc, fp)) {
+        pcs[num_frames] = pc;
+        fps[num_frames] = fp;
+        ++num_frames;
+        while (num_frames < kMaxFrames && fp >= ts.stack_lo &&
+               fp + 2 * sizeof(std::uintptr_t) <= ts.stack_hi &&
+               fp % sizeof(std::uintptr_t) == 0) {
+            const auto* frame = reinterpret_cast<const std::uintptr_t*>(fp);
+            std::uintptr_t next_fp = frame[0];
+            std::uintptr_t ret = frame[1];
+            if (ret == 0 || next_fp <= fp) break;
+            pcs[num_frames] = ret - 1;  // point into the call instruction
+            fps[num_frames] = next_fp;
+            ++num_frames;
+            fp = next_fp;
+        }
+    }
+
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (std::uint32_t i = 0; i < num_zones; ++i) {
+        hash = mix(hash, reinterpret_cast<std::uintptr_t>(ts.zones[i]));
+        hash = mix(hash, ts.zone_frames[i]);
+    }
+    for (std::uint32_t i = 0; i < num_frames; ++i) hash = mix(hash, pcs[i]);
+    if (hash == 0) hash = 1;
+
+    g_samples.fetch_add(1, std::memory_order_relaxed);
+    std::size_t index = hash % kStackSlots;
+    for (std::size_t probe = 0; probe < 64; ++probe, index = (index + 1) % kStackSlots) {
+        StackSlot& slot = g_slots[index];
+        std::uint32_t state = slot.state.load(std::memory_order_acquire);
+        if (state == 2 && slot.hash == hash) {
+            slot.count.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (state == 0) {
+            std::uint32_t expected = 0;
+            if (!slot.state.compare_exchange_strong(expected, 1, std::memory_order_acquire)) {
+                continue;
+            }
+            slot.hash = hash;
+            slot.num_zones = num_zones;
+            slot.num_frames = num_frames;
+            for (std::uint32_t i = 0; i < num_zones; ++i) {
+                slot.zones[i] = ts.zones[i];
+                slot.zone_frames[i] = ts.zone_frames[i];
+            }
+            for (std::uint32_t i = 0; i < num_frames; ++i) {
+                slot.pcs[i] = pcs[i];
+                slot.fps[i] = fps[i];
+            }
+            slot.count.store(1, std::memory_order_relaxed);
+            slot.state.store(2, std::memory_order_release);
+            return;
+        }
+    }
+    g_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline std::string symbolize(std::uintptr_t pc) {
+    Dl_info info{};
+    if (dladdr(reinterpret_cast<void*>(pc), &info) != 0 && info.dli_sname != nullptr) {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        std::string name = (status == 0 && demangled != nullptr) ? demangled : info.dli_sname;
+        std::free(demangled);
+        return name;
+    }
+    if (info.dli_fname != nullptr) {
+        std::string module = info.dli_fname;
+        module = module.substr(module.find_last_of('/') + 1);
+        char offset[32];
+        std::snprintf(offset, sizeof(offset), "+0x%zx",
+                      static_cast<std::size_t>(pc - reinterpret_cast<std::uintptr_t>(info.dli_fbase)));
+        return module + offset;
+    }
+    char addr[32];
+    std::snprintf(addr, sizeof(addr), "0x%zx", static_cast<std::size_t>(pc));
+    return addr;
+}
+
+// Folded frames are ';'-separated, so strip the separator from symbol names
+inline std::string folded_frame(std::string name) {
+    for (char& c : name) {
+        if (c == ';') c = ':';
+    }
+    return name;
+}
+
+}  // namespace detail
+
+struct ProfilerOptions {
+    int frequency_hz = 997;  // prime, to avoid lock-step with periodic work
+    bool unwind = true;      // false: attribute samples to zones only
+};
+
+/**
+ * @brief Process-wide SIGPROF sampler
+ */
+class Profiler {
+private:
+    struct sigaction previous_action_{};
+    struct itimerval previous_timer_{};
+    bool installed_ = false;
+
+    Profiler() = default;
+
+public:
+    static Profiler& instance() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    bool running() const { return detail::g_running.load(); }
+
+    bool start(const ProfilerOptions& options = ProfilerOptions{}) {
+        if (installed_) return false;
+        reset();
+        detail::register_thread();
+        detail::g_unwind.store(options.unwind);
+
+        struct sigaction action{};
+        action.sa_sigaction = &detail::on_sigprof;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGPROF, &action, &previous_action_) != 0) return false;
+
+        int hz = options.frequency_hz > 0 ? options.frequency_hz : 997;
+        struct itimerval timer{};
+        timer.it_interval.tv_sec = 0;
+        timer.it_interval.tv_usec = hz >= 1000000 ? 1 : 1000000 / hz;
+        timer.it_value = timer.it_interval;
+        detail::g_running.store(true);
+        if (setitimer(ITIMER_PROF, &timer, &previous_timer_) != 0) {
+            detail::g_running.store(false);
+            sigaction(SIGPROF, &previous_action_, nullptr);
+            return false;
+        }
+        installed_ = true;
+        return true;
+    }
+
+    void stop() {
+        if (!installed_) return;
+        setitimer(ITIMER_PROF, &previous_timer_, nullptr);
+        detail::g_running.store(false);
+        sigaction(SIGPROF, &previous_action_, nullptr);
+        installed_ = false;
+    }
+
+    void reset() {
+        for (auto& slot : detail::g_slots) {
+            slot.state.store(0, std::memory_order_relaxed);
+            slot.count.store(0, std::memory_order_relaxed);
+        }
+        detail::g_samples.store(0);
+        detail::g_dropped.store(0);
+    }
+
+    std::uint64_t samples() const { return detail::g_samples.load(); }
+    std::uint64_t dropped() const { return detail::g_dropped.load(); }
+
+    // Aggregate recorded stacks into folded form, outermost frame first.
+    // Zones are spliced in below the frame that opened them.
+    std::map<std::string, std::uint64_t> folded() const {
+        std::map<std::string, std::uint64_t> stacks;
+        std::map<std::uintptr_t, std::string> symbols;
+        for (const auto& slot : detail::g_slots) {
+            if (slot.state.load(std::memory_order_acquire) != 2) continue;
+
+            std::string line;
+            auto append = [&line](const std::string& frame) {
+                if (!line.empty()) line += ';';
+                line += frame;
+            };
+            std::uint32_t zone = 0;
+            for (std::uint32_t i = slot.num_frames; i-- > 0;) {
+                // A zone belongs below every frame at or above its entry frame
+                while (zone < slot.num_zones && slot.fps[i] < slot.zone_frames[zone]) {
+                    append(detail::folded_frame(slot.zones[zone++]));
+                }
+                auto it = symbols.find(slot.pcs[i]);
+                if (it == symbols.end()) {
+                    it = symbols.emplace(slot.pcs[i], detail::folded_frame(
+                                                          detail::symbolize(slot.pcs[i]))).first;
+                }
+                append(it->second);
+            }
+            while (zone < slot.num_zones) {
+                append(detail::folded_frame(slot.zones[zone++]));
+            }
+            if (line.empty()) line = "[unattributed]";
+            stacks[line] += slot.count.load(std::memory_order_relaxed);
+        }
+        return stacks;
+    }
+
+    bool write_folded(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) return false;
+        for (const auto& [stack, count] : folded()) {
+            out << stack << ' ' << count << '\n';
+        }
+        return static_cast<bool>(out);
+    }
+};
+
+/**
+ * @brief RAII profiling session: samples while alive, writes folded stacks on exit
+ */
+class ScopedProfiler {
+private:
+    std::string path_;
+    bool active_ = false;
+
+public:
+    ScopedProfiler() = default;
+
+    explicit ScopedProfiler(const std::string& path,
+                            const ProfilerOptions& options = ProfilerOptions{})
+        : path_(path) {
+        active_ = !path_.empty() && Profiler::instance().start(options);
+    }
+
+    // Profile only when the environment variable names an output file
+    static ScopedProfiler from_env(const char* variable = "NN_META_PROFILE") {
+        const char* path = std::getenv(variable);
+        return path != nullptr ? ScopedProfiler(path) : ScopedProfiler();
+    }
+
+    ScopedProfiler(ScopedProfiler&& other) noexcept
+        : path_(std::move(other.path_)), active_(other.active_) {
+        other.active_ = false;
+    }
+
+    ScopedProfiler(const ScopedProfiler&) = delete;
+    ScopedProfiler& operator=(const ScopedProfiler&) = delete;
+    ScopedProfiler& operator=(ScopedProfiler&&) = delete;
+
+    ~ScopedProfiler() {
+        if (!active_) return;
+        Profiler& profiler = Profiler::instance();
+        profiler.stop();
+        profiler.write_folded(path_);
+    }
+
+    bool active() const { return active_; }
+};
+
+/**
+ * @brief Marks a kernel zone for the lifetime of the guard
+ *
+ * Literal type so that it can sit inside constexpr kernels; it only touches the
+ * zone stack when evaluated at runtime.
+ */
+class ZoneGuard {
+private:
+    bool active_ = false;
+
+public:
+    [[gnu::always_inline]] constexpr explicit ZoneGuard(const char* name) {
+        if (!std::is_constant_evaluated()) {
+            active_ = detail::push_zone(
+                name, reinterpret_cast<std::uintptr_t>(__builtin_frame_address(0)));
+        }
+    }
+
+    [[gnu::always_inline]] constexpr ~ZoneGuard() {
+        if (!std::is_constant_evaluated() && active_) {
+            detail::pop_zone();
+        }
+    }
+
+    ZoneGuard(const ZoneGuard&) = delete;
+    ZoneGuard& operator=(const ZoneGuard&) = delete;
+};
+
+}  // namespace nn_profiler
+
+#define NN_PROFILE_CONCAT_IMPL(a, b) a##b
+#define NN_PROFILE_CONCAT(a, b) NN_PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef NN_META_ENABLE_PROFILER
+#define NN_PROFILE_ZONE(name) \
+    ::nn_profiler::ZoneGuard NN_PROFILE_CONCAT(nn_profile_zone_, __LINE__) { name }
+#else
+#define NN_PROFILE_ZONE(name) ((void)0)
+#endif
@@ -0,0 +1,377 @@
+#pragma once
+
+#include "conv.hpp"
+#include "thread_pool.hpp"
+#include "memory_tracker.hpp"
+#include "profiler.hpp"
+#include "metrics.hpp"
+#include "snapshot.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief 8-bit quantized inference: uint8 activations, int8 weights
+ *
+ * Activations are asymmetric uint8, real = scale * (q - zero_point), so the
+ * post-ReLU range uses all 256 levels; weights are symmetric int8 with one
+ * scale per output channel. QuantizedConv2D accumulates u8 x s8 products in
+ * int32 and ends in one fused epilogue per output: zero-point correction,
+ * int32 bias, requantization to the output scale, ReLU as a clamp at the
+ * output zero point, and the uint8 store. Its output is the next layer's
+ * input as is, so a CNN block stays 8-bit from quantize() to dequantize().
+ *
+ * The implicit-GEMM path follows Conv2D: patches are gathered per tile,
+ * widened to int16 and paired along K, and the micro-kernel multiplies them
+ * with pmaddwd (two products summed into each int32 lane) against weights
+ * that were packed into k-pair panels once, at quantization time. save() /
+ * load() move those tables through a warm-start snapshot (snapshot.hpp);
+ * a loaded layer reads them from the mapping in place.
+ */
+
+/**
+ * @brief Affine uint8 quantization: real = scale * (q - zero_point)
+ */
+struct QuantParams {
+    float scale = 1.0f;
+    std::int32_t zero_point = 0;
+
+    // Covers [lo, hi] (extended to include 0, which must be exact for padding)
+    static QuantParams from_range(float lo, float hi) {
+        lo = std::min(lo, 0.0f);
+        hi = std::max(hi, 0.0f);
+        QuantParams p;
+        p.scale = hi > lo ? (hi - lo) / 255.0f : 1.0f;
+        p.zero_point = static_cast<std::int32_t>(std::lrint(-lo / p.scale));
+        return p;
+    }
+
+    std::uint8_t quantize(float x) const {
+        const long q = std::lrint(x / scale) + zero_point;
+        return static_cast<std::uint8_t>(std::clamp(q, 0L, 255L));
+    }
+
+    float dequantize(std::uint8_t q) const {
+        return scale * static_cast<float>(static_cast<std::int32_t>(q) - zero_point);
+    }
+};
+
+inline void quantize(const float* src, std::size_t n, const QuantParams& params, std::uint8_t* dst) {
+    for (std::size_t i = 0; i < n; ++i) dst[i] = params.quantize(src[i]);
+}
+
+inline void dequantize(const std::uint8_t* src, std::size_t n, const QuantParams& params, float* dst) {
+    for (std::size_t i = 0; i < n; ++i) dst[i] = params.dequantize(src[i]);
+}
+
+namespace qgemm_detail {
+
+constexpr std::size_t nr = 8;    // output channels per micro-kernel (two int32x4 accumulators)
+constexpr std::size_t mr = 4;
+constexpr std::size_t kc = 512;  // K elements (256 pairs) per gathered block
+constexpr std::size_t nc = 64;
+constexpr std::size_t mc = 128;
+
+// Pack int8 weights [N, K] as int16 k-pair panels: panel p holds, per pair kp,
+// nr columns x {k = 2kp, 2kp + 1}; columns past N and k past K are zero
+inline void pack_weights(const std::int8_t* w, std::size_t N, std::size_t K, std::int16_t* packed) {
+    const std::size_t pairs = (K + 1) / 2;
+    for (std::size_t p = 0; p < N; p += nr) {
+        std::int16_t* panel = packed + p * 2 * pairs;
+        for (std::size_t kp = 0; kp < pairs; ++kp) {
+            for (std::size_t j = 0; j < nr; ++j) {
+                for (std::size_t h = 0; h < 2; ++h) {
+                    const std::size_t k = 2 * kp + h;
+                    panel[(kp * nr + j) * 2 + h] = p + j < N && k < K ? w[(p + j) * K + k] : 0;
+                }
+            }
+        }
+    }
+}
+
+// c[MR x cols] += a[MR x 2 pairs] * panel (int16 pairs, int32 sums); cols <= nr
+template<std::size_t MR>
+inline void micro_kernel(std::size_t pairs, const std::int16_t* a, std::size_t lda, const std::int16_t* panel,
+                         std::int32_t* c, std::size_t ldc, std::size_t cols) {
+#if defined(__SSE2__)
+    __m128i acc[MR][2];
+    for (std::size_t r = 0; r < MR; ++r) acc[r][0] = acc[r][1] = _mm_setzero_si128();
+    for (std::size_t kp = 0; kp < pairs; ++kp) {
+        const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(panel + kp * 2 * nr));
+        const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(panel + kp * 2 * nr + nr));
+        for (std::size_t r = 0; r < MR; ++r) {
+            std::int32_t pair;
+            std::memcpy(&pair, a + r * lda + 2 * kp, sizeof(pair));
+            const __m128i av = _mm_set1_epi32(pair);
+            acc[r][0] = _mm_add_epi32(acc[r][0], _mm_madd_epi16(av, b0));
+            acc[r][1] = _mm_add_epi32(acc[r][1], _mm_madd_epi16(av, b1));
+        }
+    }
+    for (std::size_t r = 0; r < MR; ++r) {
+        std::int32_t row[nr];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(row), acc[r][0]);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(row + 4), acc[r][1]);
+        for (std::size_t j = 0; j < cols; ++j) c[r * ldc + j] += row[j];
+    }
+#else
+    std::int32_t acc[MR][nr] = {};
+    for (std::size_t kp = 0; kp < pairs; ++kp) {
+        const std::int16_t* b = panel + kp * 2 * nr;
+        for (std::size_t r = 0; r < MR; ++r) {
+            const std::int32_t a0 = a[r * lda + 2 * kp], a1 = a[r * lda + 2 * kp + 1];
+            for (std::size_t j = 0; j < nr; ++j) acc[r][j] += a0 * b[2 * j] + a1 * b[2 * j + 1];
+        }
+    }
+    for (std::size_t r = 0; r < MR; ++r) {
+        for (std::size_t j = 0; j < cols; ++j) c[r * ldc + j] += acc[r][j];
+    }
+#endif
+}
+
+// Per-thread A block (mc x kc int16) and int32 accumulator tile (mc x nc)
+struct Workspace {
+    std::vector<std::int16_t> a = std::vector<std::int16_t>(mc * kc);
+    std::vector<std::int32_t> acc = std::vector<std::int32_t>(mc * nc);
+};
+
+inline Workspace& workspace() {
+    static thread_local Workspace ws;
+    return ws;
+}
+
+}  // namespace qgemm_detail
+
+/**
+ * @brief Int8 Conv2D (NHWC, uint8 in / out) quantized from a float Conv2D
+ */
+template<std::size_t InChannels, std::size_t OutChannels, std::size_t KernelH, std::size_t KernelW,
+         std::size_t Stride = 1, std::size_t Padding = 0>
+class QuantizedConv2D {
+public:
+    using Float = Conv2D<InChannels, OutChannels, KernelH, KernelW, Stride, Padding>;
+    static constexpr std::size_t patch_size = Float::patch_size;
+    static constexpr std::size_t pairs = (patch_size + 1) / 2;
+
+private:
+    template<typename T>
+    using Buffer = std::vector<T, nn_memory::TrackingAllocator<T>>;
+
+    static constexpr std::size_t panel_elements =
+        (OutChannels + qgemm_detail::nr - 1) / qgemm_detail::nr * qgemm_detail::nr * 2 * pairs;
+
+    // What a snapshot must match besides the table sizes
+    struct Meta {
+        std::uint64_t shape[7];  // InChannels, OutChannels, KernelH, KernelW, Stride, Padding, nr
+        QuantParams input;
+        QuantParams output;
+        std::uint32_t relu;
+    };
+
+    QuantParams input_;
+    QuantParams output_;
+    bool relu_;
+    Buffer<std::int8_t> weights_;    // [out][patch]
+    Buffer<std::int16_t> packed_;    // k-pair panels of weights_
+    Buffer<std::int32_t> offset_;    // [out] bias_q - input zero point * sum(w)
+    Buffer<float> multiplier_;       // [out] input scale * weight scale / output scale
+
+    // The tables the kernels read: the buffers above, or a snapshot mapping kept alive by mapping_
+    const std::int8_t* weights_data_ = nullptr;
+    const std::int16_t* packed_data_ = nullptr;
+    const std::int32_t* offset_data_ = nullptr;
+    const float* multiplier_data_ = nullptr;
+    std::shared_ptr<const nn_snapshot::Snapshot> mapping_;
+
+    QuantizedConv2D(QuantParams input, QuantParams output, bool relu)
+        : input_(input), output_(output), relu_(relu),
+          weights_(nn_memory::TrackingAllocator<std::int8_t>("QuantizedConv2D", nn_memory::MemoryPurpose::Weights)),
+          packed_(nn_memory::TrackingAllocator<std::int16_t>("QuantizedConv2D", nn_memory::MemoryPurpose::Weights)),
+          offset_(nn_memory::TrackingAllocator<std::int32_t>("QuantizedConv2D", nn_memory::MemoryPurpose::Weights)),
+          multiplier_(nn_memory::TrackingAllocator<float>("QuantizedConv2D", nn_memory::MemoryPurpose::Weights)) {}
+
+    Meta meta() const {
+        return {{InChannels, OutChannels, KernelH, KernelW, Stride, Padding, qgemm_detail::nr},
+                input_, output_, relu_ ? 1u : 0u};
+    }
+
+    // Fused epilogue of one output: int32 accumulator -> uint8
+    std::uint8_t requantize(std::int32_t acc, std::size_t o) const {
+        const long q =
+            std::lrint(static_cast<float>(acc + offset_data_[o]) * multiplier_data_[o]) + output_.zero_point;
+        return static_cast<std::uint8_t>(std::clamp(q, relu_ ? static_cast<long>(output_.zero_point) : 0L, 255L));
+    }
+
+public:
+    QuantizedConv2D(const Float& conv, QuantParams input, QuantParams output, bool relu = true)
+        : QuantizedConv2D(input, output, relu) {
+        weights_.resize(OutChannels * patch_size);
+        offset_.resize(OutChannels);
+        multiplier_.resize(OutChannels);
+        for (std::size_t o = 0; o < OutChannels; ++o) {
+            const float* w = conv.get_weights().data() + o * patch_size;
+            float max_abs = 0.0f;
+            for (std::size_t k = 0; k < patch_size; ++k) max_abs = std::max(max_abs, std::fabs(w[k]));
+            const float scale = max_abs > 0.0f ? max_abs / 127.0f : 1.0f;
+            std::int32_t sum = 0;
+            for (std::size_t k = 0; k < patch_size; ++k) {
+                const auto q = static_cast<std::int8_t>(std::lrint(w[k] / scale));
+                weights_[o * patch_size + k] = q;
+                sum += q;
+            }
+            const float acc_scale = input_.scale * scale;
+            offset_[o] = static_cast<std::int32_t>(std::lrint(conv.get_bias()(o) / acc_scale)) -
+                         input_.zero_point * sum;
+            multiplier_[o] = acc_scale / output_.scale;
+        }
+        packed_.resize(panel_elements);
+        qgemm_detail::pack_weights(weights_.data(), OutChannels, patch_size, packed_.data());
+        weights_data_ = weights_.data();
+        packed_data_ = packed_.data();
+        offset_data_ = offset_.data();
+        multiplier_data_ = multiplier_.data();
+    }
+
+    // The tables point into this object or a mapping: movable, not copyable
+    QuantizedConv2D(QuantizedConv2D&&) = default;
+    QuantizedConv2D(const QuantizedConv2D&) = delete;
+    QuantizedConv2D& operator=(const QuantizedConv2D&) = delete;
+
+    // Sections name.meta / .weights / .panels / .offset / .multiplier
+    void save(nn_snapshot::Writer& writer, const std::string& name) const {
+        const Meta m = meta();
+        writer.add(name + ".meta", &m, sizeof(m));
+        writer.add(name + ".weights", std::span(weights_data_, OutChannels * patch_size));
+        writer.add(name + ".panels", std::span(packed_data_, panel_elements));
+        writer.add(name + ".offset", std::span(offset_data_, OutChannels));
+        writer.add(name + ".multiplier", std::span(multiplier_data_, OutChannels));
+    }
+
+    /**
+     * @brief The layer saved as name, reading its tables from the mapping in place;
+     * nullopt and a message if the sections are missing or were saved by another shape
+     */
+    static std::optional<QuantizedConv2D> load(std::shared_ptr<const nn_snapshot::Snapshot> snapshot,
+                                               const std::string& name, std::string& error) {
+        const auto meta_bytes = snapshot->array<Meta>(name + ".meta", 1);
+        const auto weights = snapshot->array<std::int8_t>(name + ".weights", OutChannels * patch_size);
+        const auto packed = snapshot->array<std::int16_t>(name + ".panels", panel_elements);
+        const auto offset = snapshot->array<std::int32_t>(name + ".offset", OutChannels);
+        const auto multiplier = snapshot->array<float>(name + ".multiplier", OutChannels);
+        if (meta_bytes.empty() || weights.empty() || packed.empty() || offset.empty() || multiplier.empty()) {
+            error = "snapshot has no complete layer '" + name + "' of this shape";
+            return std::nullopt;
+        }
+        Meta m;
+        std::memcpy(&m, meta_bytes.data(), sizeof(m));
+        QuantizedConv2D layer(m.input, m.output, m.relu != 0);
+        const Meta expected = layer.meta();
+        if (!std::equal(std::begin(m.shape), std::end(m.shape), std::begin(expected.shape))) {
+            error = "layer '" + name + "' was saved with another shape or panel layout";
+            return std::nullopt;
+        }
+        layer.weights_data_ = weights.data();
+        layer.packed_data_ = packed.data();
+        layer.offset_data_ = offset.data();
+        layer.multiplier_data_ = multiplier.data();
+        layer.mapping_ = std::move(snapshot);
+        return layer;
+    }
+
+    const QuantParams& input_params() const { return input_; }
+    const QuantParams& output_params() const { return output_; }
+
+    static constexpr std::size_t output_height(std::size_t height) { return Float::output_height(height); }
+    static constexpr std::size_t output_width(std::size_t width) { return Float::output_width(width); }
+
+    /**
+     * @brief Implicit-GEMM forward: input [batch, height, width, InChannels]
+     * -> output [batch, output_height(height), output_width(width), OutChannels]
+     */
+    void forward(const std::uint8_t* input, std::size_t batch, std::size_t height, std::size_t width,
+                 std::uint8_t* output, ThreadPool& pool = ThreadPool::global()) const {
+        NN_PROFILE_ZONE("QuantizedConv2D::forward");
+        using namespace qgemm_detail;
+        if (height + 2 * Padding < KernelH || width + 2 * Padding < KernelW) return;
+        const conv_detail::Geometry g{height, width, output_height(height), output_width(width)};
+        const std::size_t pixels = batch * g.out_height * g.out_width;
+        NN_METRICS_KERNEL("conv2d_int8", 2 * pixels * OutChannels * patch_size,
+                          batch * height * width * InChannels + OutChannels * patch_size + pixels * OutChannels);
+        const auto pad = static_cast<std::int16_t>(input_.zero_point);  // real 0
+
+        const std::size_t row_tiles = (pixels + mc - 1) / mc;
+        const std::size_t col_tiles = (OutChannels + nc - 1) / nc;
+        pool.parallel_for(row_tiles * col_tiles, [&](std::size_t t, std::size_t) {
+            const std::size_t m0 = t / col_tiles * mc, n0 = t % col_tiles * nc;
+            const std::size_t rows = std::min(mc, pixels - m0);
+            const std::size_t cols = std::min(nc, OutChannels - n0);
+            Workspace& ws = workspace();
+            std::fill(ws.acc.begin(), ws.acc.begin() + rows * nc, 0);
+
+            for (std::size_t k0 = 0; k0 < patch_size; k0 += kc) {
+                const std::size_t depth = std::min(kc, patch_size - k0);
+                const std::size_t block_pairs = (depth + 1) / 2;
+                const std::size_t lda = 2 * block_pairs;
+                for (std::size_t r = 0; r < rows; ++r) {
+                    std::int16_t* a = ws.a.data() + r * lda;
+                    conv_detail::gather_patch(typename Float::Patch{}, input, g, m0 + r, k0, depth, a, pad);
+                    if (depth % 2) a[depth] = 0;
+                }
+                for (std::size_t p = 0; p < cols; p += nr) {
+                    const std::size_t width_p = std::min(nr, cols - p);
+                    const std::int16_t* panel = packed_data_ + ((n0 + p) * pairs + k0 / 2 * nr) * 2;
+                    std::size_t r = 0;
+                    for (; r + mr <= rows; r += mr) {
+                        micro_kernel<mr>(block_pairs, ws.a.data() + r * lda, lda, panel, ws.acc.data() + r * nc + p,
+                                         nc, width_p);
+                    }
+                    for (; r < rows; ++r) {
+                        micro_kernel<1>(block_pairs, ws.a.data() + r * lda, lda, panel, ws.acc.data() + r * nc + p,
+                                        nc, width_p);
+                    }
+                }
+            }
+
+            for (std::size_t r = 0; r < rows; ++r) {
+                std::uint8_t* out = output + (m0 + r) * OutChannels + n0;
+                const std::int32_t* acc = ws.acc.data() + r * nc;
+                for (std::size_t j = 0; j < cols; ++j) out[j] = requantize(acc[j], n0 + j);
+            }
+        });
+    }
+
+    /**
+     * @brief Direct forward (same results): one int32 dot product per output,
+     * for layers too small to fill GEMM tiles
+     */
+    void forward_direct(const std::uint8_t* input, std::size_t batch, std::size_t height, std::size_t width,
+                        std::uint8_t* output, ThreadPool& pool = ThreadPool::global()) const {
+        NN_PROFILE_ZONE("QuantizedConv2D::forward_direct");
+        if (height + 2 * Padding < KernelH || width + 2 * Padding < KernelW) return;
+        const conv_detail::Geometry g{height, width, output_height(height), output_width(width)};
+        const std::size_t pixels = batch * g.out_height * g.out_width;
+        NN_METRICS_KERNEL("conv2d_int8_direct", 2 * pixels * OutChannels * patch_size,
+                          batch * height * width * InChannels + OutChannels * patch_size + pixels * OutChannels);
+        const auto pad = static_cast<std::uint8_t>(input_.zero_point);
+        pool.parallel_ranges(pixels, [&](std::size_t begin, std::size_t end, std::size_t) {
+            std::uint8_t patch[patch_size];
+            for (std::size_t m = begin; m < end; ++m) {
+                conv_detail::gather_patch(typename Float::Patch{}, input, g, m, 0, patch_size, patch, pad);
+                for (std::size_t o = 0; o < OutChannels; ++o) {
+                    const std::int8_t* w = weights_data_ + o * patch_size;
+                    std::int32_t acc = 0;
+                    for (std::size_t k = 0; k < patch_size; ++k) acc += static_cast<std::int32_t>(patch[k]) * w[k];
+                    output[m * OutChannels + o] = requantize(acc, o);
+                }
+            }
+        });
+    }
+};
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "tensor.hpp"
+#include "thread_pool.hpp"
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * @brief Counter-based random numbers (Philox4x32-10)
+ *
+ * Philox maps (counter, key) to four random 32-bit words with ten rounds of
+ * multiply/xor; there is no sequential state. Element i of a fill uses word
+ * i % 4 of block offset + i / 4, so any range can be generated on its own:
+ * tensors fill in parallel with results independent of the thread count, and
+ * e.g. a dropout mask can be regenerated in backward instead of stored. The
+ * key is the seed; the upper counter words select an independent stream.
+ */
+
+namespace nn_random {
+
+namespace detail {
+
+constexpr std::uint32_t philox_m0 = 0xD2511F53u;
+constexpr std::uint32_t philox_m1 = 0xCD9E8D57u;
+constexpr std::uint32_t philox_w0 = 0x9E3779B9u;
+constexpr std::uint32_t philox_w1 = 0xBB67AE85u;
+
+// Counter blocks generated together by the lane-parallel path
+constexpr std::size_t block_lanes = 16;
+
+// Elements per parallel task; smaller fills run on the calling thread
+constexpr std::size_t fill_grain = 1 << 16;
+
+constexpr void philox_round(std::uint32_t& c0, std::uint32_t& c1, std::uint32_t& c2, std::uint32_t& c3,
+                            std::uint32_t k0, std::uint32_t k1) {
+    const std::uint64_t p0 = std::uint64_t(philox_m0) * c0;
+    const std::uint64_t p1 = std::uint64_t(philox_m1) * c2;
+    const std::uint32_t n0 = std::uint32_t(p1 >> 32) ^ c1 ^ k0;
+    const std::uint32_t n2 = std::uint32_t(p0 >> 32) ^ c3 ^ k1;
+    c1 = std::uint32_t(p1);
+    c3 = std::uint32_t(p0);
+    c0 = n0;
+    c2 = n2;
+}
+
+// 24 random bits -> [0, 1) float; 32 bits -> [0, 1) double
+template<typename T>
+constexpr T to_unit(std::uint32_t bits) {
+    if constexpr (std::is_same_v<T, float>) {
+        return static_cast<float>(bits >> 8) * 0x1.0p-24f;
+    } else {
+        return static_cast<T>(bits) * static_cast<T>(0x1.0p-32);
+    }
+}
+
+}  // namespace detail
+
+/**
+ * @brief Philox4x32-10 generator: a seed and a stream id, no mutable state
+ */
+class Philox {
+private:
+    std::uint64_t seed_;
+    std::uint64_t stream_;
+
+    // Blocks [first, first + block_lanes): out[word][lane]. One lane per loop
+    // iteration with all ten rounds inside, so the loop vectorizes over lanes.
+    void block_batch(std::uint64_t first, std::uint32_t (&out)[4][detail::block_lanes]) const {
+        std::uint32_t keys[10][2];
+        std::uint32_t k0 = std::uint32_t(seed_), k1 = std::uint32_t(seed_ >> 32);
+        for (int round = 0; round < 10; ++round) {
+            keys[round][0] = k0;
+            keys[round][1] = k1;
+            k0 += detail::philox_w0;
+            k1 += detail::philox_w1;
+        }
+        const std::uint32_t s0 = std::uint32_t(stream_), s1 = std::uint32_t(stream_ >> 32);
+        for (std::size_t l = 0; l < detail::block_lanes; ++l) {
+            std::uint32_t c0 = std::uint32_t(first + l), c1 = std::uint32_t((first + l) >> 32);
+            std::uint32_t c2 = s0, c3 = s1;
+            for (int round = 0; round < 10; ++round) {
+                detail::philox_round(c0, c1, c2, c3, keys[round][0], keys[round][1]);
+            }
+            out[0][l] = c0;
+            out[1][l] = c1;
+            out[2][l] = c2;
+            out[3][l] = c3;
+        }
+    }
+
+public:
+    constexpr explicit Philox(std::uint64_t seed, std::uint64_t stream = 0) : seed_(seed), stream_(stream) {}
+
+    // Independent generator with the same seed
+    constexpr Philox substream(std::uint64_t stream) const { return Philox(seed_, stream); }
+
+    constexpr std::uint64_t seed() const { return seed_; }
+    constexpr std::uint64_t stream() const { return stream_; }
+
+    // Four random words of counter block `index`
+    constexpr std::array<std::uint32_t, 4> block(std::uint64_t index) const {
+        std::uint32_t c0 = std::uint32_t(index), c1 = std::uint32_t(index >> 32);
+        std::uint32_t c2 = std::uint32_t(stream_), c3 = std::uint32_t(stream_ >> 32);
+        std::uint32_t k0 = std::uint32_t(seed_), k1 = std::uint32_t(seed_ >> 32);
+        for (int round = 0; round < 10; ++round) {
+            detail::philox_round(c0, c1, c2, c3, k0, k1);
+            k0 += detail::philox_w0;
+            k1 += detail::philox_w1;
+        }
+        return {c0, c1, c2, c3};
+    }
+
+    // Random word of element `index` (offset in blocks, as in the fills)
+    constexpr std::uint32_t word(std::size_t index, std::uint64_t offset = 0) const {
+        return block(offset + index / 4)[index % 4];
+    }
+
+    // Run f(word, index) for every element index in [begin, end). Whole
+    // batches of block_lanes blocks are generated lane-parallel (SoA), which
+    // the compiler vectorizes; the ragged edges go block by block.
+    template<typename F>
+    void for_each_word(std::size_t begin, std::size_t end, std::uint64_t offset, F&& f) const {
+        constexpr std::size_t batch = 4 * detail::block_lanes;
+        std::size_t i = begin;
+        while (i < end && (i % batch != 0 || end - i < batch)) {
+            const auto words = block(offset + i / 4);
+            for (std::size_t k = i % 4; k < 4 && i < end; ++k, ++i) f(words[k], i);
+        }
+        std::uint32_t lanes[4][detail::block_lanes];
+        for (; i + batch <= end; i += batch) {
+            block_batch(offset + i / 4, lanes);
+            for (std::size_t l = 0; l < detail::block_lanes; ++l) {
+                for (std::size_t k = 0; k < 4; ++k) f(lanes[k][l], i + 4 * l + k);
+            }
+        }
+        while (i < end) {
+            const auto words = block(offset + i / 4);
+            for (std::size_t k = 0; k < 4 && i < end; ++k, ++i) f(words[k], i);
+        }
+    }
+
+    // Elements [begin, end) of a fill; begin/end need not be block aligned
+    template<typename T>
+    void uniform_range(T* out, std::size_t begin, std::size_t end, T lo, T hi, std::uint64_t offset = 0) const {
+        const T range = hi - lo;
+        for_each_word(begin, end, offset, [&](std::uint32_t w, std::size_t i) {
+            out[i] = lo + range * detail::to_unit<T>(w);
+        });
+    }
+
+    // Box-Muller on word pairs (0,1) and (2,3) of each block
+    template<typename T>
+    void normal_range(T* out, std::size_t begin, std::size_t end, T mean, T stddev,
+                      std::uint64_t offset = 0) const {
+        constexpr T two_pi = static_cast<T>(6.283185307179586);
+        std::size_t i = begin;
+        while (i < end) {
+            const auto words = block(offset + i / 4);
+            T values[4];
+            for (std::size_t pair = 0; pair < 4; pair += 2) {
+                // 1 - u keeps the log argument in (0, 1]
+                const T radius = std::sqrt(T(-2) * std::log(T(1) - detail::to_unit<T>(words[pair])));
+                const T angle = two_pi * detail::to_unit<T>(words[pair + 1]);
+                values[pair] = radius * std::cos(angle);
+                values[pair + 1] = radius * std::sin(angle);
+            }
+            for (std::size_t k = i % 4; k < 4 && i < end; ++k, ++i) out[i] = mean + stddev * values[k];
+        }
+    }
+
+    // mask[i] = 1 with probability keep_prob
+    void bernoulli_range(std::uint8_t* mask, std::size_t begin, std::size_t end, float keep_prob,
+                         std::uint64_t offset = 0) const {
+        const std::uint64_t threshold = static_cast<std::uint64_t>(
+            static_cast<double>(keep_prob) * 4294967296.0);
+        for_each_word(begin, end, offset, [&](std::uint32_t w, std::size_t i) {
+            mask[i] = static_cast<std::uint8_t>(w < threshold);
+        });
+    }
+};
+
+// Split [0, n) into block-aligned tasks of fill_grain elements: f(begin, end)
+template<typename F>
+void parallel_fill(std::size_t n, ThreadPool& pool, F&& f) {
+    const std::size_t tasks = (n + detail::fill_grain - 1) / detail::fill_grain;
+    pool.parallel_for(tasks, [&](std::size_t task, std::size_t) {
+        const std::size_t begin = task * detail::fill_grain;
+        f(begin, begin + detail::fill_grain < n ? begin + detail::fill_grain : n);
+    });
+}
+
+template<typename T, std::size_t... Dims>
+void uniform_(Tensor<T, Dims...>& tensor, const Philox& rng, T lo = T(0), T hi = T(1),
+              ThreadPool& pool = ThreadPool::global()) {
+    parallel_fill(tensor.size(), pool, [&](std::size_t begin, std::size_t end) {
+        rng.uniform_range(tensor.data(), begin, end, lo, hi);
+    });
+}
+
+template<typename T, std::size_t... Dims>
+void normal_(Tensor<T, Dims...>& tensor, const Philox& rng, T mean = T(0), T stddev = T(1),
+             ThreadPool& pool = ThreadPool::global()) {
+    parallel_fill(tensor.size(), pool, [&](std::size_t begin, std::size_t end) {
+        rng.normal_range(tensor.data(), begin, end, mean, stddev);
+    });
+}
+
+// Glorot/Xavier uniform init of a [Out, In] weight matrix
+template<typename T, std::size_t Out, std::size_t In>
+void xavier_uniform_(Tensor<T, Out, In>& weights, const Philox& rng, ThreadPool& pool = ThreadPool::global()) {
+    const T limit = static_cast<T>(std::sqrt(6.0 / static_cast<double>(In + Out)));
+    uniform_(weights, rng, -limit, limit, pool);
+}
+
+}  // namespace nn_random
@@ -0,0 +1,240 @@
+#pragma once
+
+#include "tensor.hpp"
+#include "thread_pool.hpp"
+#include "random.hpp"
+#include "loss.hpp"
+#include "profiler.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Temperature, top-k and top-p (nucleus) sampling over logits
+ *
+ * No full sort of the vocabulary: logits are mapped to order-preserving
+ * 32-bit keys and bucketed by their top 11 bits.
+ *   - top-k: a count histogram finds the bucket holding the k-th largest
+ *     logit (radix select); only that bucket is partially sorted.
+ *   - top-p: a probability-mass histogram finds the bucket where the
+ *     cumulative mass crosses p; everything above it is in the nucleus.
+ * The surviving candidates (usually tens to hundreds) are sorted, the exact
+ * top-p cut is applied and one token is drawn with a Philox uniform. The
+ * max/exp passes reuse the vectorized kernels of loss.hpp; rows of a batch
+ * are sampled in parallel.
+ */
+
+struct SamplingParams {
+    float temperature = 1.0f;  // <= 0: greedy (argmax)
+    std::size_t top_k = 0;     // 0: disabled
+    float top_p = 1.0f;        // >= 1: disabled
+};
+
+namespace sampling_detail {
+
+constexpr int bucket_bits = 11;
+constexpr std::size_t num_buckets = std::size_t(1) << bucket_bits;
+
+// Order-preserving unsigned key of a float
+inline std::uint32_t ordered_key(float v) {
+    std::uint32_t u = std::bit_cast<std::uint32_t>(v);
+    return u ^ (static_cast<std::uint32_t>(static_cast<std::int32_t>(u) >> 31) | 0x80000000u);
+}
+
+inline std::size_t bucket_of(float v) { return ordered_key(v) >> (32 - bucket_bits); }
+
+// Max over a row of any length
+inline float row_max(const float* x, std::size_t n) {
+    const std::size_t vec_end = n / loss_detail::loss_lanes * loss_detail::loss_lanes;
+    float m = vec_end > 0 ? loss_detail::block_lane_max(x, vec_end) : x[0];
+    for (std::size_t i = vec_end; i < n; ++i) m = x[i] > m ? x[i] : m;
+    return m;
+}
+
+struct Candidate {
+    float logit;
+    std::uint32_t index;
+};
+
+// Per-worker scratch, reused across rows
+struct Workspace {
+    std::vector<std::uint32_t> counts = std::vector<std::uint32_t>(num_buckets);
+    std::vector<float> mass = std::vector<float>(num_buckets);
+    std::vector<Candidate> candidates;
+    std::vector<Candidate> ties;
+};
+
+inline Workspace& workspace() {
+    static thread_local Workspace ws;
+    return ws;
+}
+
+// The k largest logits (unordered) via a count histogram of key buckets
+inline void select_top_k(const float* logits, std::size_t vocab, std::size_t k, Workspace& ws) {
+    std::fill(ws.counts.begin(), ws.counts.end(), 0u);
+    for (std::size_t i = 0; i < vocab; ++i) ++ws.counts[bucket_of(logits[i])];
+
+    std::size_t above = 0, pivot = num_buckets - 1;
+    while (above + ws.counts[pivot] < k) above += ws.counts[pivot--];
+
+    ws.candidates.clear();
+    ws.ties.clear();
+    for (std::size_t i = 0; i < vocab; ++i) {
+        const std::size_t b = bucket_of(logits[i]);
+        if (b > pivot) {
+            ws.candidates.push_back({logits[i], static_cast<std::uint32_t>(i)});
+        } else if (b == pivot) {
+            ws.ties.push_back({logits[i], static_cast<std::uint32_t>(i)});
+        }
+    }
+    const std::size_t need = k - above;
+    std::nth_element(ws.ties.begin(), ws.ties.begin() + (need - 1), ws.ties.end(),
+                     [](const Candidate& a, const Candidate& b) { return a.logit > b.logit; });
+    ws.candidates.insert(ws.candidates.end(), ws.ties.begin(), ws.ties.begin() + need);
+}
+
+// Superset of the nucleus: all logits in buckets at or above the one where
+// the cumulative mass (from the top) reaches p. Returns the total mass.
+inline float select_nucleus(const float* logits, std::size_t vocab, float max_logit, float inv_temp,
+                            float top_p, Workspace& ws) {
+    std::fill(ws.mass.begin(), ws.mass.end(), 0.0f);
+    for (std::size_t i = 0; i < vocab; ++i) {
+        ws.mass[bucket_of(logits[i])] += loss_detail::fast_exp((logits[i] - max_logit) * inv_temp);
+    }
+    float total = 0.0f;
+    for (float m : ws.mass) total += m;
+
+    const float target = top_p * total;
+    float cumulative = 0.0f;
+    std::size_t pivot = num_buckets - 1;
+    while (pivot > 0 && cumulative + ws.mass[pivot] < target) cumulative += ws.mass[pivot--];
+
+    ws.candidates.clear();
+    for (std::size_t i = 0; i < vocab; ++i) {
+        if (bucket_of(logits[i]) >= pivot) ws.candidates.push_back({logits[i], static_cast<std::uint32_t>(i)});
+    }
+    return total;
+}
+
+// Sort candidates, cut at top-p of `total` (0: candidate mass), draw with u
+inline std::size_t sample_candidates(std::vector<Candidate>& candidates, float max_logit, float inv_temp,
+                                     float top_p, float total, float u) {
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate& a, const Candidate& b) { return a.logit > b.logit; });
+    std::vector<float>& weights = workspace().mass;  // free again at this point
+    weights.resize(std::max(weights.size(), candidates.size()));
+    float candidate_mass = 0.0f;
+    for (std::size_t c = 0; c < candidates.size(); ++c) {
+        weights[c] = loss_detail::fast_exp((candidates[c].logit - max_logit) * inv_temp);
+        candidate_mass += weights[c];
+    }
+    if (total <= 0.0f) total = candidate_mass;
+
+    std::size_t keep = candidates.size();
+    float kept_mass = candidate_mass;
+    if (top_p < 1.0f) {
+        const float target = top_p * total;
+        float cumulative = 0.0f;
+        for (std::size_t c = 0; c < candidates.size(); ++c) {
+            cumulative += weights[c];
+            if (cumulative >= target) {
+                keep = c + 1;
+                kept_mass = cumulative;
+                break;
+            }
+        }
+    }
+
+    const float threshold = u * kept_mass;
+    float cumulative = 0.0f;
+    for (std::size_t c = 0; c < keep; ++c) {
+        cumulative += weights[c];
+        if (threshold < cumulative) return candidates[c].index;
+    }
+    return candidates[keep - 1].index;
+}
+
+}  // namespace sampling_detail
+
+/**
+ * @brief Indices of the k largest values of a row, in descending order
+ */
+inline std::vector<std::size_t> top_k(const float* logits, std::size_t vocab, std::size_t k) {
+    auto& ws = sampling_detail::workspace();
+    k = std::min(k, vocab);
+    std::vector<std::size_t> result;
+    if (k == 0) return result;
+    sampling_detail::select_top_k(logits, vocab, k, ws);
+    std::sort(ws.candidates.begin(), ws.candidates.end(),
+              [](const auto& a, const auto& b) { return a.logit > b.logit; });
+    for (const auto& c : ws.candidates) result.push_back(c.index);
+    return result;
+}
+
+/**
+ * @brief Draw one token from a row of logits; u is uniform in [0, 1)
+ */
+inline std::size_t sample_row(const float* logits, std::size_t vocab, const SamplingParams& params, float u) {
+    NN_PROFILE_ZONE("sample_row");
+    NN_METRICS_KERNEL("sampling", 3 * vocab, 2 * sizeof(float) * vocab);
+    using namespace sampling_detail;
+
+    const float max_logit = row_max(logits, vocab);
+    if (params.temperature <= 0.0f || params.top_k == 1) {
+        for (std::size_t i = 0; i < vocab; ++i) {
+            if (logits[i] == max_logit) return i;
+        }
+    }
+    const float inv_temp = 1.0f / params.temperature;
+    auto& ws = workspace();
+
+    if (params.top_k > 0 && params.top_k < vocab) {
+        select_top_k(logits, vocab, params.top_k, ws);
+        return sample_candidates(ws.candidates, max_logit, inv_temp, params.top_p, 0.0f, u);
+    }
+    if (params.top_p < 1.0f) {
+        float total = select_nucleus(logits, vocab, max_logit, inv_temp, params.top_p, ws);
+        return sample_candidates(ws.candidates, max_logit, inv_temp, params.top_p, total, u);
+    }
+
+    // Plain temperature sampling: inverse CDF in two streaming passes; the
+    // sums run in double so both passes agree over large vocabularies
+    double total = 0.0;
+    for (std::size_t i = 0; i < vocab; ++i) total += loss_detail::fast_exp((logits[i] - max_logit) * inv_temp);
+    const double threshold = u * total;
+    double cumulative = 0.0;
+    for (std::size_t i = 0; i < vocab; ++i) {
+        cumulative += loss_detail::fast_exp((logits[i] - max_logit) * inv_temp);
+        if (threshold < cumulative) return i;
+    }
+    return vocab - 1;
+}
+
+template<std::size_t Vocab>
+std::size_t sample(const Tensor<float, Vocab>& logits, const SamplingParams& params, float u) {
+    return sample_row(logits.data(), Vocab, params, u);
+}
+
+/**
+ * @brief Sample one token per sequence, rows in parallel
+ *
+ * Row b draws word b of the rng at block offset `step` * ceil(Batch / 4), so
+ * a decoding loop passes its step counter and results stay reproducible.
+ */
+template<std::size_t Batch, std::size_t Vocab>
+std::array<std::size_t, Batch> sample(const Tensor<float, Batch, Vocab>& logits, const SamplingParams& params,
+                                      const nn_random::Philox& rng, std::uint64_t step,
+                                      ThreadPool& pool = ThreadPool::global()) {
+    std::array<std::size_t, Batch> tokens{};
+    const std::uint64_t offset = step * ((Batch + 3) / 4);
+    pool.parallel_for(Batch, [&](std::size_t b, std::size_t) {
+        const float u = nn_random::detail::to_unit<float>(rng.word(b, offset));
+        tokens[b] = sample_row(logits.data() + b * Vocab, Vocab, params, u);
+    });
+    return tokens;
+}
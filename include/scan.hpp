@@ -0,0 +1,297 @@
+#pragma once
+
+#include "tensor_view.hpp"
+#include "thread_pool.hpp"
+#include "profiler.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Parallel prefix scans (cumsum, cumprod), plain and segmented, along any axis
+ *
+ * Along the last axis each line is a dependency chain. It is broken up in
+ * two ways:
+ *   - in registers: blocks of four floats are scanned with two shift-and-add
+ *     steps (log-step scan) plus one broadcast of the running carry, so the
+ *     serial chain is one op per block instead of one per element;
+ *   - across threads (when there are fewer lines than threads): reduce, then
+ *     scan. Each thread reduces its chunk, the chunk totals are scanned
+ *     serially into carries, and each thread scans its chunk from its carry.
+ *     Input is read twice and output written once.
+ * Along any other axis the scan runs row by row, out[k] = op(out[k - 1], in[k])
+ * over whole contiguous rows, which vectorizes across the row.
+ *
+ * A segmented scan restarts at every position whose head flag is set (one
+ * flag per position along the axis, shared by all lines), e.g. one segment
+ * per query in a ranking batch. Reassociation changes float rounding versus
+ * a strictly serial loop.
+ */
+
+namespace scan_ops {
+
+struct Sum {
+    template<typename T>
+    static constexpr T identity() { return T(0); }
+    template<typename V>
+    constexpr V operator()(const V& a, const V& b) const { return a + b; }
+};
+
+struct Product {
+    template<typename T>
+    static constexpr T identity() { return T(1); }
+    template<typename V>
+    constexpr V operator()(const V& a, const V& b) const { return a * b; }
+};
+
+}  // namespace scan_ops
+
+namespace scan_detail {
+
+constexpr std::size_t parallel_grain = 1 << 16;  // min elements per thread for a split line
+constexpr std::size_t reduce_lanes = 16;
+constexpr std::size_t column_chunk = 1024;       // row elements per task for non-last axes
+
+/**
+ * @brief Scan of one strided run from `carry`; returns the carry out
+ *
+ * heads (may be null): heads[j] != 0 restarts the scan at j.
+ */
+template<typename T, typename Op, bool Exclusive>
+inline T scan_run(const T* x, std::ptrdiff_t x_stride, T* y, std::ptrdiff_t y_stride, std::size_t n, T carry,
+                  const std::uint8_t* heads, Op op) {
+    const auto scalar = [&](std::size_t begin, std::size_t end) {
+        for (std::size_t j = begin; j < end; ++j) {
+            const std::ptrdiff_t sj = static_cast<std::ptrdiff_t>(j);
+            const T value = x[sj * x_stride];
+            if (heads && heads[j]) carry = Op::template identity<T>();
+            if constexpr (Exclusive) y[sj * y_stride] = carry;
+            carry = op(carry, value);
+            if constexpr (!Exclusive) y[sj * y_stride] = carry;
+        }
+    };
+    std::size_t j = 0;
+#if defined(__GNUC__) && !defined(__clang__)
+    if constexpr (std::is_same_v<T, float>) {
+        if (x_stride == 1 && y_stride == 1) {
+            typedef float v4f __attribute__((vector_size(16)));
+            typedef int v4i __attribute__((vector_size(16)));
+            const float id = Op::template identity<float>();
+            const v4f identity = {id, id, id, id};
+            for (; j + 4 <= n; j += 4) {
+                if (heads) {
+                    std::uint32_t block_heads;
+                    std::memcpy(&block_heads, heads + j, sizeof(block_heads));
+                    if (block_heads != 0) {
+                        scalar(j, j + 4);
+                        continue;
+                    }
+                }
+                v4f v;
+                std::memcpy(&v, x + j, sizeof(v));
+                v = op(v, __builtin_shuffle(identity, v, v4i{0, 4, 5, 6}));
+                v = op(v, __builtin_shuffle(identity, v, v4i{0, 1, 4, 5}));
+                const v4f c = {carry, carry, carry, carry};
+                v = op(c, v);
+                if constexpr (Exclusive) {
+                    const v4f shifted = __builtin_shuffle(c, v, v4i{0, 4, 5, 6});
+                    std::memcpy(y + j, &shifted, sizeof(v));
+                } else {
+                    std::memcpy(y + j, &v, sizeof(v));
+                }
+                carry = v[3];
+            }
+        }
+    }
+#endif
+    scalar(j, n);
+    return carry;
+}
+
+// Reduction of a chunk from its last head (or its start); `restarted` tells which
+template<typename T, typename Op>
+inline T reduce_run(const T* x, std::ptrdiff_t stride, std::size_t n, const std::uint8_t* heads, Op op,
+                    bool& restarted) {
+    std::size_t begin = 0;
+    restarted = false;
+    if (heads) {
+        for (std::size_t j = n; j-- > 0;) {
+            if (heads[j]) {
+                begin = j;
+                restarted = true;
+                break;
+            }
+        }
+    }
+    T lanes[reduce_lanes];
+    for (std::size_t l = 0; l < reduce_lanes; ++l) lanes[l] = Op::template identity<T>();
+    std::size_t j = begin;
+    if (stride == 1) {
+        for (; j + reduce_lanes <= n; j += reduce_lanes) {
+            for (std::size_t l = 0; l < reduce_lanes; ++l) lanes[l] = op(lanes[l], x[j + l]);
+        }
+    }
+    T total = Op::template identity<T>();
+    for (std::size_t l = 0; l < reduce_lanes; ++l) total = op(total, lanes[l]);
+    for (; j < n; ++j) total = op(total, x[static_cast<std::ptrdiff_t>(j) * stride]);
+    return total;
+}
+
+// One line split across the pool: reduce, scan the chunk totals, scan from carries
+template<typename T, typename Op, bool Exclusive>
+void split_line(const T* x, std::ptrdiff_t x_stride, T* y, std::ptrdiff_t y_stride, std::size_t n,
+                const std::uint8_t* heads, Op op, ThreadPool& pool) {
+    const std::size_t parts = std::max<std::size_t>(1, std::min(pool.size(), n / parallel_grain));
+    if (parts == 1) {
+        scan_run<T, Op, Exclusive>(x, x_stride, y, y_stride, n, Op::template identity<T>(), heads, op);
+        return;
+    }
+    const auto chunk_begin = [&](std::size_t part) { return n * part / parts; };
+    std::vector<T> totals(parts);
+    std::vector<std::uint8_t> restarted(parts);
+    pool.parallel_for(parts, [&](std::size_t part, std::size_t) {
+        const std::size_t b = chunk_begin(part), e = chunk_begin(part + 1);
+        bool r = false;
+        totals[part] = reduce_run(x + static_cast<std::ptrdiff_t>(b) * x_stride, x_stride, e - b,
+                                  heads ? heads + b : nullptr, op, r);
+        restarted[part] = r;
+    });
+    std::vector<T> carries(parts);
+    T carry = Op::template identity<T>();
+    for (std::size_t part = 0; part < parts; ++part) {
+        carries[part] = carry;
+        carry = restarted[part] ? totals[part] : op(carry, totals[part]);
+    }
+    pool.parallel_for(parts, [&](std::size_t part, std::size_t) {
+        const std::size_t b = chunk_begin(part), e = chunk_begin(part + 1);
+        const std::ptrdiff_t sb = static_cast<std::ptrdiff_t>(b);
+        scan_run<T, Op, Exclusive>(x + sb * x_stride, x_stride, y + sb * y_stride, y_stride, e - b, carries[part],
+                                   heads ? heads + b : nullptr, op);
+    });
+}
+
+template<typename T, std::size_t Rank, typename Op, bool Exclusive>
+void scan(TensorView<const T, Rank> src, std::size_t axis, TensorView<T, Rank> dst, const std::uint8_t* heads,
+          Op op, ThreadPool& pool) {
+    NN_METRICS_KERNEL("scan", src.size(), 2 * sizeof(T) * src.size());
+    constexpr std::size_t last = Rank - 1;
+    const std::size_t n = src.shape(axis);
+
+    if (axis == last) {
+        const Odometer<Rank> lines(src.shape(), 1u << last);
+        if (lines.count() < pool.size()) {
+            Odometer<Rank> it = lines;
+            it.walk(0, lines.count(), [&](const auto& at) {
+                split_line<T, Op, Exclusive>(src.data() + src.offset(at), src.stride(last),
+                                             dst.data() + dst.offset(at), dst.stride(last), n, heads, op, pool);
+            });
+            return;
+        }
+        pool.parallel_ranges(lines.count(), [&](std::size_t begin, std::size_t end, std::size_t) {
+            Odometer<Rank> it = lines;
+            it.walk(begin, end, [&](const auto& at) {
+                scan_run<T, Op, Exclusive>(src.data() + src.offset(at), src.stride(last), dst.data() + dst.offset(at),
+                                           dst.stride(last), n, Op::template identity<T>(), heads, op);
+            });
+        });
+        return;
+    }
+
+    // Row by row along `axis`; tasks are (outer position, chunk of the last axis)
+    const Odometer<Rank> lines(src.shape(), (1u << axis) | (1u << last));
+    const std::size_t width = src.shape(last);
+    const std::size_t chunks = (width + column_chunk - 1) / column_chunk;
+    const std::ptrdiff_t xs = src.stride(last), ys = dst.stride(last);
+    pool.parallel_for(lines.count() * chunks, [&](std::size_t task, std::size_t) {
+        Odometer<Rank> it = lines;
+        it.seek(task / chunks);
+        const std::size_t j0 = (task % chunks) * column_chunk, w = std::min(width, j0 + column_chunk) - j0;
+        const T* x = src.data() + src.offset(it.index()) + static_cast<std::ptrdiff_t>(j0) * xs;
+        T* y = dst.data() + dst.offset(it.index()) + static_cast<std::ptrdiff_t>(j0) * ys;
+        std::vector<T> carry(w, Op::template identity<T>());
+        for (std::size_t k = 0; k < n; ++k) {
+            const T* xk = x + static_cast<std::ptrdiff_t>(k) * src.stride(axis);
+            T* yk = y + static_cast<std::ptrdiff_t>(k) * dst.stride(axis);
+            if (heads && heads[k]) std::fill(carry.begin(), carry.end(), Op::template identity<T>());
+            if (xs == 1 && ys == 1) {
+                for (std::size_t j = 0; j < w; ++j) {
+                    const T value = xk[j];
+                    if constexpr (Exclusive) yk[j] = carry[j];
+                    carry[j] = op(carry[j], value);
+                    if constexpr (!Exclusive) yk[j] = carry[j];
+                }
+            } else {
+                for (std::size_t j = 0; j < w; ++j) {
+                    const std::ptrdiff_t sj = static_cast<std::ptrdiff_t>(j);
+                    const T value = xk[sj * xs];
+                    if constexpr (Exclusive) yk[sj * ys] = carry[j];
+                    carry[j] = op(carry[j], value);
+                    if constexpr (!Exclusive) yk[sj * ys] = carry[j];
+                }
+            }
+        }
+    });
+}
+
+}  // namespace scan_detail
+
+/**
+ * @brief dst[.., k, ..] = op(src[.., 0, ..], ..., src[.., k, ..]) along axis; dst may alias src
+ */
+template<typename T, std::size_t Rank, typename Op = scan_ops::Sum>
+void inclusive_scan(ConstView<T, Rank> src, std::size_t axis, TensorView<T, Rank> dst, Op op = {},
+                    ThreadPool& pool = ThreadPool::global()) {
+    NN_PROFILE_ZONE("inclusive_scan");
+    scan_detail::scan<T, Rank, Op, false>(src, axis, dst, nullptr, op, pool);
+}
+
+// dst[.., k, ..] = op(src[.., 0, ..], ..., src[.., k - 1, ..]); identity at k = 0
+template<typename T, std::size_t Rank, typename Op = scan_ops::Sum>
+void exclusive_scan(ConstView<T, Rank> src, std::size_t axis, TensorView<T, Rank> dst, Op op = {},
+                    ThreadPool& pool = ThreadPool::global()) {
+    NN_PROFILE_ZONE("exclusive_scan");
+    scan_detail::scan<T, Rank, Op, true>(src, axis, dst, nullptr, op, pool);
+}
+
+/**
+ * @brief Inclusive scan restarting where heads[k] != 0; heads.size() == src.shape(axis)
+ */
+template<typename T, std::size_t Rank, typename Op = scan_ops::Sum>
+void segmented_scan(ConstView<T, Rank> src, std::size_t axis, std::span<const std::uint8_t> heads,
+                    TensorView<T, Rank> dst, Op op = {}, ThreadPool& pool = ThreadPool::global()) {
+    NN_PROFILE_ZONE("segmented_scan");
+    scan_detail::scan<T, Rank, Op, false>(src, axis, dst, heads.data(), op, pool);
+}
+
+template<typename T, std::size_t Rank>
+void cumsum(ConstView<T, Rank> src, std::size_t axis, TensorView<T, Rank> dst,
+            ThreadPool& pool = ThreadPool::global()) {
+    inclusive_scan(src, axis, dst, scan_ops::Sum{}, pool);
+}
+
+template<typename T, std::size_t Rank>
+void cumprod(ConstView<T, Rank> src, std::size_t axis, TensorView<T, Rank> dst,
+             ThreadPool& pool = ThreadPool::global()) {
+    inclusive_scan(src, axis, dst, scan_ops::Product{}, pool);
+}
+
+template<typename T, std::size_t... Dims>
+Tensor<T, Dims...> cumsum(const Tensor<T, Dims...>& input, std::size_t axis,
+                          ThreadPool& pool = ThreadPool::global()) {
+    Tensor<T, Dims...> output;
+    cumsum(view(input), axis, view(output), pool);
+    return output;
+}
+
+template<typename T, std::size_t... Dims>
+Tensor<T, Dims...> cumprod(const Tensor<T, Dims...>& input, std::size_t axis,
+                           ThreadPool& pool = ThreadPool::global()) {
+    Tensor<T, Dims...> output;
+    cumprod(view(input), axis, view(output), pool);
+    return output;
+}
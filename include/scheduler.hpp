@@ -0,0 +1,333 @@
+#pragma once
+
+#include "metrics.hpp"
+#include "profiler.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Deadline- and priority-aware inference request scheduler
+ *
+ * Requests are submitted to one of several priority classes (0 is the most
+ * urgent) and are executed by a dispatcher thread that drives a ThreadPool
+ * for the parallelism inside each layer. A request is a sequence of steps,
+ * one per layer (GraphExecutor::run_step fits directly), and the dispatcher
+ * returns to its queues after every step:
+ *
+ * - the highest non-empty class always goes first, so a started request of
+ *   a lower class is preempted at the next layer boundary and resumes from
+ *   where it stopped once the higher classes are idle;
+ * - within a class, requests start in earliest-deadline-first order, and a
+ *   started request runs to completion unless a higher class preempts it.
+ *
+ * Step times are learned per request kind (an exponential moving average),
+ * which gives early rejection: submit() refuses a request whose deadline
+ * cannot be met after the work already queued ahead of it, and a queued
+ * request that can no longer make its deadline when it comes up is dropped
+ * (Expired) before any of its compute is spent. Kinds with no samples yet
+ * are assumed free, so the first requests of a kind are always admitted.
+ *
+ * Queue depth per class is reported to nn_metrics (the class name is the
+ * model label). Outcomes and their latencies are kept per class for stats().
+ */
+
+namespace nn_scheduler {
+
+using Clock = std::chrono::steady_clock;
+
+enum class Status {
+    Completed,  // ran every step; met_deadline tells whether it was in time
+    Rejected,   // refused by submit(): the deadline was unreachable on arrival
+    Expired,    // dropped unstarted: the deadline became unreachable while queued
+    Cancelled,  // still queued or unfinished when the scheduler was destroyed
+};
+
+struct Outcome {
+    Status status = Status::Completed;
+    bool met_deadline = false;
+    double latency_us = 0.0;  // submit() to completion or drop
+};
+
+struct Request {
+    std::size_t priority = 0;  // class index, 0 = most urgent
+    Clock::time_point deadline = Clock::time_point::max();
+    std::string kind;          // cost model key: requests of one kind have similar steps
+    std::size_t steps = 1;     // run_step(0 .. steps-1); preemption points lie between them
+    std::function<void(std::size_t step, ThreadPool& pool)> run_step;
+    std::function<void(const Outcome&)> done;  // optional; called on the dispatcher (or submitting) thread
+};
+
+struct ClassStats {
+    std::string name;
+    std::uint64_t submitted = 0;
+    std::uint64_t completed = 0;
+    std::uint64_t rejected = 0;
+    std::uint64_t expired = 0;
+    std::uint64_t missed = 0;       // completed after the deadline
+    std::uint64_t preempted = 0;    // times a started request of this class was set aside
+    std::vector<double> latencies;  // completed requests, microseconds, sorted
+
+    // q in [0, 1]; 0 without samples
+    double percentile(double q) const {
+        if (latencies.empty()) return 0.0;
+        const auto i = static_cast<std::size_t>(q * static_cast<double>(latencies.size() - 1) + 0.5);
+        return latencies[std::min(i, latencies.size() - 1)];
+    }
+};
+
+class Scheduler {
+private:
+    struct Entry {
+        Request request;
+        Clock::time_point submitted;
+        std::size_t next_step = 0;
+    };
+
+    struct Class {
+        std::string name;
+        std::vector<std::unique_ptr<Entry>> queue;  // min-heap by deadline
+        std::unique_ptr<Entry> running;             // started, not finished
+        ClassStats stats;
+    };
+
+    static bool later(const std::unique_ptr<Entry>& a, const std::unique_ptr<Entry>& b) {
+        return a->request.deadline > b->request.deadline;
+    }
+
+    static constexpr double ewma_weight = 0.2;
+
+    ThreadPool& pool_;
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::vector<Class> classes_;
+    std::map<std::string, double> step_us_;  // learned cost of one step per kind
+    const Entry* last_ = nullptr;            // the request whose step ran last
+    std::size_t in_flight_ = 0;              // queued + running + executing
+    bool stop_ = false;
+    std::thread dispatcher_;
+
+    double step_cost(const std::string& kind) const {
+        auto it = step_us_.find(kind);
+        return it == step_us_.end() ? 0.0 : it->second;
+    }
+
+    double remaining_us(const Entry& entry) const {
+        return static_cast<double>(entry.request.steps - entry.next_step) * step_cost(entry.request.kind);
+    }
+
+    // Learned cost of the work that runs before a new request of class c with this deadline
+    double work_ahead_us(std::size_t c, Clock::time_point deadline) const {
+        double total = 0.0;
+        for (std::size_t k = 0; k <= c; ++k) {
+            if (classes_[k].running) total += remaining_us(*classes_[k].running);
+            for (const auto& entry : classes_[k].queue) {
+                if (k < c || entry->request.deadline <= deadline) total += remaining_us(*entry);
+            }
+        }
+        return total;
+    }
+
+    static double since_us(Clock::time_point start, Clock::time_point now) {
+        return std::chrono::duration<double, std::micro>(now - start).count();
+    }
+
+    // Records the outcome under the lock; the callback runs after it is released
+    Outcome finish(Class& c, const Entry& entry, Status status, Clock::time_point now) {
+        Outcome outcome;
+        outcome.status = status;
+        outcome.latency_us = since_us(entry.submitted, now);
+        outcome.met_deadline = status == Status::Completed && now <= entry.request.deadline;
+        switch (status) {
+            case Status::Completed:
+                ++c.stats.completed;
+                if (!outcome.met_deadline) ++c.stats.missed;
+                c.stats.latencies.push_back(outcome.latency_us);
+                break;
+            case Status::Rejected: ++c.stats.rejected; break;
+            case Status::Expired: ++c.stats.expired; break;
+            case Status::Cancelled: break;
+        }
+        return outcome;
+    }
+
+    void settle(std::unique_lock<std::mutex>& lock, std::unique_ptr<Entry> entry, const Outcome& outcome) {
+        lock.unlock();
+        if (entry->request.done) entry->request.done(outcome);
+        entry.reset();
+        lock.lock();
+        if (--in_flight_ == 0) idle_.notify_all();
+    }
+
+    // Next request to step: the running one of the highest busy class, or its earliest deadline
+    Entry* pick(std::unique_lock<std::mutex>& lock) {
+        for (auto& c : classes_) {
+            while (!c.running && !c.queue.empty()) {
+                std::pop_heap(c.queue.begin(), c.queue.end(), later);
+                auto entry = std::move(c.queue.back());
+                c.queue.pop_back();
+                nn_metrics::queue_depth_add(c.name, -1);
+                const auto now = Clock::now();
+                const auto finish_at = now + std::chrono::duration_cast<Clock::duration>(
+                                                 std::chrono::duration<double, std::micro>(remaining_us(*entry)));
+                if (finish_at <= entry->request.deadline) {
+                    c.running = std::move(entry);
+                    break;
+                }
+                const Outcome outcome = finish(c, *entry, Status::Expired, now);
+                settle(lock, std::move(entry), outcome);
+            }
+            if (c.running) return c.running.get();
+        }
+        return nullptr;
+    }
+
+    void dispatch() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            wake_.wait(lock, [&] {
+                if (stop_) return true;
+                for (const auto& c : classes_) {
+                    if (c.running || !c.queue.empty()) return true;
+                }
+                return false;
+            });
+            if (stop_) return;
+            Entry* entry = pick(lock);
+            if (entry == nullptr) continue;
+            if (last_ != nullptr && last_ != entry) {
+                for (auto& c : classes_) {
+                    if (c.running.get() == last_) ++c.stats.preempted;
+                }
+            }
+            last_ = entry;
+            const std::size_t step = entry->next_step;
+            lock.unlock();
+            const auto start = Clock::now();
+            {
+                NN_PROFILE_ZONE("Scheduler::step");
+                entry->request.run_step(step, pool_);
+            }
+            const auto end = Clock::now();
+            lock.lock();
+
+            const double us = since_us(start, end);
+            auto [it, fresh] = step_us_.try_emplace(entry->request.kind, us);
+            if (!fresh) it->second += ewma_weight * (us - it->second);
+            if (++entry->next_step < entry->request.steps) continue;
+            Class& c = classes_[entry->request.priority];
+            auto finished = std::move(c.running);
+            last_ = nullptr;
+            const Outcome outcome = finish(c, *finished, Status::Completed, end);
+            settle(lock, std::move(finished), outcome);
+        }
+    }
+
+public:
+    // One class per name, most urgent first; no names means one class, "default"
+    explicit Scheduler(std::vector<std::string> class_names, ThreadPool& pool = ThreadPool::global())
+        : pool_(pool) {
+        if (class_names.empty()) class_names.push_back("default");
+        for (auto& name : class_names) {
+            Class c;
+            c.name = std::move(name);
+            c.stats.name = c.name;
+            classes_.push_back(std::move(c));
+        }
+        dispatcher_ = std::thread([this] { dispatch(); });
+    }
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    // Stops after the step in progress; everything unfinished is reported Cancelled
+    ~Scheduler() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        dispatcher_.join();
+        std::unique_lock<std::mutex> lock(mutex_);
+        const auto now = Clock::now();
+        for (auto& c : classes_) {
+            std::vector<std::unique_ptr<Entry>> left = std::move(c.queue);
+            nn_metrics::queue_depth_add(c.name, -static_cast<std::int64_t>(left.size()));
+            if (c.running) left.push_back(std::move(c.running));
+            for (auto& entry : left) {
+                const Outcome outcome = finish(c, *entry, Status::Cancelled, now);
+                settle(lock, std::move(entry), outcome);
+            }
+        }
+    }
+
+    std::size_t num_classes() const { return classes_.size(); }
+
+    /**
+     * @brief Queues a request; false if it was rejected (its done() has then
+     * already run with Status::Rejected)
+     *
+     * A priority past the last class is clamped to the last class.
+     */
+    bool submit(Request request) {
+        auto entry = std::make_unique<Entry>();
+        entry->request = std::move(request);
+        entry->submitted = Clock::now();
+        auto& r = entry->request;
+        r.priority = std::min(r.priority, classes_.size() - 1);
+        std::unique_lock<std::mutex> lock(mutex_);
+        Class& c = classes_[r.priority];
+        ++c.stats.submitted;
+        ++in_flight_;
+        const double ahead_us = work_ahead_us(r.priority, r.deadline) + remaining_us(*entry);
+        const auto finish_at = entry->submitted + std::chrono::duration_cast<Clock::duration>(
+                                                      std::chrono::duration<double, std::micro>(ahead_us));
+        if (stop_ || r.steps == 0 || finish_at > r.deadline) {
+            const Outcome outcome = finish(c, *entry, Status::Rejected, entry->submitted);
+            settle(lock, std::move(entry), outcome);
+            return false;
+        }
+        c.queue.push_back(std::move(entry));
+        std::push_heap(c.queue.begin(), c.queue.end(), later);
+        nn_metrics::queue_depth_add(c.name, 1);
+        lock.unlock();
+        wake_.notify_one();
+        return true;
+    }
+
+    // Blocks until every accepted request has completed or been dropped
+    void drain() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [&] { return in_flight_ == 0; });
+    }
+
+    // Learned time of one step of kind, microseconds; 0 before the first sample
+    double step_estimate_us(const std::string& kind) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return step_cost(kind);
+    }
+
+    std::vector<ClassStats> stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<ClassStats> out;
+        for (const auto& c : classes_) {
+            out.push_back(c.stats);
+            std::sort(out.back().latencies.begin(), out.back().latencies.end());
+        }
+        return out;
+    }
+};
+
+}  // namespace nn_scheduler
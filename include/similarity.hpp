@@ -0,0 +1,241 @@
+#pragma once
+
+#include "gemm.hpp"
+#include "tensor_view.hpp"
+#include "thread_pool.hpp"
+#include "memory_tracker.hpp"
+#include "profiler.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Batched top-k similarity search (inner product) over an embedding table
+ *
+ * The table is split into contiguous row shards, one task each. A shard
+ * streams its rows in tiles: the scores of a block of queries against one
+ * tile come from the packed GEMM into a small scratch block, and each
+ * query's running top-k heap (k entries, L1 resident) absorbs the block
+ * right away. Most scores lose against the heap minimum and are rejected by
+ * one compare, and the queries x rows score matrix never exists. The shard
+ * heaps are merged at the end.
+ *
+ * Int8Table stores rows as int8 with one float scale per row (symmetric
+ * quantization). That cuts the bytes streamed per row by 4x. Tiles are
+ * widened back to float for the GEMM and scores are rescaled per row.
+ * Ties rank the lower row id first, so results do not depend on sharding.
+ */
+
+/**
+ * @brief Per-row symmetric int8 copy of a [rows, dim] float table
+ */
+class Int8Table {
+private:
+    std::size_t rows_ = 0;
+    std::size_t dim_ = 0;
+    std::vector<std::int8_t, nn_memory::TrackingAllocator<std::int8_t>> values_;
+    std::vector<float, nn_memory::TrackingAllocator<float>> scales_;
+
+public:
+    Int8Table(const float* table, std::size_t rows, std::size_t dim, ThreadPool& pool = ThreadPool::global())
+        : rows_(rows), dim_(dim),
+          values_(rows * dim, nn_memory::TrackingAllocator<std::int8_t>("Int8Table", nn_memory::MemoryPurpose::Weights)),
+          scales_(rows, nn_memory::TrackingAllocator<float>("Int8Table", nn_memory::MemoryPurpose::Weights)) {
+        pool.parallel_ranges(rows, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t r = begin; r < end; ++r) {
+                const float* src = table + r * dim;
+                float max_abs = 0.0f;
+                for (std::size_t d = 0; d < dim; ++d) max_abs = std::max(max_abs, std::fabs(src[d]));
+                const float scale = max_abs > 0.0f ? max_abs / 127.0f : 1.0f;
+                const float inv = 1.0f / scale;
+                std::int8_t* dst = values_.data() + r * dim;
+                for (std::size_t d = 0; d < dim; ++d) dst[d] = static_cast<std::int8_t>(std::lrint(src[d] * inv));
+                scales_[r] = scale;
+            }
+        });
+    }
+
+    std::size_t rows() const { return rows_; }
+    std::size_t dim() const { return dim_; }
+    const std::int8_t* row(std::size_t r) const { return values_.data() + r * dim_; }
+    float scale(std::size_t r) const { return scales_[r]; }
+};
+
+/**
+ * @brief k best rows per query, best first: ids[q * k + i], scores[q * k + i]
+ *
+ * Queries with fewer than k rows available are padded with id UINT32_MAX
+ * and score -infinity.
+ */
+struct Neighbors {
+    std::size_t k = 0;
+    std::vector<std::uint32_t> ids;
+    std::vector<float> scores;
+
+    const std::uint32_t* ids_of(std::size_t query) const { return ids.data() + query * k; }
+    const float* scores_of(std::size_t query) const { return scores.data() + query * k; }
+};
+
+namespace similarity_detail {
+
+constexpr std::size_t tile_rows = 256;     // table rows per GEMM tile
+constexpr std::size_t query_block = 64;    // queries per GEMM tile
+constexpr std::size_t min_shard_rows = 4096;
+
+struct Hit {
+    float score;
+    std::uint32_t id;
+};
+
+// Strict "a ranks above b": higher score, then lower id
+inline bool better(const Hit& a, const Hit& b) {
+    return a.score > b.score || (a.score == b.score && a.id < b.id);
+}
+
+/**
+ * @brief Bounded top-k: a heap whose front is the current k-th best
+ */
+class TopK {
+private:
+    std::vector<Hit> heap_;
+    std::size_t k_;
+
+public:
+    explicit TopK(std::size_t k) : k_(k) { heap_.reserve(k); }
+
+    // One compare for the common case: the score does not make the cut
+    void push(float score, std::uint32_t id) {
+        const Hit hit{score, id};
+        if (heap_.size() < k_) {
+            heap_.push_back(hit);
+            std::push_heap(heap_.begin(), heap_.end(), better);
+        } else if (better(hit, heap_.front())) {
+            std::pop_heap(heap_.begin(), heap_.end(), better);
+            heap_.back() = hit;
+            std::push_heap(heap_.begin(), heap_.end(), better);
+        }
+    }
+
+    // Scores of one tile row block: rows [first, first + n)
+    void push_run(const float* scores, std::size_t n, std::uint32_t first) {
+        std::size_t i = 0;
+        for (; i < n && heap_.size() < k_; ++i) push(scores[i], first + static_cast<std::uint32_t>(i));
+        if (heap_.empty()) return;
+        for (; i < n; ++i) {
+            if (scores[i] >= heap_.front().score) push(scores[i], first + static_cast<std::uint32_t>(i));
+        }
+    }
+
+    const std::vector<Hit>& hits() const { return heap_; }
+};
+
+// Scratch of one shard task, reused across tiles
+struct Workspace {
+    std::vector<float> scores = std::vector<float>(query_block * tile_rows);
+    std::vector<float> tile;
+};
+
+inline Workspace& workspace() {
+    static thread_local Workspace ws;
+    return ws;
+}
+
+/**
+ * @brief Stream rows [begin, end) against all queries into `heaps`
+ *
+ * load_tile(first, rows, scratch) returns a [rows, dim] float pointer for the
+ * tile and rescale(first, rows, scores) fixes one row block of scores. The
+ * GEMMs run on `pool` (inline when the shard itself is a task of it).
+ */
+template<typename LoadTile, typename Rescale>
+void scan_shard(const float* queries, std::size_t num_queries, std::size_t dim, std::size_t begin,
+                std::size_t end, std::vector<TopK>& heaps, ThreadPool& pool, LoadTile&& load_tile,
+                Rescale&& rescale) {
+    Workspace& ws = workspace();
+    for (std::size_t t0 = begin; t0 < end; t0 += tile_rows) {
+        const std::size_t rows = std::min(tile_rows, end - t0);
+        const float* tile = load_tile(t0, rows, ws.tile);
+        for (std::size_t q0 = 0; q0 < num_queries; q0 += query_block) {
+            const std::size_t qn = std::min(query_block, num_queries - q0);
+            gemm_nt(TensorView<const float, 2>(queries + q0 * dim, {qn, dim}),
+                    TensorView<const float, 2>(tile, {rows, dim}), TensorView<float, 2>(ws.scores.data(), {qn, rows}),
+                    nullptr, pool);
+            for (std::size_t q = 0; q < qn; ++q) {
+                float* s = ws.scores.data() + q * rows;
+                rescale(t0, rows, s);
+                heaps[q0 + q].push_run(s, rows, static_cast<std::uint32_t>(t0));
+            }
+        }
+    }
+}
+
+template<typename LoadTile, typename Rescale>
+Neighbors search(const float* queries, std::size_t num_queries, std::size_t dim, std::size_t table_rows,
+                 std::size_t k, ThreadPool& pool, LoadTile&& load_tile, Rescale&& rescale) {
+    const std::size_t shards = std::max<std::size_t>(1, std::min(pool.size(), table_rows / min_shard_rows));
+    std::vector<std::vector<TopK>> shard_heaps(shards, std::vector<TopK>(num_queries, TopK(k)));
+    pool.parallel_for(shards, [&](std::size_t shard, std::size_t) {
+        scan_shard(queries, num_queries, dim, table_rows * shard / shards, table_rows * (shard + 1) / shards,
+                   shard_heaps[shard], pool, load_tile, rescale);
+    });
+
+    Neighbors result;
+    result.k = k;
+    result.ids.assign(num_queries * k, UINT32_MAX);
+    result.scores.assign(num_queries * k, -INFINITY);
+    std::vector<Hit> merged;
+    for (std::size_t q = 0; q < num_queries; ++q) {
+        merged.clear();
+        for (const auto& heaps : shard_heaps) {
+            merged.insert(merged.end(), heaps[q].hits().begin(), heaps[q].hits().end());
+        }
+        const std::size_t keep = std::min(k, merged.size());
+        std::partial_sort(merged.begin(), merged.begin() + keep, merged.end(), better);
+        for (std::size_t i = 0; i < keep; ++i) {
+            result.ids[q * k + i] = merged[i].id;
+            result.scores[q * k + i] = merged[i].score;
+        }
+    }
+    return result;
+}
+
+}  // namespace similarity_detail
+
+/**
+ * @brief Top-k rows of a dense [rows, dim] float table by inner product with each query
+ */
+inline Neighbors similarity_search(const float* queries, std::size_t num_queries, const float* table,
+                                   std::size_t rows, std::size_t dim, std::size_t k,
+                                   ThreadPool& pool = ThreadPool::global()) {
+    NN_PROFILE_ZONE("similarity_search");
+    NN_METRICS_KERNEL("similarity_search", 2 * num_queries * rows * dim, sizeof(float) * rows * dim);
+    return similarity_detail::search(
+        queries, num_queries, dim, rows, k, pool,
+        [&](std::size_t first, std::size_t, std::vector<float>&) { return table + first * dim; },
+        [](std::size_t, std::size_t, float*) {});
+}
+
+/**
+ * @brief Same search over int8 storage: tiles widened to float, scores rescaled per row
+ */
+inline Neighbors similarity_search(const float* queries, std::size_t num_queries, const Int8Table& table,
+                                   std::size_t k, ThreadPool& pool = ThreadPool::global()) {
+    NN_PROFILE_ZONE("similarity_search_int8");
+    NN_METRICS_KERNEL("similarity_search_int8", 2 * num_queries * table.rows() * table.dim(),
+                      (sizeof(std::int8_t) * table.dim() + sizeof(float)) * table.rows());
+    const std::size_t dim = table.dim();
+    return similarity_detail::search(
+        queries, num_queries, dim, table.rows(), k, pool,
+        [&](std::size_t first, std::size_t rows, std::vector<float>& scratch) {
+            scratch.resize(similarity_detail::tile_rows * dim);
+            const std::int8_t* src = table.row(first);
+            for (std::size_t i = 0; i < rows * dim; ++i) scratch[i] = static_cast<float>(src[i]);
+            return static_cast<const float*>(scratch.data());
+        },
+        [&](std::size_t first, std::size_t rows, float* scores) {
+            for (std::size_t r = 0; r < rows; ++r) scores[r] *= table.scale(first + r);
+        });
+}
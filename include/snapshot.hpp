@@ -0,0 +1,267 @@
+#pragma once
+
+#include "autotune.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Warm-start snapshots: one mmap-able file of named binary sections
+ *
+ * A process that is already warm (weights loaded and prepacked, algorithms
+ * tuned) writes its state with a Writer. A restarted process maps the file
+ * with Snapshot::open(). Layers then read their prepacked tables from the
+ * mapping in place: QuantizedConv2D::load() and nn_graph::Graph::load()
+ * return objects that point into the mapping and hold a reference to it,
+ * so nothing is parsed, quantized or packed again. The autotune cache is
+ * one more section, merged back with load_cache().
+ *
+ * Layout (host byte order):
+ *
+ *   header   64 bytes: magic "NNSNAP", version, section count, table offset, file size
+ *   sections each aligned to 64 bytes
+ *   table    one 64-byte entry per section: name (up to 47 chars), offset, size
+ *
+ * Sections hold the packed layouts of the build that wrote them; writers
+ * add whatever they need to reject a mismatch (QuantizedConv2D records its
+ * shape and panel width). Files are written to a temporary path of the
+ * writing process and renamed into place.
+ */
+
+namespace nn_snapshot {
+
+namespace detail {
+
+constexpr char magic[8] = {'N', 'N', 'S', 'N', 'A', 'P', '\0', '\0'};
+constexpr std::uint32_t version = 1;
+constexpr std::size_t alignment = 64;
+constexpr std::size_t max_name = 47;
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t sections;
+    std::uint64_t table;
+    std::uint64_t size;
+    char reserved[32];
+};
+
+struct Entry {
+    char name[max_name + 1];
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+static_assert(sizeof(Header) == 64 && sizeof(Entry) == 64, "snapshot records are 64 bytes");
+
+inline std::size_t aligned(std::size_t n) { return (n + alignment - 1) / alignment * alignment; }
+
+}  // namespace detail
+
+/**
+ * @brief Collects sections in memory and writes the snapshot file
+ */
+class Writer {
+private:
+    std::vector<std::pair<std::string, std::vector<char>>> sections_;
+
+public:
+    void add(const std::string& name, const void* data, std::size_t bytes) {
+        const char* p = static_cast<const char*>(data);
+        sections_.emplace_back(name, std::vector<char>(p, p + bytes));
+    }
+
+    template<typename T>
+    void add(const std::string& name, std::span<const T> values) {
+        add(name, values.data(), values.size_bytes());
+    }
+
+    void add(const std::string& name, const std::string& text) { add(name, text.data(), text.size()); }
+
+    // false and a message on a bad section name or an I/O error
+    bool write(const std::string& path, std::string& error) const {
+        std::map<std::string, bool> seen;
+        for (const auto& [name, bytes] : sections_) {
+            if (name.empty() || name.size() > detail::max_name || seen[name]) {
+                error = "bad or duplicate section name '" + name + "'";
+                return false;
+            }
+            seen[name] = true;
+        }
+        std::vector<detail::Entry> table;
+        std::size_t offset = sizeof(detail::Header);
+        for (const auto& [name, bytes] : sections_) {
+            detail::Entry entry{};
+            std::memcpy(entry.name, name.data(), name.size());
+            entry.offset = offset;
+            entry.size = bytes.size();
+            table.push_back(entry);
+            offset = detail::aligned(offset + bytes.size());
+        }
+        detail::Header header{};
+        std::memcpy(header.magic, detail::magic, sizeof(header.magic));
+        header.version = detail::version;
+        header.sections = static_cast<std::uint32_t>(table.size());
+        header.table = offset;
+        header.size = offset + table.size() * sizeof(detail::Entry);
+
+        // Per process, like nn_autotune::Cache::save, so concurrent writers never share it
+        static std::atomic<unsigned> serial{0};
+        const std::string temporary = path + ".tmp." + std::to_string(getpid()) + "." + std::to_string(serial++);
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                error = "cannot create " + temporary;
+                std::remove(temporary.c_str());
+                return false;
+            }
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            static const char zeros[detail::alignment] = {};
+            for (std::size_t i = 0; i < sections_.size(); ++i) {
+                const auto& bytes = sections_[i].second;
+                out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+                out.write(zeros, static_cast<std::streamsize>(detail::aligned(bytes.size()) - bytes.size()));
+            }
+            out.write(reinterpret_cast<const char*>(table.data()),
+                      static_cast<std::streamsize>(table.size() * sizeof(detail::Entry)));
+            if (!out.flush()) {
+                error = "cannot write " + temporary;
+                out.close();
+                std::remove(temporary.c_str());
+                return false;
+            }
+        }
+        if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+            error = "cannot rename " + temporary + " to " + path;
+            std::remove(temporary.c_str());
+            return false;
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief A snapshot file mapped read-only; sections are views into the mapping
+ */
+class Snapshot {
+private:
+    const char* base_ = nullptr;
+    std::size_t size_ = 0;
+    std::map<std::string, std::span<const char>> sections_;
+
+    Snapshot() = default;
+
+public:
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    ~Snapshot() {
+        if (base_ != nullptr) munmap(const_cast<char*>(base_), size_);
+    }
+
+    /**
+     * @brief Maps path; nullptr and a message if it is not a valid snapshot
+     *
+     * populate faults all pages in up front (MAP_POPULATE), so the first
+     * inference does not pay for them; otherwise pages load on first touch.
+     */
+    static std::shared_ptr<const Snapshot> open(const std::string& path, std::string& error, bool populate = true) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            error = "cannot open " + path;
+            return nullptr;
+        }
+        struct stat st {};
+        if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(detail::Header)) {
+            ::close(fd);
+            error = path + " is too short for a snapshot";
+            return nullptr;
+        }
+        const auto size = static_cast<std::size_t>(st.st_size);
+        void* base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            error = "cannot map " + path;
+            return nullptr;
+        }
+        std::shared_ptr<Snapshot> snapshot(new Snapshot());
+        snapshot->base_ = static_cast<const char*>(base);
+        snapshot->size_ = size;
+
+        detail::Header header;
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, detail::magic, sizeof(header.magic)) != 0 || header.version != detail::version ||
+            header.size != size || header.table > size ||
+            (size - header.table) / sizeof(detail::Entry) < header.sections) {
+            error = path + " is not a version " + std::to_string(detail::version) + " snapshot";
+            return nullptr;
+        }
+        for (std::uint32_t i = 0; i < header.sections; ++i) {
+            detail::Entry entry;
+            std::memcpy(&entry, snapshot->base_ + header.table + i * sizeof(entry), sizeof(entry));
+            entry.name[detail::max_name] = '\0';
+            if (entry.offset % detail::alignment != 0 || entry.offset > header.table ||
+                entry.size > header.table - entry.offset) {
+                error = path + ": section '" + entry.name + "' is out of bounds";
+                return nullptr;
+            }
+            snapshot->sections_[entry.name] = {snapshot->base_ + entry.offset, static_cast<std::size_t>(entry.size)};
+        }
+        return snapshot;
+    }
+
+    bool contains(const std::string& name) const { return sections_.count(name) != 0; }
+
+    // Bytes of a section; empty if missing
+    std::span<const char> bytes(const std::string& name) const {
+        auto it = sections_.find(name);
+        return it == sections_.end() ? std::span<const char>() : it->second;
+    }
+
+    // A section as count values of T; empty if missing or of another size
+    template<typename T>
+    std::span<const T> array(const std::string& name, std::size_t count) const {
+        const auto b = bytes(name);
+        if (b.size() != count * sizeof(T)) return {};
+        return {reinterpret_cast<const T*>(b.data()), count};
+    }
+
+    std::string text(const std::string& name) const {
+        const auto b = bytes(name);
+        return std::string(b.data(), b.size());
+    }
+
+    std::size_t size() const { return size_; }
+};
+
+// The autotune cache as section "autotune"
+inline void save_cache(Writer& writer, const nn_autotune::Cache& cache = nn_autotune::Cache::instance()) {
+    std::ostringstream text;
+    cache.write(text);
+    writer.add("autotune", text.str());
+}
+
+// Merges section "autotune" into cache; false if the snapshot has none
+inline bool load_cache(const Snapshot& snapshot, nn_autotune::Cache& cache = nn_autotune::Cache::instance()) {
+    if (!snapshot.contains("autotune")) return false;
+    std::istringstream text(snapshot.text("autotune"));
+    cache.read(text);
+    return true;
+}
+
+}  // namespace nn_snapshot
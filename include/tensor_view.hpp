@@ -0,0 +1,190 @@
+#pragma once
+
+#include "tensor.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief Non-owning strided view of a Tensor (or of any buffer)
+ *
+ * A view is a pointer plus a runtime shape and element strides, so slicing
+ * (narrow, select) and axis permutation (transpose) are O(1) and share the
+ * underlying storage. Kernels that must work along "any axis" take views:
+ * Odometer walks every line of a view along one axis, which lets a kernel
+ * keep a single inner loop and handle the remaining axes generically.
+ */
+
+template<typename T, std::size_t Rank>
+class TensorView {
+    static_assert(Rank >= 1, "TensorView needs at least one dimension");
+
+public:
+    using Shape = std::array<std::size_t, Rank>;
+    using Strides = std::array<std::ptrdiff_t, Rank>;
+    static constexpr std::size_t rank = Rank;
+
+private:
+    T* data_ = nullptr;
+    Shape shape_{};
+    Strides strides_{};
+
+public:
+    constexpr TensorView() = default;
+
+    constexpr TensorView(T* data, const Shape& shape, const Strides& strides)
+        : data_(data), shape_(shape), strides_(strides) {}
+
+    // Dense row-major buffer
+    constexpr TensorView(T* data, const Shape& shape) : data_(data), shape_(shape) {
+        std::ptrdiff_t stride = 1;
+        for (std::size_t d = Rank; d-- > 0;) {
+            strides_[d] = stride;
+            stride *= static_cast<std::ptrdiff_t>(shape_[d]);
+        }
+    }
+
+    template<typename U, std::size_t... Dims>
+        requires(sizeof...(Dims) == Rank && std::is_same_v<std::remove_const_t<T>, U>)
+    constexpr TensorView(Tensor<U, Dims...>& tensor) : TensorView(tensor.data(), Shape{Dims...}) {}
+
+    template<typename U, std::size_t... Dims>
+        requires(sizeof...(Dims) == Rank && std::is_same_v<T, const U>)
+    constexpr TensorView(const Tensor<U, Dims...>& tensor) : TensorView(tensor.data(), Shape{Dims...}) {}
+
+    // Mutable -> const view
+    constexpr operator TensorView<const T, Rank>() const { return {data_, shape_, strides_}; }
+
+    constexpr T* data() const { return data_; }
+    constexpr const Shape& shape() const { return shape_; }
+    constexpr std::size_t shape(std::size_t axis) const { return shape_[axis]; }
+    constexpr const Strides& strides() const { return strides_; }
+    constexpr std::ptrdiff_t stride(std::size_t axis) const { return strides_[axis]; }
+
+    constexpr std::size_t size() const {
+        std::size_t n = 1;
+        for (std::size_t extent : shape_) n *= extent;
+        return n;
+    }
+
+    // Row-major dense: the view is one flat run of size() elements
+    constexpr bool is_contiguous() const {
+        std::ptrdiff_t expected = 1;
+        for (std::size_t d = Rank; d-- > 0;) {
+            if (shape_[d] != 1 && strides_[d] != expected) return false;
+            expected *= static_cast<std::ptrdiff_t>(shape_[d]);
+        }
+        return true;
+    }
+
+    constexpr std::ptrdiff_t offset(const Shape& index) const {
+        std::ptrdiff_t o = 0;
+        for (std::size_t d = 0; d < Rank; ++d) o += static_cast<std::ptrdiff_t>(index[d]) * strides_[d];
+        return o;
+    }
+
+    constexpr T& at(const Shape& index) const { return data_[offset(index)]; }
+
+    template<typename... Args>
+    constexpr T& operator()(Args... args) const {
+        static_assert(sizeof...(Args) == Rank, "Number of indices must match view rank");
+        return at(Shape{static_cast<std::size_t>(args)...});
+    }
+
+    // Elements [start, start + length) along axis
+    constexpr TensorView narrow(std::size_t axis, std::size_t start, std::size_t length) const {
+        TensorView v = *this;
+        v.data_ += static_cast<std::ptrdiff_t>(start) * strides_[axis];
+        v.shape_[axis] = length;
+        return v;
+    }
+
+    // Slice at `index` along axis, dropping that axis
+    constexpr TensorView<T, Rank - 1> select(std::size_t axis, std::size_t index) const
+        requires(Rank > 1)
+    {
+        typename TensorView<T, Rank - 1>::Shape shape{};
+        typename TensorView<T, Rank - 1>::Strides strides{};
+        for (std::size_t d = 0, o = 0; d < Rank; ++d) {
+            if (d == axis) continue;
+            shape[o] = shape_[d];
+            strides[o++] = strides_[d];
+        }
+        return {data_ + static_cast<std::ptrdiff_t>(index) * strides_[axis], shape, strides};
+    }
+
+    constexpr TensorView transpose(std::size_t a, std::size_t b) const {
+        TensorView v = *this;
+        std::swap(v.shape_[a], v.shape_[b]);
+        std::swap(v.strides_[a], v.strides_[b]);
+        return v;
+    }
+};
+
+// Read-only view parameter that takes no part in template deduction: kernels
+// deduce T from their output and accept mutable views as inputs
+template<typename T, std::size_t Rank>
+using ConstView = std::type_identity_t<TensorView<const T, Rank>>;
+
+template<typename T, std::size_t... Dims>
+TensorView<T, sizeof...(Dims)> view(Tensor<T, Dims...>& tensor) {
+    return TensorView<T, sizeof...(Dims)>(tensor);
+}
+
+template<typename T, std::size_t... Dims>
+TensorView<const T, sizeof...(Dims)> view(const Tensor<T, Dims...>& tensor) {
+    return TensorView<const T, sizeof...(Dims)>(tensor);
+}
+
+/**
+ * @brief Multi-index over a shape with some axes pinned to 0
+ *
+ * With axis `a` pinned, the positions enumerated are the starts of all lines
+ * along `a`. seek(n) jumps to the n-th position (for splitting the walk
+ * across threads), next() advances in row-major order.
+ */
+template<std::size_t Rank>
+class Odometer {
+private:
+    std::array<std::size_t, Rank> extent_{};
+    std::array<std::size_t, Rank> index_{};
+
+public:
+    // pinned: bit d set => axis d stays 0
+    Odometer(const std::array<std::size_t, Rank>& shape, std::uint32_t pinned) {
+        for (std::size_t d = 0; d < Rank; ++d) extent_[d] = (pinned >> d) & 1u ? 1 : shape[d];
+    }
+
+    std::size_t count() const {
+        std::size_t n = 1;
+        for (std::size_t extent : extent_) n *= extent;
+        return n;
+    }
+
+    const std::array<std::size_t, Rank>& index() const { return index_; }
+
+    void seek(std::size_t n) {
+        for (std::size_t d = Rank; d-- > 0;) {
+            index_[d] = n % extent_[d];
+            n /= extent_[d];
+        }
+    }
+
+    void next() {
+        for (std::size_t d = Rank; d-- > 0;) {
+            if (++index_[d] < extent_[d]) return;
+            index_[d] = 0;
+        }
+    }
+
+    // f(index) for positions [begin, end); nothing for an empty range (which
+    // is every range of a shape with a zero extent, where seek() cannot go)
+    template<typename F>
+    void walk(std::size_t begin, std::size_t end, F&& f) {
+        if (begin >= end) return;
+        seek(begin);
+        for (std::size_t n = begin; n < end; ++n, next()) f(index_);
+    }
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fork-join thread pool for data-parallel kernels
+ *
+ * parallel_for(n, f) runs f(task, worker) for task in [0, n) on the pool's
+ * persistent workers plus the calling thread (worker 0), and returns once all
+ * tasks are done. Tasks are claimed from a shared atomic counter. A
+ * parallel_for issued from inside a task runs inline on the calling worker.
+ */
+
+class ThreadPool {
+private:
+    struct Job {
+        std::function<void(std::size_t, std::size_t)> fn;
+        std::size_t num_tasks = 0;
+        std::atomic<std::size_t> next{0};
+    };
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable finished_;
+    std::mutex submit_mutex_;
+    Job job_;
+    std::size_t generation_ = 0;
+    std::size_t active_ = 0;  // workers inside run_tasks(), guarded by mutex_
+    bool stopping_ = false;
+
+    static inline thread_local bool in_task_ = false;
+
+    // Claim and run tasks of the current job until none are left
+    void run_tasks(std::size_t worker) {
+        in_task_ = true;
+        for (;;) {
+            std::size_t task = job_.next.fetch_add(1, std::memory_order_relaxed);
+            if (task >= job_.num_tasks) break;
+            job_.fn(task, worker);
+        }
+        in_task_ = false;
+    }
+
+    void worker_loop(std::size_t worker) {
+        std::size_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+                if (stopping_) return;
+                seen = generation_;
+                ++active_;
+            }
+            run_tasks(worker);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                --active_;
+            }
+            finished_.notify_all();
+        }
+    }
+
+public:
+    // Threads including the caller; NN_META_THREADS overrides the hardware count
+    static std::size_t default_thread_count() {
+        if (const char* env = std::getenv("NN_META_THREADS")) {
+            int n = std::atoi(env);
+            if (n > 0) return static_cast<std::size_t>(n);
+        }
+        unsigned hw = std::thread::hardware_concurrency();
+        return hw > 0 ? hw : 1;
+    }
+
+    explicit ThreadPool(std::size_t num_threads = default_thread_count()) {
+        if (num_threads == 0) num_threads = 1;
+        workers_.reserve(num_threads - 1);
+        for (std::size_t i = 1; i < num_threads; ++i) {
+            workers_.emplace_back([this, i] { worker_loop(i); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker : workers_) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t size() const { return workers_.size() + 1; }
+
+    template<typename F>
+    void parallel_for(std::size_t num_tasks, F&& f) {
+        if (num_tasks == 0) return;
+        if (workers_.empty() || num_tasks == 1 || in_task_) {
+            for (std::size_t task = 0; task < num_tasks; ++task) f(task, std::size_t(0));
+            return;
+        }
+
+        std::lock_guard<std::mutex> submit(submit_mutex_);
+        {
+            // Late workers of the previous job must be out before it is reused
+            std::unique_lock<std::mutex> lock(mutex_);
+            finished_.wait(lock, [&] { return active_ == 0; });
+            job_.fn = std::forward<F>(f);
+            job_.num_tasks = num_tasks;
+            job_.next.store(0, std::memory_order_relaxed);
+            ++generation_;
+        }
+        wake_.notify_all();
+        run_tasks(0);
+
+        // Every task is claimed by now; claimed tasks are done once no worker is active
+        std::unique_lock<std::mutex> lock(mutex_);
+        finished_.wait(lock, [&] { return active_ == 0; });
+        job_.fn = nullptr;
+    }
+
+    // Split [0, n) into one contiguous range per thread: f(begin, end, worker)
+    template<typename F>
+    void parallel_ranges(std::size_t n, F&& f) {
+        std::size_t parts = size() < n ? size() : n;
+        parallel_for(parts, [&](std::size_t part, std::size_t worker) {
+            f(n * part / parts, n * (part + 1) / parts, worker);
+        });
+    }
+
+    static ThreadPool& global() {
+        static ThreadPool pool;
+        return pool;
+    }
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "tensor.hpp"
+#include "nn_compiler.hpp"
+#include "thread_pool.hpp"
+#include "memory_tracker.hpp"
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Data-parallel training for LinearLayer heads
+ *
+ * Each mini-batch is split into one contiguous shard per pool thread. Every
+ * shard runs forward + backward into its own gradient buffer (no sharing, no
+ * atomics). The buffers are then combined with a reduce-scatter: the flat
+ * parameter range is cut into cache-sized chunks, and each task sums one chunk
+ * across all shard buffers and applies the SGD update to it. Shard order is
+ * fixed, so results do not depend on scheduling.
+ */
+
+template<typename T, std::size_t InSize, std::size_t OutSize>
+class DataParallelTrainer {
+public:
+    using Layer = LinearLayer<T, InSize, OutSize>;
+    using Gradients = LinearGradients<T, InSize, OutSize>;
+    using Input = Tensor<T, InSize>;
+    using Target = Tensor<T, OutSize>;
+
+    // Elements per reduce-scatter task: 16 KB of floats stays in L1
+    static constexpr std::size_t reduce_chunk = 4096;
+
+private:
+    struct alignas(64) ShardLoss {
+        T value = T(0);
+    };
+
+    Layer& layer_;
+    ThreadPool& pool_;
+    T learning_rate_;
+    std::vector<nn_memory::TrackedPtr<Gradients>> grads_;
+    std::vector<ShardLoss> losses_;
+
+    // Sum chunk [begin, end) of every shard buffer into shard 0, then update params
+    static void reduce_and_update(T* param, std::vector<T*>& shard_grads,
+                                  std::size_t begin, std::size_t end, T learning_rate) {
+        T* acc = shard_grads[0];
+        for (std::size_t s = 1; s < shard_grads.size(); ++s) {
+            const T* g = shard_grads[s];
+            for (std::size_t e = begin; e < end; ++e) acc[e] += g[e];
+        }
+        for (std::size_t e = begin; e < end; ++e) param[e] -= learning_rate * acc[e];
+    }
+
+public:
+    DataParallelTrainer(Layer& layer, ThreadPool& pool, T learning_rate)
+        : layer_(layer), pool_(pool), learning_rate_(learning_rate), losses_(pool.size()) {
+        nn_memory::MemoryOwnerScope owner("DataParallelTrainer");
+        for (std::size_t s = 0; s < pool.size(); ++s) {
+            grads_.push_back(nn_memory::make_tracked<Gradients>(nn_memory::MemoryPurpose::Workspace));
+        }
+    }
+
+    std::size_t num_shards() const { return grads_.size(); }
+
+    // One SGD step on mean squared error; returns the mean loss of the batch
+    T train_step(const Input* inputs, const Target* targets, std::size_t batch) {
+        if (batch == 0) return T(0);
+        const std::size_t shards = num_shards() < batch ? num_shards() : batch;
+        const T inv_batch = T(1) / static_cast<T>(batch);
+
+        // 1. Forward + backward per shard into shard-local buffers
+        pool_.parallel_for(shards, [&](std::size_t shard, std::size_t) {
+            Gradients& grads = *grads_[shard];
+            grads.zero();
+            T loss = T(0);
+            for (std::size_t b = batch * shard / shards; b < batch * (shard + 1) / shards; ++b) {
+                Target output = layer_.forward(inputs[b]);
+                Target grad_output;
+                for (std::size_t i = 0; i < OutSize; ++i) {
+                    T diff = output(i) - targets[b](i);
+                    loss += T(0.5) * diff * diff;
+                    grad_output(i) = diff * inv_batch;
+                }
+                layer_.accumulate_gradients(inputs[b], grad_output, grads);
+            }
+            losses_[shard].value = loss;
+        });
+
+        // 2. Reduce-scatter over shards fused with the SGD update
+        std::vector<T*> weight_grads, bias_grads;
+        for (std::size_t s = 0; s < shards; ++s) {
+            weight_grads.push_back(grads_[s]->weights.data());
+            bias_grads.push_back(grads_[s]->bias.data());
+        }
+        constexpr std::size_t weight_size = OutSize * InSize;
+        constexpr std::size_t weight_chunks = (weight_size + reduce_chunk - 1) / reduce_chunk;
+        pool_.parallel_for(weight_chunks + 1, [&](std::size_t chunk, std::size_t) {
+            if (chunk == weight_chunks) {
+                reduce_and_update(layer_.get_bias().data(), bias_grads, 0, OutSize, learning_rate_);
+                return;
+            }
+            std::size_t begin = chunk * reduce_chunk;
+            std::size_t end = begin + reduce_chunk < weight_size ? begin + reduce_chunk : weight_size;
+            reduce_and_update(layer_.get_weights().data(), weight_grads, begin, end, learning_rate_);
+        });
+
+        T total = T(0);
+        for (std::size_t s = 0; s < shards; ++s) total += losses_[s].value;
+        return total * inv_batch;
+    }
+
+    // Gradients of the last step, summed over shards
+    const Gradients& gradients() const { return *grads_[0]; }
+};
@@ -0,0 +1,202 @@
+#pragma once
+
+#include "thread_pool.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**
+ * @brief Zygote mode: fork warm workers that share weights copy-on-write
+ *
+ * The parent process loads and prepacks every model, runs each once so lazy
+ * state (plans, packed panels, tuning choices, FFT spectra) exists, and
+ * registers the weight buffers with share(). run() then forks the workers.
+ * A worker starts with all of that already in its address space, and the
+ * weight pages stay physically shared with the parent and the other workers
+ * as long as nobody writes them.
+ *
+ * Each worker reports the /proc/self/smaps accounting of the mappings that
+ * hold the shared buffers, read after its work is done: Shared_* pages are
+ * the memory saved per worker, and Private_Dirty pages were copied because
+ * something wrote to them. smaps counts whole mappings, so buffers that the
+ * allocator placed in one mapping with written data show that data as
+ * private too.
+ *
+ * Only the forking thread exists in a child, so a worker must not use
+ * ThreadPool::global() or any pool of the parent: it gets a fresh pool of
+ * its own, and must be passed that pool explicitly. Fork from a quiet point
+ * with no parallel work in flight. Workers leave through _exit(), also when
+ * fn throws (exit code EXIT_FAILURE), so no static destructor of the
+ * parent's state runs in them.
+ */
+
+namespace nn_zygote {
+
+/**
+ * @brief Page accounting of some mappings, in bytes
+ */
+struct SmapsUsage {
+    std::size_t size = 0;  // virtual size of the mappings
+    std::size_t rss = 0;
+    std::size_t pss = 0;   // rss with each shared page divided by its sharer count
+    std::size_t shared_clean = 0;
+    std::size_t shared_dirty = 0;
+    std::size_t private_clean = 0;
+    std::size_t private_dirty = 0;
+
+    std::size_t shared() const { return shared_clean + shared_dirty; }
+    std::size_t private_bytes() const { return private_clean + private_dirty; }
+};
+
+/**
+ * @brief Sums /proc/<pid>/smaps over the mappings that overlap any region
+ * (begin, bytes); nullopt where smaps is not available
+ */
+inline std::optional<SmapsUsage> smaps_usage(const std::vector<std::pair<const void*, std::size_t>>& regions,
+                                             const std::string& pid = "self") {
+    std::ifstream smaps("/proc/" + pid + "/smaps");
+    if (!smaps) return std::nullopt;
+    SmapsUsage usage;
+    bool counted = false;  // the current mapping overlaps a region
+    for (std::string line; std::getline(smaps, line);) {
+        std::uintptr_t begin = 0, end = 0;
+        char dash = 0;
+        std::istringstream header(line);
+        if (header >> std::hex >> begin >> dash >> end && dash == '-') {
+            counted = false;
+            for (const auto& [p, bytes] : regions) {
+                const auto b = reinterpret_cast<std::uintptr_t>(p);
+                counted = counted || (b < end && begin < b + bytes);
+            }
+            if (counted) usage.size += end - begin;
+            continue;
+        }
+        if (!counted) continue;
+        std::istringstream field(line);
+        std::string key;
+        std::size_t kb = 0;
+        if (!(field >> key >> kb)) continue;
+        if (key == "Rss:") usage.rss += kb * 1024;
+        else if (key == "Pss:") usage.pss += kb * 1024;
+        else if (key == "Shared_Clean:") usage.shared_clean += kb * 1024;
+        else if (key == "Shared_Dirty:") usage.shared_dirty += kb * 1024;
+        else if (key == "Private_Clean:") usage.private_clean += kb * 1024;
+        else if (key == "Private_Dirty:") usage.private_dirty += kb * 1024;
+    }
+    return usage;
+}
+
+struct WorkerReport {
+    std::size_t worker = 0;
+    pid_t pid = -1;
+    int exit_code = -1;         // fn's return value, EXIT_FAILURE if it threw; -1 if the worker died
+    double seconds = 0.0;       // time in fn
+    bool has_usage = false;     // smaps was readable
+    SmapsUsage shared_buffers;  // the mappings of the registered buffers, after fn
+};
+
+class Zygote {
+private:
+    std::vector<std::pair<const void*, std::size_t>> regions_;
+
+    struct Message {
+        double seconds;
+        bool has_usage;
+        SmapsUsage usage;
+    };
+
+public:
+    // Registers memory that workers should share (weights, packed panels)
+    void share(const void* data, std::size_t bytes) {
+        if (bytes > 0) regions_.emplace_back(data, bytes);
+    }
+
+    const std::vector<std::pair<const void*, std::size_t>>& shared_regions() const { return regions_; }
+
+    std::size_t shared_bytes() const {
+        std::size_t total = 0;
+        for (const auto& region : regions_) total += region.second;
+        return total;
+    }
+
+    /**
+     * @brief Forks workers and waits for them; fn(worker, pool) is a worker's
+     * whole life and its return value is the exit code
+     *
+     * A worker whose fork fails is reported with pid -1.
+     */
+    std::vector<WorkerReport> run(std::size_t workers, std::size_t threads_per_worker,
+                                  const std::function<int(std::size_t, ThreadPool&)>& fn) const {
+        std::vector<WorkerReport> reports(workers);
+        std::vector<int> pipes(workers, -1);
+        std::fflush(nullptr);  // or the children inherit unwritten stdio buffers
+        for (std::size_t w = 0; w < workers; ++w) {
+            reports[w].worker = w;
+            int fds[2];
+            if (pipe(fds) != 0) continue;
+            const pid_t pid = fork();
+            if (pid == 0) {
+                // Nothing may unwind out of here: the child would go on running the parent's program
+                try {
+                    close(fds[0]);
+                    Message message{};
+                    int code = 0;
+                    {
+                        ThreadPool pool(threads_per_worker);
+                        const auto start = std::chrono::steady_clock::now();
+                        code = fn(w, pool);
+                        message.seconds =
+                            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    }
+                    if (auto usage = smaps_usage(regions_)) {
+                        message.has_usage = true;
+                        message.usage = *usage;
+                    }
+                    [[maybe_unused]] const auto written = write(fds[1], &message, sizeof(message));
+                    std::fflush(nullptr);  // the worker's own output; _exit() does not flush
+                    _exit(code);
+                } catch (...) {
+                    std::fflush(nullptr);
+                    _exit(EXIT_FAILURE);
+                }
+            }
+            close(fds[1]);
+            if (pid < 0) {
+                close(fds[0]);
+                continue;
+            }
+            reports[w].pid = pid;
+            pipes[w] = fds[0];
+        }
+        for (std::size_t w = 0; w < workers; ++w) {
+            if (reports[w].pid < 0) continue;
+            Message message{};
+            if (read(pipes[w], &message, sizeof(message)) == static_cast<ssize_t>(sizeof(message))) {
+                reports[w].seconds = message.seconds;
+                reports[w].has_usage = message.has_usage;
+                reports[w].shared_buffers = message.usage;
+            }
+            close(pipes[w]);
+            int status = 0;
+            if (waitpid(reports[w].pid, &status, 0) == reports[w].pid && WIFEXITED(status)) {
+                reports[w].exit_code = WEXITSTATUS(status);
+            }
+        }
+        return reports;
+    }
+};
+
+}  // namespace nn_zygote
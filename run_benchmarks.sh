@@ -3,6 +3,7 @@
 # Script to run all benchmarks and generate comparison report
 
 set -e
+set -o pipefail
 
 echo "=========================================="
 echo "Running Benchmark Comparison Suite"
@@ -30,10 +31,19 @@ fi
 # Make Python scripts executable
 chmod +x benchmarks/benchmark_pytorch.py
 chmod +x benchmarks/compare_benchmarks.py
+chmod +x benchmarks/benchmark_history.py
 
 echo "Running C++ benchmark..."
 echo "----------------------------------------"
-./build/benchmark_cpp
+./build/benchmark_cpp | tee build/benchmark_cpp_output.txt
+
+echo ""
+echo "Recording benchmark history..."
+echo "----------------------------------------"
+cd benchmarks
+python3 benchmark_history.py record --input ../build/benchmark_cpp_output.txt
+python3 benchmark_history.py report
+cd ..
 
 echo ""
 echo "Running PyTorch benchmark..."
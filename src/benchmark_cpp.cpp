@@ -5,19 +5,51 @@
 #include "tensor.hpp"
 #include "nn_compiler.hpp"
 #include "benchmark.hpp"
+#include "profiler.hpp"
+#include "metrics.hpp"
+#include "memory_tracker.hpp"
+#include "thread_pool.hpp"
+#include "trainer.hpp"
+#include "loss.hpp"
+#include "checkpoint.hpp"
+#include "mixed_precision.hpp"
+#include "random.hpp"
+#include "dropout.hpp"
+#include "sampling.hpp"
+#include "gemm.hpp"
+#include "moe.hpp"
+#include "attention.hpp"
+#include "indexing.hpp"
+#include "concat.hpp"
+#include "scan.hpp"
+#include "similarity.hpp"
+#include "conv.hpp"
+#include "quantization.hpp"
+#include "graph.hpp"
+#include "autotune.hpp"
+#include "snapshot.hpp"
+#include "zygote.hpp"
+#include "scheduler.hpp"
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
 
 using namespace std;
 
-// Helper to initialize tensor with random values
+constexpr std::uint64_t benchmark_seed = 0x5EED;
+
+// Next stream of random_init(), shared by every tensor shape; it starts above
+// the small fixed stream numbers the benchmarks pass to Philox directly
+inline std::uint64_t random_init_stream = std::uint64_t(1) << 32;
+
+// Helper to initialize tensor with random values: every call draws the next
+// Philox stream, so inputs are reproducible and independent of thread count
 template<typename T, std::size_t... Dims>
 void random_init(Tensor<T, Dims...>& tensor, T min_val = T(0), T max_val = T(1)) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<T> dis(min_val, max_val);
-    
-    for (std::size_t i = 0; i < tensor.size(); ++i) {
-        tensor.data()[i] = dis(gen);
-    }
+    nn_random::uniform_(tensor, nn_random::Philox(benchmark_seed, random_init_stream++), min_val, max_val);
 }
 
 // Benchmark: Matrix Multiplication
@@ -184,9 +216,12 @@ void benchmark_linear_layer() {
     
     // Large layer (1024 -> 512)
     {
-        LinearLayer<float, 1024, 512> layer;
-        random_init(layer.get_weights(), -0.1f, 0.1f);
-        random_init(layer.get_bias(), -0.01f, 0.01f);
+        // 2 MB of weights: keep them off the stack, accounted as layer weights
+        nn_memory::MemoryOwnerScope owner("Linear (1024->512)");
+        auto layer = nn_memory::make_tracked<LinearLayer<float, 1024, 512>>(
+            nn_memory::MemoryPurpose::Weights);
+        random_init(layer->get_weights(), -0.1f, 0.1f);
+        random_init(layer->get_bias(), -0.01f, 0.01f);
         
         Tensor<float, 1024> input;
         random_init(input, -1.0f, 1.0f);
@@ -194,7 +229,7 @@ void benchmark_linear_layer() {
         BenchmarkStats stats("Linear (1024->512) - C++ (Meta)");
         volatile float sum = 0.0f;
         stats.run_benchmark([&]() {
-            auto result = layer.forward(input);
+            auto result = layer->forward(input);
             sum += result(0);
         }, iterations / 10, warmup / 10);
         (void)sum;
@@ -251,7 +286,1455 @@ void benchmark_elementwise() {
     }
 }
 
+// Benchmark: Data-parallel LinearLayer training, samples/s vs. thread count
+void benchmark_data_parallel_training() {
+    cout << "\n=== Data-Parallel Training Benchmark ===\n";
+    
+    constexpr int iterations = 50;
+    constexpr int warmup = 5;
+    constexpr std::size_t batch = 256;
+    
+    std::vector<Tensor<float, 256>> inputs(batch);
+    std::vector<Tensor<float, 128>> targets(batch);
+    for (auto& x : inputs) random_init(x, -1.0f, 1.0f);
+    for (auto& t : targets) random_init(t, -1.0f, 1.0f);
+    
+    // Powers of two up to the hardware thread count, plus the count itself
+    std::size_t max_threads = ThreadPool::default_thread_count();
+    std::vector<std::size_t> thread_counts;
+    for (std::size_t t = 1; t < max_threads; t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+    
+    for (std::size_t threads : thread_counts) {
+        ThreadPool pool(threads);
+        LinearLayer<float, 256, 128> layer;
+        random_init(layer.get_weights(), -0.1f, 0.1f);
+        DataParallelTrainer<float, 256, 128> trainer(layer, pool, 0.01f);
+        
+        BenchmarkStats stats("Train (256->128, batch 256, " + to_string(threads) + " threads) - C++ (Meta)");
+        volatile float loss = 0.0f;
+        stats.run_benchmark([&]() {
+            loss = trainer.train_step(inputs.data(), targets.data(), batch);
+        }, iterations, warmup);
+        (void)loss;
+        
+        stats.print_stats();
+        cout << "  Throughput: " << std::fixed << std::setprecision(0)
+             << batch / (stats.get_mean() * 1e-6) << " samples/s\n";
+    }
+}
+
+// Benchmark: Fused softmax + cross-entropy (loss and gradient)
+template<std::size_t Vocab>
+void benchmark_softmax_cross_entropy_vocab(int iterations, int warmup) {
+    auto logits = nn_memory::make_tracked<Tensor<float, Vocab>>(nn_memory::MemoryPurpose::Activations);
+    auto grad = nn_memory::make_tracked<Tensor<float, Vocab>>(nn_memory::MemoryPurpose::Activations);
+    random_init(*logits, -8.0f, 8.0f);
+    
+    BenchmarkStats stats("SoftmaxCE (" + to_string(Vocab) + ") - C++ (Meta)");
+    volatile float loss = 0.0f;
+    stats.run_benchmark([&]() {
+        loss = softmax_cross_entropy(*logits, Vocab / 3, *grad);
+    }, iterations, warmup);
+    (void)loss;
+    
+    stats.print_stats();
+    // Two reads of the logits and one write of the gradient
+    cout << "  Bandwidth: " << std::fixed << std::setprecision(2)
+         << 3.0 * sizeof(float) * Vocab / (stats.get_mean() * 1e3) << " GB/s\n";
+}
+
+void benchmark_softmax_cross_entropy() {
+    cout << "\n=== Fused Softmax Cross-Entropy Benchmark ===\n";
+    
+    benchmark_softmax_cross_entropy_vocab<32000>(1000, 100);
+    benchmark_softmax_cross_entropy_vocab<262144>(100, 10);
+}
+
+// Benchmark: Gradient checkpointing, activation peak vs. step time
+void benchmark_gradient_checkpointing() {
+    cout << "\n=== Gradient Checkpointing Benchmark ===\n";
+    
+    using Linear = LinearLayer<float, 512, 512>;
+    using Relu = ReLULayer<float, 512>;
+    using Model = Sequential<Linear, Relu, Linear, Relu, Linear, Relu, Linear, Relu,
+                             Linear, Relu, Linear, Relu, Linear, Relu, Linear>;
+    
+    constexpr int iterations = 10;
+    constexpr int warmup = 2;
+    constexpr std::size_t batch = 16;
+    
+    auto model = nn_memory::make_tracked<Model>(nn_memory::MemoryPurpose::Weights);
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+        ([&] {
+            if constexpr (I % 2 == 0) random_init(model->template layer<I>().get_weights(), -0.05f, 0.05f);
+        }(), ...);
+    }(std::make_index_sequence<Model::num_layers>{});
+    
+    std::vector<Tensor<float, 512>> inputs(batch);
+    for (auto& x : inputs) random_init(x, -1.0f, 1.0f);
+    auto mse = [](const Tensor<float, 512>& output, Tensor<float, 512>& grad) {
+        float loss = 0.0f;
+        for (std::size_t i = 0; i < output.size(); ++i) {
+            grad.data()[i] = output.data()[i] / static_cast<float>(batch);
+            loss += 0.5f * output.data()[i] * output.data()[i];
+        }
+        return loss;
+    };
+    
+    const std::size_t full = CheckpointedModel<Model>::full_activation_bytes();
+    // Everything stored, half the activations, and the smallest plan (budget 0)
+    for (std::size_t budget : {full, full / 2, std::size_t(0)}) {
+        CheckpointedModel<Model> trainer(*model, budget);
+        
+        BenchmarkStats stats("Checkpoint (15 layers, budget " + to_string(budget) + " B, batch 16) - C++ (Meta)");
+        volatile float loss = 0.0f;
+        stats.run_benchmark([&]() {
+            float total = 0.0f;
+            for (const auto& x : inputs) total += trainer.accumulate(x, mse);
+            trainer.sgd_step(1e-4f);
+            loss = total;
+        }, iterations, warmup);
+        (void)loss;
+        
+        trainer.activation_stats().reset_peak();
+        trainer.accumulate(inputs[0], mse);
+        trainer.zero_gradients();
+        
+        stats.print_stats();
+        cout << "  Peak activations: " << trainer.activation_stats().peak_bytes() << " B ("
+             << trainer.plan().num_stored() << "/" << Model::num_layers << " inputs stored, "
+             << trainer.plan().recomputed_layers << " layers recomputed)\n";
+    }
+}
+
+// Benchmark: FP32 vs. BF16 mixed-precision training of one LinearLayer
+void benchmark_mixed_precision() {
+    cout << "\n=== Mixed-Precision Training Benchmark ===\n";
+    
+    constexpr int iterations = 20;
+    constexpr int warmup = 3;
+    constexpr std::size_t batch = 32;
+    constexpr std::size_t in = 1024, out = 512;
+    
+    std::vector<Tensor<float, in>> inputs(batch);
+    std::vector<Tensor<bfloat16, in>> inputs_bf16(batch);
+    std::vector<Tensor<float, out>> targets(batch);
+    for (std::size_t b = 0; b < batch; ++b) {
+        random_init(inputs[b], -1.0f, 1.0f);
+        random_init(targets[b], -1.0f, 1.0f);
+        inputs_bf16[b] = to_bfloat16(inputs[b]);
+    }
+    
+    {
+        auto layer = nn_memory::make_tracked<LinearLayer<float, in, out>>(nn_memory::MemoryPurpose::Weights);
+        random_init(layer->get_weights(), -0.05f, 0.05f);
+        auto grads = nn_memory::make_tracked<LinearGradients<float, in, out>>(nn_memory::MemoryPurpose::Workspace);
+        
+        BenchmarkStats stats("Train FP32 (1024->512, batch 32) - C++ (Meta)");
+        volatile float loss = 0.0f;
+        stats.run_benchmark([&]() {
+            grads->zero();
+            float total = 0.0f;
+            for (std::size_t b = 0; b < batch; ++b) {
+                Tensor<float, out> output = layer->forward(inputs[b]);
+                Tensor<float, out> grad_output;
+                for (std::size_t i = 0; i < out; ++i) {
+                    float diff = output(i) - targets[b](i);
+                    total += 0.5f * diff * diff;
+                    grad_output(i) = diff / batch;
+                }
+                layer->accumulate_gradients(inputs[b], grad_output, *grads);
+            }
+            layer->sgd_update(*grads, 0.01f);
+            loss = total;
+        }, iterations, warmup);
+        (void)loss;
+        
+        stats.print_stats();
+        cout << "  Activations: " << batch * sizeof(Tensor<float, in>) << " B\n";
+    }
+    
+    {
+        auto layer = nn_memory::make_tracked<LinearLayer<float, in, out>>(nn_memory::MemoryPurpose::Weights);
+        random_init(layer->get_weights(), -0.05f, 0.05f);
+        MixedPrecisionTrainer<in, out> trainer(*layer, 0.01f);
+        
+        BenchmarkStats stats("Train BF16 (1024->512, batch 32) - C++ (Meta)");
+        volatile float loss = 0.0f;
+        stats.run_benchmark([&]() {
+            loss = trainer.train_step(inputs_bf16.data(), targets.data(), batch);
+        }, iterations, warmup);
+        (void)loss;
+        
+        stats.print_stats();
+        cout << "  Activations: " << batch * sizeof(Tensor<bfloat16, in>) << " B (loss scale "
+             << trainer.scaler().scale() << ", " << trainer.scaler().skipped_steps() << " steps skipped)\n";
+    }
+}
+
+// Benchmark: Tensor fill, Philox (parallel, counter-based) vs. serial mt19937
+void benchmark_random_fill() {
+    cout << "\n=== Random Fill Benchmark ===\n";
+    
+    constexpr int iterations = 50;
+    constexpr int warmup = 5;
+    constexpr std::size_t n = 1 << 20;
+    auto tensor = nn_memory::make_tracked<Tensor<float, n>>(nn_memory::MemoryPurpose::Other);
+    
+    auto report = [&](BenchmarkStats& stats) {
+        stats.print_stats();
+        cout << "  Bandwidth: " << std::fixed << std::setprecision(2)
+             << sizeof(float) * n / (stats.get_mean() * 1e3) << " GB/s\n";
+    };
+    
+    {
+        BenchmarkStats stats("Uniform mt19937 (1048576) - C++ (Meta)");
+        std::mt19937 gen(benchmark_seed);
+        std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+        stats.run_benchmark([&]() {
+            for (std::size_t i = 0; i < n; ++i) tensor->data()[i] = dis(gen);
+        }, iterations, warmup);
+        report(stats);
+    }
+    {
+        BenchmarkStats stats("Uniform Philox (1048576, " + to_string(ThreadPool::global().size()) +
+                             " threads) - C++ (Meta)");
+        std::uint64_t stream = 0;
+        stats.run_benchmark([&]() {
+            nn_random::uniform_(*tensor, nn_random::Philox(benchmark_seed, stream++), -1.0f, 1.0f);
+        }, iterations, warmup);
+        report(stats);
+    }
+}
+
+// Benchmark: Linear + dropout, stored uint8 mask vs. fused regenerated mask
+void benchmark_dropout() {
+    cout << "\n=== Fused Dropout Benchmark ===\n";
+    
+    constexpr int iterations = 20;
+    constexpr int warmup = 3;
+    constexpr std::size_t batch = 32;
+    constexpr std::size_t in = 1024, out = 512;
+    constexpr float drop_prob = 0.1f;
+    
+    std::vector<Tensor<float, in>> inputs(batch);
+    for (auto& x : inputs) random_init(x, -1.0f, 1.0f);
+    Tensor<float, out> grad_output;
+    random_init(grad_output, -1.0f, 1.0f);
+    
+    {
+        auto layer = nn_memory::make_tracked<LinearLayer<float, in, out>>(nn_memory::MemoryPurpose::Weights);
+        random_init(layer->get_weights(), -0.05f, 0.05f);
+        auto grads = nn_memory::make_tracked<LinearGradients<float, in, out>>(nn_memory::MemoryPurpose::Workspace);
+        std::vector<std::uint8_t> masks(batch * out);
+        const float scale = 1.0f / (1.0f - drop_prob);
+        
+        BenchmarkStats stats("Linear+Dropout stored mask (1024->512, batch 32) - C++ (Meta)");
+        volatile float sink = 0.0f;
+        std::uint64_t step = 0;
+        stats.run_benchmark([&]() {
+            nn_random::Philox rng(benchmark_seed, step++);
+            rng.bernoulli_range(masks.data(), 0, masks.size(), 1.0f - drop_prob);
+            for (std::size_t b = 0; b < batch; ++b) {
+                const std::uint8_t* mask = masks.data() + b * out;
+                Tensor<float, out> y = layer->forward(inputs[b]);
+                for (std::size_t i = 0; i < out; ++i) y(i) *= mask[i] * scale;
+                Tensor<float, out> g;
+                for (std::size_t i = 0; i < out; ++i) g(i) = grad_output(i) * mask[i] * scale;
+                sink = y(0) + layer->backward(inputs[b], g, *grads)(0);
+            }
+        }, iterations, warmup);
+        (void)sink;
+        
+        stats.print_stats();
+        cout << "  Mask memory: " << masks.size() << " B\n";
+    }
+    
+    {
+        auto layer = nn_memory::make_tracked<LinearDropoutLayer<float, in, out>>(
+            nn_memory::MemoryPurpose::Weights, drop_prob, benchmark_seed);
+        random_init(layer->linear().get_weights(), -0.05f, 0.05f);
+        auto grads = nn_memory::make_tracked<LinearGradients<float, in, out>>(nn_memory::MemoryPurpose::Workspace);
+        
+        BenchmarkStats stats("Linear+Dropout fused (1024->512, batch 32) - C++ (Meta)");
+        volatile float sink = 0.0f;
+        std::uint64_t step = 0;
+        stats.run_benchmark([&]() {
+            for (std::size_t b = 0; b < batch; ++b) {
+                layer->select_mask(step, b);
+                Tensor<float, out> y = layer->forward(inputs[b]);
+                sink = y(0) + layer->backward(inputs[b], grad_output, *grads)(0);
+            }
+            ++step;
+        }, iterations, warmup);
+        (void)sink;
+        
+        stats.print_stats();
+        cout << "  Mask memory: 0 B (regenerated in backward)\n";
+    }
+}
+
+// Benchmark: Decoding sampler (temperature + top-k + top-p) vs. full-sort baseline
+template<std::size_t Vocab>
+void benchmark_sampling_vocab(int iterations, int warmup) {
+    constexpr std::size_t batch = 8;
+    auto logits = nn_memory::make_tracked<Tensor<float, batch, Vocab>>(nn_memory::MemoryPurpose::Activations);
+    nn_random::normal_(*logits, nn_random::Philox(benchmark_seed, 1), 0.0f, 3.0f);
+    const SamplingParams params{0.8f, 50, 0.9f};
+    const nn_random::Philox rng(benchmark_seed, 2);
+    const std::string shape = "(" + to_string(batch) + "x" + to_string(Vocab) + ")";
+    
+    {
+        BenchmarkStats stats("Sample full sort " + shape + " - C++ (Meta)");
+        std::vector<std::uint32_t> order(Vocab);
+        volatile std::size_t token = 0;
+        std::uint64_t step = 0;
+        stats.run_benchmark([&]() {
+            for (std::size_t b = 0; b < batch; ++b) {
+                const float* row = logits->data() + b * Vocab;
+                std::iota(order.begin(), order.end(), 0u);
+                std::sort(order.begin(), order.end(), [&](std::uint32_t x, std::uint32_t y) { return row[x] > row[y]; });
+                std::vector<float> sorted(params.top_k);
+                for (std::size_t i = 0; i < params.top_k; ++i) sorted[i] = row[order[i]];
+                std::size_t pick = sample_row(sorted.data(), params.top_k, params,
+                                              nn_random::detail::to_unit<float>(rng.word(b, step)));
+                token = order[pick];
+            }
+            ++step;
+        }, iterations, warmup);
+        (void)token;
+        stats.print_stats();
+    }
+    {
+        BenchmarkStats stats("Sample top-k/top-p " + shape + " - C++ (Meta)");
+        volatile std::size_t token = 0;
+        std::uint64_t step = 0;
+        stats.run_benchmark([&]() {
+            token = sample(*logits, params, rng, step++)[0];
+        }, iterations, warmup);
+        (void)token;
+        stats.print_stats();
+        cout << "  Throughput: " << std::fixed << std::setprecision(0)
+             << batch / (stats.get_mean() * 1e-6) << " tokens/s\n";
+    }
+}
+
+void benchmark_sampling() {
+    cout << "\n=== Sampling Benchmark (T=0.8, top-k 50, top-p 0.9) ===\n";
+    
+    benchmark_sampling_vocab<32000>(30, 3);
+    benchmark_sampling_vocab<128000>(10, 2);
+}
+
+// Benchmark: Packed GEMM (C = A * B^T) vs. the LinearLayer loop over rows
+void benchmark_gemm() {
+    cout << "\n=== GEMM Benchmark ===\n";
+    
+    constexpr int iterations = 20;
+    constexpr int warmup = 3;
+    constexpr std::size_t M = 256, N = 512, K = 1024;
+    
+    auto layer = nn_memory::make_tracked<LinearLayer<float, K, N>>(nn_memory::MemoryPurpose::Weights);
+    random_init(layer->get_weights(), -0.05f, 0.05f);
+    auto a = nn_memory::make_tracked<Tensor<float, M, K>>(nn_memory::MemoryPurpose::Activations);
+    auto c = nn_memory::make_tracked<Tensor<float, M, N>>(nn_memory::MemoryPurpose::Activations);
+    random_init(*a, -1.0f, 1.0f);
+    
+    {
+        BenchmarkStats stats("Linear rows (256x512x1024) - C++ (Meta)");
+        stats.run_benchmark([&]() {
+            for (std::size_t m = 0; m < M; ++m) {
+                Tensor<float, K> row;
+                std::copy(a->data() + m * K, a->data() + (m + 1) * K, row.data());
+                Tensor<float, N> out = layer->forward(row);
+                std::copy(out.data(), out.data() + N, c->data() + m * N);
+            }
+        }, iterations, warmup);
+        stats.print_stats();
+    }
+    {
+        BenchmarkStats stats("GEMM (256x512x1024) - C++ (Meta)");
+        stats.run_benchmark([&]() {
+            gemm_nt(M, N, K, a->data(), layer->get_weights().data(), c->data(), layer->get_bias().data());
+        }, iterations, warmup);
+        stats.print_stats();
+        cout << "  Throughput: " << std::fixed << std::setprecision(2)
+             << 2.0 * M * N * K / (stats.get_mean() * 1e3) << " GFLOP/s\n";
+    }
+}
+
+// Benchmark: Mixture-of-experts step, per-token expert calls vs. grouped GEMM
+void benchmark_moe() {
+    cout << "\n=== Mixture-of-Experts Benchmark ===\n";
+    
+    constexpr int iterations = 20;
+    constexpr int warmup = 3;
+    constexpr std::size_t tokens = 512, hidden = 512, experts = 8, top_k = 2;
+    using MoE = MixtureOfExperts<hidden, hidden, experts, top_k>;
+    
+    MoE moe;
+    random_init(moe.router().get_weights(), -0.1f, 0.1f);
+    for (std::size_t e = 0; e < experts; ++e) random_init(moe.expert(e).get_weights(), -0.05f, 0.05f);
+    auto x = nn_memory::make_tracked<Tensor<float, tokens, hidden>>(nn_memory::MemoryPurpose::Activations);
+    auto y = nn_memory::make_tracked<Tensor<float, tokens, hidden>>(nn_memory::MemoryPurpose::Activations);
+    random_init(*x, -1.0f, 1.0f);
+    moe.forward(x->data(), tokens, y->data());
+    const MoE::Routing routing = moe.routing();
+    
+    {
+        BenchmarkStats stats("MoE per-token (512 tokens, 512->512, 8 experts, top-2) - C++ (Meta)");
+        stats.run_benchmark([&]() {
+            for (std::size_t t = 0; t < tokens; ++t) {
+                Tensor<float, hidden> row;
+                std::copy(x->data() + t * hidden, x->data() + (t + 1) * hidden, row.data());
+                float* out = y->data() + t * hidden;
+                std::fill(out, out + hidden, 0.0f);
+                for (std::size_t s = 0; s < top_k; ++s) {
+                    Tensor<float, hidden> e = moe.expert(routing.expert[t * top_k + s]).forward(row);
+                    const float g = routing.gate[t * top_k + s];
+                    for (std::size_t j = 0; j < hidden; ++j) out[j] += g * e(j);
+                }
+            }
+        }, iterations, warmup);
+        stats.print_stats();
+    }
+    {
+        BenchmarkStats stats("MoE grouped (512 tokens, 512->512, 8 experts, top-2) - C++ (Meta)");
+        stats.run_benchmark([&]() {
+            moe.forward(x->data(), tokens, y->data());
+        }, iterations, warmup);
+        stats.print_stats();
+        cout << "  Throughput: " << std::fixed << std::setprecision(0)
+             << tokens / (stats.get_mean() * 1e-6) << " tokens/s\n";
+    }
+}
+
+// Benchmark: Tiled attention over all blocks vs. sliding-window / block-sparse masks
+void benchmark_sparse_attention() {
+    cout << "\n=== Sparse Attention Benchmark (4096 tokens, d 64) ===\n";
+    
+    constexpr int iterations = 5;
+    constexpr int warmup = 1;
+    constexpr std::size_t heads = 1, seq_len = 4096, dim = 64, block = 64;
+    constexpr std::size_t elements = heads * seq_len * dim;
+    
+    std::vector<float> q(elements), k(elements), v(elements), out(elements);
+    nn_random::Philox rng(benchmark_seed, 3);
+    rng.normal_range(q.data(), 0, elements, 0.0f, 1.0f, 0);
+    rng.normal_range(k.data(), 0, elements, 0.0f, 1.0f, elements);
+    rng.normal_range(v.data(), 0, elements, 0.0f, 1.0f, 2 * elements);
+    
+    // BigBird-like: diagonal band, first column and a fixed stride of key blocks
+    constexpr std::size_t blocks = seq_len / block;
+    constexpr auto strided = StaticBlockMask<blocks, blocks>::build([](std::size_t qb, std::size_t kb) {
+        return (qb > kb ? qb - kb : kb - qb) <= 1 || kb == 0 || kb % 8 == 3;
+    });
+    
+    const std::pair<std::string, BlockMask> masks[] = {
+        {"dense", BlockMask(seq_len, block)},
+        {"window 256 + 64 global", BlockMask::sliding_window(seq_len, block, 256, 64)},
+        {"block-sparse strided", BlockMask(strided, block)},
+    };
+    for (const auto& [name, mask] : masks) {
+        BenchmarkStats stats("Attention " + name + " - C++ (Meta)");
+        stats.run_benchmark([&]() {
+            sparse_attention(q.data(), k.data(), v.data(), out.data(), heads, dim, mask);
+        }, iterations, warmup);
+        stats.print_stats();
+        cout << "  Blocks: " << mask.nnz_blocks() << " / " << blocks * blocks << " ("
+             << std::fixed << std::setprecision(1) << 100.0 * mask.density() << "%), "
+             << std::setprecision(2)
+             << 4.0 * heads * mask.nnz_blocks() * block * block * dim / (stats.get_mean() * 1e3)
+             << " GFLOP/s\n";
+    }
+}
+
+// Benchmark: Embedding-row lookup, random element gather and scatter-add
+void benchmark_indexing() {
+    cout << "\n=== Indexing Benchmark (gather / scatter) ===\n";
+    
+    constexpr int iterations = 20;
+    constexpr int warmup = 3;
+    constexpr std::size_t rows = 200000, width = 64, lookups = 16384;
+    constexpr std::size_t elements = 1 << 22, picks = 1 << 20, bins = 1 << 16;
+    
+    auto table = nn_memory::make_tracked<Tensor<float, rows, width>>(nn_memory::MemoryPurpose::Weights);
+    auto out = nn_memory::make_tracked<Tensor<float, lookups, width>>(nn_memory::MemoryPurpose::Activations);
+    random_init(*table, -1.0f, 1.0f);
+    std::vector<float> flat(elements), picked(picks), values(picks), histogram(bins);
+    std::vector<std::int32_t> row_ids(lookups), element_ids(picks), bin_ids(picks);
+    const nn_random::Philox rng(benchmark_seed, 4);
+    rng.uniform_range(flat.data(), 0, elements, -1.0f, 1.0f);
+    rng.uniform_range(values.data(), 0, picks, -1.0f, 1.0f, elements);
+    for (std::size_t i = 0; i < lookups; ++i) row_ids[i] = static_cast<std::int32_t>(rng.word(i, 1 << 24) % rows);
+    for (std::size_t i = 0; i < picks; ++i) {
+        element_ids[i] = static_cast<std::int32_t>(rng.word(i, 1 << 25) % elements);
+        bin_ids[i] = static_cast<std::int32_t>(rng.word(i, 1 << 26) % bins);
+    }
+    
+    auto report = [](BenchmarkStats& stats, double bytes) {
+        stats.print_stats();
+        cout << "  Bandwidth: " << std::fixed << std::setprecision(2) << bytes / (stats.get_mean() * 1e3)
+             << " GB/s\n";
+    };
+    const double row_bytes = 2.0 * sizeof(float) * lookups * width;
+    const double element_bytes = (2.0 * sizeof(float) + sizeof(std::int32_t)) * picks;
+    
+    {
+        BenchmarkStats stats("Embedding lookup loop (16384 x 64 of 200000) - C++ (Meta)");
+        stats.run_benchmark([&]() {
+            for (std::size_t i = 0; i < lookups; ++i) {
+                const float* src = table->data() + static_cast<std::size_t>(row_ids[i]) * width;
+                std::copy(src, src + width, out->data() + i * width);
+            }
+        }, iterations, warmup);
+        report(stats, row_bytes);
+    }
+    {
+        BenchmarkStats stats("index_select rows (16384 x 64 of 200000) - C++ (Meta)");
+        stats.run_benchmark([&]() {
+            index_select(*table, 0, row_ids, *out);
+        }, iterations, warmup);
+        report(stats, row_bytes);
+    }
+    {
+        BenchmarkStats stats("Gather loop (1M of 4M) - C++ (Meta)");
+        stats.run_benchmark([&]() {
+            for (std::size_t i = 0; i < picks; ++i) picked[i] = flat[element_ids[i]];
+        }, iterations, warmup);
+        report(stats, element_bytes);
+    }
+    {
+        BenchmarkStats stats("gather (1M of 4M) - C++ (Meta)");
+        stats.run_benchmark([&]() {
+            gather(TensorView<const float, 1>(flat.data(), {elements}), 0,
+                   TensorView<const std::int32_t, 1>(element_ids.data(), {picks}),
+                   TensorView<float, 1>(picked.data(), {picks}));
+        }, iterations, warmup);
+        report(stats, element_bytes);
+    }
+    {
+        BenchmarkStats stats("scatter_add (1M into 65536 bins) - C++ (Meta)");
+        stats.run_benchmark([&]() {
+            scatter_add(TensorView<float, 1>(histogram.data(), {bins}), 0,
+                        TensorView<const std::int32_t, 1>(bin_ids.data(), {picks}),
+                        TensorView<const float, 1>(values.data(), {picks}));
+        }, iterations, warmup);
+        report(stats, element_bytes);
+    }
+}
+
+// Benchmark: Inception-style branch merge, concat copy vs. planned in-place slots
+void benchmark_concat() {
+    cout << "\n=== Concat Benchmark (4 branches, 512->128, batch 256) ===\n";
+    
+    constexpr int iterations = 30;
+    constexpr int warmup = 3;
+    constexpr std::size_t batch = 256, in = 512, branch_out = 128, branches = 4;
+    
+    auto x = nn_memory::make_tracked<Tensor<float, batch, in>>(nn_memory::MemoryPurpose::Activations);
+    random_init(*x, -1.0f, 1.0f);
+    std::vector<nn_memory::TrackedPtr<LinearLayer<float, in, branch_out>>> layers;
+    std::vector<nn_memory::TrackedPtr<Tensor<float, batch, branch_out>>> branch_outputs;
+    for (std::size_t b = 0; b < branches; ++b) {
+        layers.push_back(nn_memory::make_tracked<LinearLayer<float, in, branch_out>>(nn_memory::MemoryPurpose::Weights));
+        random_init(layers.back()->get_weights(), -0.05f, 0.05f);
+        branch_outputs.push_back(
+            nn_memory::make_tracked<Tensor<float, batch, branch_out>>(nn_memory::MemoryPurpose::Activations));
+    }
+    ConcatBuffer<float, 2> merged({batch, 0}, 1, std::vector<std::size_t>(branches, branch_out));
+    const double merged_bytes = sizeof(float) * batch * branch_out * branches;
+    
+    {
+        BenchmarkStats stats("Branches + concat copy - C++ (Meta)");
+        stats.run_benchmark([&]() {
+            for (std::size_t b = 0; b < branches; ++b) {
+                gemm_nt(view(*x), view(layers[b]->get_weights()), view(*branch_outputs[b]),
+                        layers[b]->get_bias().data());
+            }
+            for (std::size_t b = 0; b < branches; ++b) merged.copy_into(b, view(*branch_outputs[b]));
+        }, iterations, warmup);
+        stats.print_stats();
+    }
+    {
+        BenchmarkStats stats("Branches into concat slots - C++ (Meta)");
+        stats.run_benchmark([&]() {
+            for (std::size_t b = 0; b < branches; ++b) {
+                gemm_nt(view(*x), view(layers[b]->get_weights()), merged.slot(b), layers[b]->get_bias().data());
+            }
+        }, iterations, warmup);
+        stats.print_stats();
+    }
+    {
+        BenchmarkStats stats("Concat copy only (4 x 256x128) - C++ (Meta)");
+        stats.run_benchmark([&]() {
+            for (std::size_t b = 0; b < branches; ++b) merged.copy_into(b, view(*branch_outputs[b]));
+        }, iterations, warmup);
+        stats.print_stats();
+        cout << "  Bandwidth: " << std::fixed << std::setprecision(2)
+             << 2.0 * merged_bytes / (stats.get_mean() * 1e3) << " GB/s\n";
+    }
+}
+
+// Benchmark: Prefix sums, serial std::partial_sum vs. SIMD / parallel scan
+void benchmark_scan() {
+    cout << "\n=== Prefix Scan Benchmark ===\n";
+    
+    constexpr int iterations = 20;
+    constexpr int warmup = 3;
+    constexpr std::size_t n = 1 << 24, rows = 4096, cols = 1024, segment = 100;
+    
+    std::vector<float> x(n), y(n);
+    nn_random::Philox(benchmark_seed, 5).uniform_range(x.data(), 0, n, 0.0f, 1.0f);
+    std::vector<std::uint8_t> heads(n, 0);
+    for (std::size_t i = 0; i < n; i += segment) heads[i] = 1;
+    const TensorView<const float, 1> xv(x.data(), {n});
+    const TensorView<float, 1> yv(y.data(), {n});
+    const TensorView<const float, 2> xm(x.data(), {rows, cols});
+    const TensorView<float, 2> ym(y.data(), {rows, cols});
+    
+    auto report = [](BenchmarkStats& stats, std::size_t elements) {
+        stats.print_stats();
+        cout << "  Bandwidth: " << std::fixed << std::setprecision(2)
+             << 2.0 * sizeof(float) * elements / (stats.get_mean() * 1e3) << " GB/s\n";
+    };
+    {
+        BenchmarkStats stats("std::partial_sum (16M) - C++ (Meta)");
+        stats.run_benchmark([&]() { std::partial_sum(x.begin(), x.end(), y.begin()); }, iterations, warmup);
+        report(stats, n);
+    }
+    {
+        BenchmarkStats stats("cumsum (16M) - C++ (Meta)");
+        stats.run_benchmark([&]() { cumsum(xv, 0, yv); }, iterations, warmup);
+        report(stats, n);
+    }
+    {
+        BenchmarkStats stats("Segmented cumsum (16M, segments of 100) - C++ (Meta)");
+        stats.run_benchmark([&]() { segmented_scan(xv, 0, heads, yv); }, iterations, warmup);
+        report(stats, n);
+    }
+    {
+        BenchmarkStats stats("cumsum axis 0 (4096x1024) - C++ (Meta)");
+        stats.run_benchmark([&]() { cumsum(xm, 0, ym); }, iterations, warmup);
+        report(stats, rows * cols);
+    }
+    {
+        BenchmarkStats stats("cumsum axis 1 (4096x1024) - C++ (Meta)");
+        stats.run_benchmark([&]() { cumsum(xm, 1, ym); }, iterations, warmup);
+        report(stats, rows * cols);
+    }
+}
+
+// Benchmark: Top-k retrieval, full score matrix + sort vs. fused tiled heaps (float / int8)
+void benchmark_similarity_search() {
+    cout << "\n=== Similarity Search Benchmark (32 queries, 131072 x 128 table, top-10) ===\n";
+    
+    constexpr int iterations = 10;
+    constexpr int warmup = 2;
+    constexpr std::size_t queries = 32, rows = 131072, dim = 128, k = 10;
+    
+    std::vector<float> table(rows * dim), query(queries * dim);
+    const nn_random::Philox rng(benchmark_seed, 6);
+    rng.normal_range(table.data(), 0, table.size(), 0.0f, 1.0f);
+    rng.normal_range(query.data(), 0, query.size(), 0.0f, 1.0f, table.size());
+    const Int8Table quantized(table.data(), rows, dim);
+    
+    auto report = [](BenchmarkStats& stats, double table_bytes) {
+        stats.print_stats();
+        cout << "  Throughput: " << std::fixed << std::setprecision(0) << queries / (stats.get_mean() * 1e-6)
+             << " queries/s, table scan " << std::setprecision(2) << table_bytes / (stats.get_mean() * 1e3)
+             << " GB/s\n";
+    };
+    {
+        BenchmarkStats stats("Score matrix + partial_sort - C++ (Meta)");
+        std::vector<float> scores(queries * rows);
+        std::vector<std::uint32_t> order(rows);
+        volatile std::uint32_t best = 0;
+        stats.run_benchmark([&]() {
+            gemm_nt(queries, rows, dim, query.data(), table.data(), scores.data());
+            for (std::size_t q = 0; q < queries; ++q) {
+                const float* s = scores.data() + q * rows;
+                std::iota(order.begin(), order.end(), 0u);
+                std::partial_sort(order.begin(), order.begin() + k, order.end(),
+                                  [&](std::uint32_t a, std::uint32_t b) { return s[a] > s[b] || (s[a] == s[b] && a < b); });
+                best = order[0];
+            }
+        }, iterations, warmup);
+        (void)best;
+        report(stats, sizeof(float) * rows * dim);
+    }
+    {
+        BenchmarkStats stats("Fused top-k float - C++ (Meta)");
+        volatile std::uint32_t best = 0;
+        stats.run_benchmark([&]() {
+            best = similarity_search(query.data(), queries, table.data(), rows, dim, k).ids[0];
+        }, iterations, warmup);
+        (void)best;
+        report(stats, sizeof(float) * rows * dim);
+    }
+    {
+        BenchmarkStats stats("Fused top-k int8 - C++ (Meta)");
+        volatile std::uint32_t best = 0;
+        stats.run_benchmark([&]() {
+            best = similarity_search(query.data(), queries, quantized, k).ids[0];
+        }, iterations, warmup);
+        (void)best;
+        report(stats, (sizeof(std::int8_t) * dim + sizeof(float)) * rows);
+    }
+}
+
+// Direct vs. overlap-save FFT at one tap count (4 -> 4 channels)
+template<std::size_t Taps>
+void benchmark_conv1d_taps(const std::vector<float>& signal, std::size_t length, std::vector<float>& output) {
+    constexpr std::size_t channels = 4;
+    constexpr int iterations = 5;
+    constexpr int warmup = 1;
+    
+    Conv1D<channels, channels, Taps> conv;
+    auto& weights = conv.get_weights();
+    nn_random::Philox(benchmark_seed, 7).normal_range(weights.data(), 0, weights.size(), 0.0f, 0.1f);
+    const std::size_t out_len = conv.output_length(length);
+    const double flops = 2.0 * channels * channels * Taps * out_len;
+    
+    for (ConvAlgorithm algorithm : {ConvAlgorithm::Direct, ConvAlgorithm::Fft}) {
+        const bool fft = algorithm == ConvAlgorithm::Fft;
+        BenchmarkStats stats(std::string(fft ? "FFT conv1d" : "Direct conv1d") + " (" + std::to_string(Taps) +
+                             " taps) - C++ (Meta)");
+        stats.run_benchmark([&]() { conv.forward(signal.data(), length, output.data(), algorithm); },
+                            iterations, warmup);
+        stats.print_stats();
+        cout << "  Throughput: " << std::fixed << std::setprecision(2) << flops / (stats.get_mean() * 1e3)
+             << " direct-equivalent GFLOP/s" << (fft == conv.prefers_fft ? "  [auto]" : "") << "\n";
+    }
+}
+
+// Benchmark: 1-D convolution with long kernels, direct vs. FFT (overlap-save)
+void benchmark_conv1d() {
+    cout << "\n=== Conv1D Benchmark (4 -> 4 channels, 65536 samples) ===\n";
+    
+    constexpr std::size_t channels = 4, length = 65536;
+    std::vector<float> signal(channels * length), output(channels * length);
+    nn_random::Philox(benchmark_seed, 8).normal_range(signal.data(), 0, signal.size(), 0.0f, 1.0f);
+    
+    benchmark_conv1d_taps<16>(signal, length, output);
+    benchmark_conv1d_taps<64>(signal, length, output);
+    benchmark_conv1d_taps<256>(signal, length, output);
+    benchmark_conv1d_taps<1024>(signal, length, output);
+}
+
+// Benchmark: 3x3 convolution, im2col buffer + GEMM vs. implicit GEMM
+void benchmark_conv2d() {
+    cout << "\n=== Conv2D Benchmark (NHWC 1x56x56x64 -> 64, 3x3, pad 1) ===\n";
+    
+    constexpr int iterations = 10;
+    constexpr int warmup = 2;
+    constexpr std::size_t height = 56, width = 56, channels = 64, taps = 3;
+    using Conv = Conv2D<channels, channels, taps, taps, 1, 1>;
+    constexpr std::size_t pixels = height * width, patch = Conv::patch_size;
+    
+    auto conv = nn_memory::make_tracked<Conv>(nn_memory::MemoryPurpose::Weights);
+    auto& weights = conv->get_weights();
+    nn_random::Philox(benchmark_seed, 9).normal_range(weights.data(), 0, weights.size(), 0.0f, 0.05f);
+    std::vector<float> input(pixels * channels), output(pixels * channels), columns(pixels * patch);
+    nn_random::Philox(benchmark_seed, 10).normal_range(input.data(), 0, input.size(), 0.0f, 1.0f);
+    
+    auto report = [](BenchmarkStats& stats) {
+        stats.print_stats();
+        cout << "  Throughput: " << std::fixed << std::setprecision(2)
+             << 2.0 * pixels * channels * patch / (stats.get_mean() * 1e3) << " GFLOP/s\n";
+    };
+    {
+        BenchmarkStats stats("im2col + GEMM - C++ (Meta)");
+        stats.run_benchmark([&]() {
+            for (std::size_t oh = 0; oh < height; ++oh) {
+                for (std::size_t ow = 0; ow < width; ++ow) {
+                    float* col = columns.data() + (oh * width + ow) * patch;
+                    for (std::size_t kh = 0; kh < taps; ++kh) {
+                        for (std::size_t kw = 0; kw < taps; ++kw, col += channels) {
+                            const std::size_t ih = oh + kh - 1, iw = ow + kw - 1;  // wraps when in the padding
+                            if (ih >= height || iw >= width) {
+                                std::fill(col, col + channels, 0.0f);
+                            } else {
+                                const float* src = input.data() + (ih * width + iw) * channels;
+                                std::copy(src, src + channels, col);
+                            }
+                        }
+                    }
+                }
+            }
+            gemm_nt(pixels, channels, patch, columns.data(), weights.data(), output.data(),
+                    conv->get_bias().data());
+        }, iterations, warmup);
+        report(stats);
+        cout << "  im2col buffer: " << sizeof(float) * columns.size() / 1024 << " KiB ("
+             << columns.size() / input.size() << "x the input)\n";
+    }
+    {
+        BenchmarkStats stats("Implicit GEMM conv2d - C++ (Meta)");
+        stats.run_benchmark([&]() { conv->forward(input.data(), 1, height, width, output.data()); },
+                            iterations, warmup);
+        report(stats);
+    }
+}
+
+// Benchmark: two-layer 3x3 conv + ReLU block, float vs. uint8 end to end
+void benchmark_quantized_conv() {
+    cout << "\n=== Int8 Conv2D Benchmark (2x [3x3 conv 64 -> 64 + ReLU], NHWC 1x56x56) ===\n";
+    
+    constexpr int iterations = 10;
+    constexpr int warmup = 2;
+    constexpr std::size_t height = 56, width = 56, channels = 64;
+    using Conv = Conv2D<channels, channels, 3, 3, 1, 1>;
+    using QConv = QuantizedConv2D<channels, channels, 3, 3, 1, 1>;
+    constexpr std::size_t elements = height * width * channels;
+    
+    auto conv1 = nn_memory::make_tracked<Conv>(nn_memory::MemoryPurpose::Weights);
+    auto conv2 = nn_memory::make_tracked<Conv>(nn_memory::MemoryPurpose::Weights);
+    nn_random::Philox(benchmark_seed, 11).normal_range(conv1->get_weights().data(), 0, Conv::Weights::total_size,
+                                                       0.0f, 0.06f);
+    nn_random::Philox(benchmark_seed, 12).normal_range(conv2->get_weights().data(), 0, Conv::Weights::total_size,
+                                                       0.0f, 0.06f);
+    std::vector<float> input(elements), hidden(elements), output(elements);
+    nn_random::Philox(benchmark_seed, 13).uniform_range(input.data(), 0, elements, 0.0f, 1.0f);
+    
+    auto relu = [](std::vector<float>& x) {
+        for (float& v : x) v = std::max(v, 0.0f);
+    };
+    auto block = [&]() {
+        conv1->forward(input.data(), 1, height, width, hidden.data());
+        relu(hidden);
+        conv2->forward(hidden.data(), 1, height, width, output.data());
+        relu(output);
+    };
+    
+    // Calibrate activation ranges on the float block
+    block();
+    const QuantParams q_in = QuantParams::from_range(0.0f, 1.0f);
+    const QuantParams q_hidden = QuantParams::from_range(0.0f, *std::max_element(hidden.begin(), hidden.end()));
+    const QuantParams q_out = QuantParams::from_range(0.0f, *std::max_element(output.begin(), output.end()));
+    const std::vector<float> reference = output;
+    const QConv qconv1(*conv1, q_in, q_hidden);
+    const QConv qconv2(*conv2, q_hidden, q_out);
+    std::vector<std::uint8_t> input_q(elements), hidden_q(elements), output_q(elements);
+    quantize(input.data(), elements, q_in, input_q.data());
+    
+    auto report = [](BenchmarkStats& stats) {
+        stats.print_stats();
+        cout << "  Throughput: " << std::fixed << std::setprecision(2)
+             << 2 * 2.0 * height * width * channels * QConv::patch_size / (stats.get_mean() * 1e3) << " GOP/s\n";
+    };
+    {
+        BenchmarkStats stats("Float conv block - C++ (Meta)");
+        stats.run_benchmark(block, iterations, warmup);
+        report(stats);
+    }
+    {
+        BenchmarkStats stats("Int8 direct conv block - C++ (Meta)");
+        stats.run_benchmark([&]() {
+            qconv1.forward_direct(input_q.data(), 1, height, width, hidden_q.data());
+            qconv2.forward_direct(hidden_q.data(), 1, height, width, output_q.data());
+        }, iterations, warmup);
+        report(stats);
+    }
+    {
+        BenchmarkStats stats("Int8 implicit GEMM conv block - C++ (Meta)");
+        stats.run_benchmark([&]() {
+            qconv1.forward(input_q.data(), 1, height, width, hidden_q.data());
+            qconv2.forward(hidden_q.data(), 1, height, width, output_q.data());
+        }, iterations, warmup);
+        report(stats);
+    }
+    float max_error = 0.0f;
+    for (std::size_t i = 0; i < elements; ++i) {
+        max_error = std::max(max_error, std::fabs(q_out.dequantize(output_q[i]) - reference[i]));
+    }
+    cout << "  Max error vs. float: " << std::setprecision(4) << max_error << " (output scale " << q_out.scale
+         << ")\n";
+}
+
+void benchmark_graph_executor() {
+    cout << "\n=== Graph Executor Benchmark (MLP 784 -> 256 -> 128 -> 10 loaded from text) ===\n";
+    
+    constexpr int iterations = 20;
+    constexpr int warmup = 3;
+    using Model = Sequential<LinearLayer<float, 784, 256>, ReLULayer<float, 256>, LinearLayer<float, 256, 128>,
+                             ReLULayer<float, 128>, LinearLayer<float, 128, 10>>;
+    auto model = nn_memory::make_tracked<Model>(nn_memory::MemoryPurpose::Weights);
+    nn_random::Philox init(benchmark_seed, 14);
+    std::uint64_t offset = 0;  // in Philox blocks of 4 values
+    auto fill = [&](auto& tensor, float std) {
+        init.normal_range(tensor.data(), 0, tensor.size(), 0.0f, std, offset);
+        offset += (tensor.size() + 3) / 4;
+    };
+    fill(model->layer<0>().get_weights(), 0.05f);
+    fill(model->layer<2>().get_weights(), 0.09f);
+    fill(model->layer<4>().get_weights(), 0.12f);
+    
+    // The same model as a file: weights copied into params, one node per layer
+    auto describe = [&](std::size_t batch) {
+        nn_graph::Graph graph;
+        graph.add_input("x", {batch, 784});
+        auto add_linear = [&](const std::string& name, const auto& layer, const std::string& input) {
+            const auto& w = layer.get_weights();
+            const auto& b = layer.get_bias();
+            std::copy(w.data(), w.data() + w.size(),
+                      graph.add_param(name + ".w", {b.size(), w.size() / b.size()}).data.begin());
+            std::copy(b.data(), b.data() + b.size(), graph.add_param(name + ".b", {b.size()}).data.begin());
+            graph.add_node("linear", name, {input, name + ".w", name + ".b"});
+        };
+        add_linear("fc1", model->layer<0>(), "x");
+        graph.add_node("relu", "h1", {"fc1"});
+        add_linear("fc2", model->layer<2>(), "h1");
+        graph.add_node("relu", "h2", {"fc2"});
+        add_linear("logits", model->layer<4>(), "h2");
+        graph.add_output("logits");
+        std::stringstream text;
+        graph.write(text);
+        return text.str();
+    };
+    nn_graph::KernelRegistry generic = nn_graph::KernelRegistry::builtin();
+    nn_graph::KernelRegistry specialized = generic;
+    nn_graph::register_linear<784, 256>(specialized);
+    nn_graph::register_linear<256, 128>(specialized);
+    nn_graph::register_linear<128, 10>(specialized);
+    
+    for (std::size_t batch : {std::size_t(1), std::size_t(64)}) {
+        const std::string text = describe(batch);
+        std::vector<Model::Input> inputs(batch);
+        for (std::size_t r = 0; r < batch; ++r) {
+            nn_random::Philox(benchmark_seed, 15).uniform_range(inputs[r].data(), 0, 784, 0.0f, 1.0f, r * 784 / 4);
+        }
+        std::vector<Model::Output> reference(batch);
+        cout << "Batch " << batch << " (" << text.size() / 1024 << " KiB model file):\n";
+        {
+            BenchmarkStats stats("Sequential (compile-time) - C++ (Meta)");
+            stats.run_benchmark([&]() {
+                for (std::size_t r = 0; r < batch; ++r) reference[r] = model->forward(inputs[r]);
+            }, iterations, warmup);
+            stats.print_stats();
+        }
+        for (const auto* registry : {&generic, &specialized}) {
+            std::istringstream file(text);
+            std::string error;
+            auto graph = nn_graph::Graph::parse(file, error);
+            auto executor = graph ? nn_graph::GraphExecutor::create(std::move(*graph), *registry, error) : nullptr;
+            if (!executor) {
+                cout << "  Failed to load the model: " << error << "\n";
+                return;
+            }
+            float* x = executor->input("x");
+            for (std::size_t r = 0; r < batch; ++r) std::copy(inputs[r].data(), inputs[r].data() + 784, x + r * 784);
+            BenchmarkStats stats(registry == &generic ? "Graph, generic kernels - C++ (Meta)"
+                                                      : "Graph, specialized kernels - C++ (Meta)");
+            stats.run_benchmark([&]() { executor->run(); }, iterations, warmup);
+            stats.print_stats();
+            float max_error = 0.0f;
+            const float* logits = executor->output("logits");
+            for (std::size_t r = 0; r < batch; ++r) {
+                for (std::size_t i = 0; i < 10; ++i) {
+                    max_error = std::max(max_error, std::fabs(logits[r * 10 + i] - reference[r](i)));
+                }
+            }
+            cout << "  Plan:";
+            for (std::size_t step = 0; step < executor->num_steps(); ++step) {
+                cout << (step ? ", " : " ") << executor->step_label(step);
+            }
+            cout << "\n  Arena: " << executor->arena_bytes() << " bytes (" << executor->unshared_bytes()
+                 << " without reuse), max error vs. Sequential: " << std::scientific << std::setprecision(2)
+                 << max_error << std::defaultfloat << "\n";
+        }
+    }
+    
+    // A node whose shape matches a Conv2D instantiation: compile-time patch vs. runtime patch geometry
+    cout << "3x3 conv 64 -> 64, NHWC 1x56x56:\n";
+    nn_graph::Graph conv_graph;
+    conv_graph.add_input("x", {1, 56, 56, 64});
+    auto& kernel = conv_graph.add_param("k", {64, 3, 3, 64}).data;
+    nn_random::Philox(benchmark_seed, 16).normal_range(kernel.data(), 0, kernel.size(), 0.0f, 0.06f);
+    conv_graph.add_param("b", {64});
+    conv_graph.add_node("conv2d", "y", {"x", "k", "b"}, {{"pad", 1}});
+    conv_graph.add_output("y");
+    nn_graph::register_conv2d<64, 64, 3, 3, 1, 1>(specialized);
+    std::vector<float> conv_reference;
+    for (const auto* registry : {&generic, &specialized}) {
+        std::string error;
+        auto executor = nn_graph::GraphExecutor::create(conv_graph, *registry, error);
+        if (!executor) {
+            cout << "  Failed to plan the model: " << error << "\n";
+            return;
+        }
+        const std::size_t elements = 56 * 56 * 64;
+        nn_random::Philox(benchmark_seed, 17).uniform_range(executor->input("x"), 0, elements, 0.0f, 1.0f);
+        BenchmarkStats stats("Graph, " + executor->step_label(0) + " - C++ (Meta)");
+        stats.run_benchmark([&]() { executor->run(); }, iterations / 2, warmup);
+        stats.print_stats();
+        const float* y = executor->output("y");
+        if (conv_reference.empty()) {
+            conv_reference.assign(y, y + elements);
+        } else {
+            float max_error = 0.0f;
+            for (std::size_t i = 0; i < elements; ++i) {
+                max_error = std::max(max_error, std::fabs(y[i] - conv_reference[i]));
+            }
+            cout << "  Max difference: " << std::scientific << std::setprecision(2) << max_error << std::defaultfloat
+                 << "\n";
+        }
+    }
+}
+
+void benchmark_autotune() {
+    cout << "\n=== Autotune Cache Benchmark (graph kernels + Conv1D algorithm, timed once per host) ===\n";
+    
+    // Two independent nodes with a generic and a specialized kernel each
+    nn_graph::Graph graph;
+    graph.add_input("image", {1, 28, 28, 64});
+    graph.add_input("features", {1, 784});
+    nn_random::Philox init(benchmark_seed, 18);
+    auto& kernel = graph.add_param("k", {64, 3, 3, 64}).data;
+    init.normal_range(kernel.data(), 0, kernel.size(), 0.0f, 0.06f);
+    auto& weights = graph.add_param("w", {256, 784}).data;
+    init.normal_range(weights.data(), 0, weights.size(), 0.0f, 0.05f, kernel.size());
+    graph.add_param("b", {64});
+    graph.add_param("c", {256});
+    graph.add_node("conv2d", "conv", {"image", "k", "b"}, {{"pad", 1}});
+    graph.add_node("linear", "fc", {"features", "w", "c"});
+    graph.add_output("conv");
+    graph.add_output("fc");
+    nn_graph::KernelRegistry registry = nn_graph::KernelRegistry::builtin();
+    nn_graph::register_conv2d<64, 64, 3, 3, 1, 1>(registry);
+    nn_graph::register_linear<784, 256>(registry);
+    
+    const std::string path = (std::filesystem::temp_directory_path() / "nn_meta_autotune_benchmark.tsv").string();
+    auto plan = [&](const char* name, nn_autotune::Cache& cache) {
+        std::string error;
+        const auto start = std::chrono::steady_clock::now();
+        auto executor = nn_graph::GraphExecutor::create(graph, registry, error, nn_graph::KernelSelection::Tuned,
+                                                        ThreadPool::global(), cache);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        cout << "  " << name << ": plan in " << std::fixed << std::setprecision(2) << ms << " ms";
+        if (!executor) {
+            cout << " - failed: " << error << "\n";
+            return;
+        }
+        for (std::size_t step = 0; step < executor->num_steps(); ++step) {
+            cout << (step ? ", " : " (") << executor->step_label(step);
+        }
+        cout << ")\n";
+    };
+    cout << "Host: " << nn_autotune::host_key() << "\n";
+    {
+        nn_autotune::Cache first_process;
+        plan("Empty cache (tunes)", first_process);
+        plan("Same process (in-memory hit)", first_process);
+        first_process.save(path);
+    }
+    {
+        nn_autotune::Cache next_process;
+        next_process.load(path);
+        plan("Cache file loaded (no tuning)", next_process);
+        cout << "  " << next_process.size() << " entries in " << path << "\n";
+    }
+    std::remove(path.c_str());
+    
+    // Conv1D: measured winner vs. the modeled crossover of ConvAlgorithm::Auto
+    constexpr std::size_t length = 16384;
+    std::vector<float> signal(4 * length), output(4 * length);
+    nn_random::Philox(benchmark_seed, 19).uniform_range(signal.data(), 0, signal.size(), -1.0f, 1.0f);
+    auto conv1d = [&](auto& conv, std::size_t taps) {
+        using Conv = std::remove_reference_t<decltype(conv)>;
+        const auto start = std::chrono::steady_clock::now();
+        conv.forward(signal.data(), length, output.data(), ConvAlgorithm::Tuned);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        const std::size_t extents[] = {4, 4, taps, length, ThreadPool::global().size()};
+        const auto choice = nn_autotune::Cache::instance().find("conv1d", nn_autotune::shape_key(extents));
+        cout << "  Conv1D 4 -> 4, " << taps << " taps: tuned " << (choice ? choice->name : "?") << " ("
+             << std::setprecision(1) << (choice ? choice->microseconds : 0.0) << " us, first call " << ms
+             << " ms), model picks " << (Conv::prefers_fft ? "fft" : "direct") << "\n";
+    };
+    Conv1D<4, 4, 16> taps16;
+    Conv1D<4, 4, 32> taps32;
+    Conv1D<4, 4, 64> taps64;
+    conv1d(taps16, 16);
+    conv1d(taps32, 32);
+    conv1d(taps64, 64);
+    cout << std::defaultfloat;
+}
+
+void benchmark_warm_start() {
+    cout << "\n=== Warm-Start Snapshot Benchmark (int8 conv block + MLP graph, time to first inference) ===\n";
+    
+    using Clock = std::chrono::steady_clock;
+    auto ms_since = [](Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+    constexpr std::size_t height = 56, width = 56, channels = 64;
+    using Conv = Conv2D<channels, channels, 3, 3, 1, 1>;
+    using QConv = QuantizedConv2D<channels, channels, 3, 3, 1, 1>;
+    
+    // What a deploy ships: float conv weights and the MLP as a text model file
+    auto conv1 = nn_memory::make_tracked<Conv>(nn_memory::MemoryPurpose::Weights);
+    auto conv2 = nn_memory::make_tracked<Conv>(nn_memory::MemoryPurpose::Weights);
+    nn_random::Philox(benchmark_seed, 20).normal_range(conv1->get_weights().data(), 0, Conv::Weights::total_size,
+                                                       0.0f, 0.06f);
+    nn_random::Philox(benchmark_seed, 21).normal_range(conv2->get_weights().data(), 0, Conv::Weights::total_size,
+                                                       0.0f, 0.06f);
+    const QuantParams q_in = QuantParams::from_range(0.0f, 1.0f);
+    const QuantParams q_hidden = QuantParams::from_range(0.0f, 4.0f);
+    const QuantParams q_out = QuantParams::from_range(0.0f, 4.0f);
+    std::string model_file;
+    {
+        nn_graph::Graph mlp;
+        mlp.add_input("x", {1, 784});
+        nn_random::Philox init(benchmark_seed, 22);
+        std::uint64_t offset = 0;
+        const std::size_t sizes[] = {784, 256, 128, 10};
+        std::string input = "x";
+        for (std::size_t l = 0; l < 3; ++l) {
+            const std::string name = "fc" + std::to_string(l + 1);
+            auto& w = mlp.add_param(name + ".w", {sizes[l + 1], sizes[l]}).data;
+            init.normal_range(w.data(), 0, w.size(), 0.0f, 0.05f, offset);
+            offset += (w.size() + 3) / 4;
+            mlp.add_param(name + ".b", {sizes[l + 1]});
+            mlp.add_node("linear", name, {input, name + ".w", name + ".b"});
+            input = name;
+            if (l < 2) {
+                mlp.add_node("relu", name + ".relu", {name});
+                input = name + ".relu";
+            }
+        }
+        mlp.add_output(input);
+        std::ostringstream text;
+        mlp.write(text);
+        model_file = text.str();
+    }
+    nn_graph::KernelRegistry registry = nn_graph::KernelRegistry::builtin();
+    nn_graph::register_linear<784, 256>(registry);
+    nn_graph::register_linear<256, 128>(registry);
+    nn_graph::register_linear<128, 10>(registry);
+    
+    std::vector<std::uint8_t> image(height * width * channels), hidden(image.size()), features(image.size());
+    for (std::size_t i = 0; i < image.size(); ++i) image[i] = static_cast<std::uint8_t>(i * 37 % 251);
+    auto infer = [&](const QConv& a, const QConv& b, nn_graph::GraphExecutor& mlp) {
+        a.forward(image.data(), 1, height, width, hidden.data());
+        b.forward(hidden.data(), 1, height, width, features.data());
+        float* x = mlp.input("x");
+        for (std::size_t i = 0; i < 784; ++i) x[i] = q_out.dequantize(features[i]);
+        mlp.run();
+    };
+    auto report = [](const char* name, const std::vector<std::pair<const char*, double>>& phases) {
+        double total = 0.0;
+        cout << "  " << name << ":";
+        for (const auto& [phase, ms] : phases) {
+            cout << (total == 0.0 ? " " : ", ") << phase << " " << std::fixed << std::setprecision(2) << ms << " ms";
+            total += ms;
+        }
+        cout << "\n    Time to first inference: " << total << " ms\n" << std::defaultfloat;
+    };
+    
+    const std::string path = (std::filesystem::temp_directory_path() / "nn_meta_warm_start.snap").string();
+    // Removes the snapshot on every exit path
+    struct RemoveOnExit {
+        std::string path;
+        ~RemoveOnExit() { std::remove(path.c_str()); }
+    } cleanup{path};
+    std::string error;
+    {
+        nn_autotune::Cache cache;
+        auto start = Clock::now();
+        std::istringstream file(model_file);
+        auto graph = nn_graph::Graph::parse(file, error);
+        const double load_ms = ms_since(start);
+        start = Clock::now();
+        const QConv qconv1(*conv1, q_in, q_hidden);
+        const QConv qconv2(*conv2, q_hidden, q_out);
+        const double pack_ms = ms_since(start);
+        start = Clock::now();
+        std::unique_ptr<nn_graph::GraphExecutor> mlp;
+        if (graph) {
+            mlp = nn_graph::GraphExecutor::create(std::move(*graph), registry, error, nn_graph::KernelSelection::Tuned,
+                                                  ThreadPool::global(), cache);
+        }
+        const double plan_ms = ms_since(start);
+        if (!mlp) {
+            cout << "  Cold start failed: " << error << "\n";
+            return;
+        }
+        start = Clock::now();
+        infer(qconv1, qconv2, *mlp);
+        report("Cold start", {{"parse", load_ms}, {"quantize + pack", pack_ms}, {"plan + tune", plan_ms},
+                              {"first inference", ms_since(start)}});
+        
+        // The warm process leaves a snapshot behind
+        nn_snapshot::Writer writer;
+        qconv1.save(writer, "conv1");
+        qconv2.save(writer, "conv2");
+        std::istringstream again(model_file);
+        auto shipped = nn_graph::Graph::parse(again, error);
+        if (!shipped) {
+            cout << "  Snapshot failed: " << error << "\n";
+            return;
+        }
+        shipped->save(writer, "mlp");
+        nn_snapshot::save_cache(writer, cache);
+        if (!writer.write(path, error)) {
+            cout << "  Snapshot failed: " << error << "\n";
+            return;
+        }
+    }
+    {
+        nn_autotune::Cache cache;
+        auto start = Clock::now();
+        auto snapshot = nn_snapshot::Snapshot::open(path, error);
+        const double map_ms = ms_since(start);
+        if (!snapshot) {
+            cout << "  Warm start failed: " << error << "\n";
+            return;
+        }
+        start = Clock::now();
+        nn_snapshot::load_cache(*snapshot, cache);
+        auto qconv1 = QConv::load(snapshot, "conv1", error);
+        auto qconv2 = QConv::load(snapshot, "conv2", error);
+        auto graph = nn_graph::Graph::load(snapshot, "mlp", error);
+        const double load_ms = ms_since(start);
+        start = Clock::now();
+        auto mlp = qconv1 && qconv2 && graph
+                       ? nn_graph::GraphExecutor::create(std::move(*graph), registry, error,
+                                                         nn_graph::KernelSelection::Tuned, ThreadPool::global(), cache)
+                       : nullptr;
+        const double plan_ms = ms_since(start);
+        if (!mlp) {
+            cout << "  Warm start failed: " << error << "\n";
+            return;
+        }
+        start = Clock::now();
+        infer(*qconv1, *qconv2, *mlp);
+        report("Warm start", {{"map", map_ms}, {"load", load_ms}, {"plan (cached)", plan_ms},
+                              {"first inference", ms_since(start)}});
+        cout << "  Snapshot: " << snapshot->size() / 1024 << " KiB\n";
+        
+        BenchmarkStats stats("Steady-state inference after warm start - C++ (Meta)");
+        stats.run_benchmark([&]() { infer(*qconv1, *qconv2, *mlp); }, 10, 2);
+        stats.print_stats();
+    }
+}
+
+void benchmark_zygote() {
+    cout << "\n=== Zygote Workers Benchmark (MLP 1024 -> 2048 -> 2048 -> 10, batch 16, weights shared copy-on-write) ===\n";
+    
+    constexpr std::size_t workers = 2;
+    constexpr int inferences = 10;
+    constexpr std::size_t batch = 16;
+    const std::size_t sizes[] = {1024, 2048, 2048, 10};
+    
+    // Parent: load, plan and warm once
+    const auto start = std::chrono::steady_clock::now();
+    nn_graph::Graph graph;
+    graph.add_input("x", {batch, sizes[0]});
+    nn_random::Philox init(benchmark_seed, 24);
+    std::uint64_t offset = 0;
+    std::string input = "x";
+    nn_zygote::Zygote zygote;
+    for (std::size_t l = 0; l < 3; ++l) {
+        const std::string name = "fc" + std::to_string(l + 1);
+        auto& w = graph.add_param(name + ".w", {sizes[l + 1], sizes[l]}).data;
+        init.normal_range(w.data(), 0, w.size(), 0.0f, 0.03f, offset);
+        offset += (w.size() + 3) / 4;
+        auto& b = graph.add_param(name + ".b", {sizes[l + 1]}).data;
+        zygote.share(w.data(), sizeof(float) * w.size());
+        zygote.share(b.data(), sizeof(float) * b.size());
+        graph.add_node("linear", name, {input, name + ".w", name + ".b"});
+        input = name;
+        if (l < 2) {
+            graph.add_node("relu", name + ".relu", {name});
+            input = name + ".relu";
+        }
+    }
+    graph.add_output(input);
+    std::string error;
+    auto executor = nn_graph::GraphExecutor::create(std::move(graph), nn_graph::KernelRegistry::builtin(), error);
+    if (!executor) {
+        cout << "  Failed to plan the model: " << error << "\n";
+        return;
+    }
+    nn_random::Philox(benchmark_seed, 25).uniform_range(executor->input("x"), 0, batch * sizes[0], 0.0f, 1.0f);
+    executor->run();
+    const double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    
+    auto mib = [](std::size_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+    cout << std::fixed << std::setprecision(2) << "Parent: load + plan + warm-up " << load_ms << " ms, "
+         << mib(zygote.shared_bytes()) << " MiB of weights registered\n";
+    if (auto usage = nn_zygote::smaps_usage(zygote.shared_regions())) {
+        cout << "  Before fork: Rss " << mib(usage->rss) << " MiB, private " << mib(usage->private_bytes())
+             << " MiB\n";
+    }
+    
+    auto reports = zygote.run(workers, 1, [&](std::size_t, ThreadPool& pool) {
+        for (int i = 0; i < inferences; ++i) executor->run(pool);
+        return executor->output(input) != nullptr ? 0 : 1;
+    });
+    std::size_t saved = 0;
+    for (const auto& report : reports) {
+        cout << "  Worker " << report.worker << ": exit " << report.exit_code << ", " << inferences
+             << " inferences in " << report.seconds * 1e3 << " ms";
+        if (report.has_usage) {
+            const auto& u = report.shared_buffers;
+            cout << ", weight mappings Rss " << mib(u.rss) << " MiB = shared " << mib(u.shared()) << " + private "
+                 << mib(u.private_bytes()) << " (dirty " << mib(u.private_dirty) << "), Pss " << mib(u.pss)
+                 << " MiB";
+            saved += u.shared();
+        }
+        cout << "\n";
+    }
+    cout << "  Memory saved per worker: " << mib(saved / workers) << " MiB shared instead of a private copy\n"
+         << "  Start-up saved per worker: " << load_ms << " ms of load + plan + warm-up not repeated\n"
+         << std::defaultfloat;
+}
+
+void benchmark_scheduler() {
+    cout << "\n=== Request Scheduler Benchmark (interactive MLP batch 1 + background MLP batch 64, mixed load) ===\n";
+    
+    // One executor per class: a class runs one request at a time
+    auto build = [](const std::vector<std::size_t>& sizes, std::size_t batch, std::uint64_t stream) {
+        nn_graph::Graph graph;
+        graph.add_input("x", {batch, sizes[0]});
+        nn_random::Philox init(benchmark_seed, stream);
+        std::uint64_t offset = 0;
+        std::string input = "x";
+        for (std::size_t l = 0; l + 1 < sizes.size(); ++l) {
+            const std::string name = "fc" + std::to_string(l + 1);
+            auto& w = graph.add_param(name + ".w", {sizes[l + 1], sizes[l]}).data;
+            init.normal_range(w.data(), 0, w.size(), 0.0f, 0.03f, offset);
+            offset += (w.size() + 3) / 4;
+            graph.add_param(name + ".b", {sizes[l + 1]});
+            graph.add_node("linear", name, {input, name + ".w", name + ".b"});
+            input = name;
+            if (l + 2 < sizes.size()) {
+                graph.add_node("relu", name + ".relu", {name});
+                input = name + ".relu";
+            }
+        }
+        graph.add_output(input);
+        std::string error;
+        auto executor = nn_graph::GraphExecutor::create(std::move(graph), nn_graph::KernelRegistry::builtin(), error);
+        if (executor) {
+            nn_random::Philox(benchmark_seed, stream + 1).uniform_range(executor->input("x"), 0, batch * sizes[0],
+                                                                        0.0f, 1.0f);
+        }
+        return executor;
+    };
+    auto interactive = build({784, 256, 128, 10}, 1, 26);
+    auto background = build({1024, 1024, 1024, 1024, 10}, 64, 28);
+    if (!interactive || !background) {
+        cout << "  Failed to plan the models\n";
+        return;
+    }
+    
+    using Clock = nn_scheduler::Clock;
+    auto time_us = [](auto&& fn) {
+        fn();
+        const auto start = Clock::now();
+        fn();
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    };
+    const double interactive_us = time_us([&] { interactive->run(); });
+    const double background_us = time_us([&] { background->run(); });
+    cout << std::fixed << std::setprecision(2) << "Service time: interactive " << interactive_us / 1e3
+         << " ms (" << interactive->num_steps() << " steps), background " << background_us / 1e3 << " ms ("
+         << background->num_steps() << " steps)\n";
+    
+    // Load scaled to this host: background arrives at 125% of capacity with a deadline of
+    // 4 service times; interactive arrives 8x as often with a deadline of half a background request
+    constexpr int background_requests = 40;
+    const auto background_period = std::chrono::duration<double, std::micro>(background_us / 1.25);
+    const auto interactive_period = std::chrono::duration<double, std::micro>(background_us / 8);
+    const auto background_slack = std::chrono::duration<double, std::micro>(4 * background_us);
+    const auto interactive_slack = std::chrono::duration<double, std::micro>(background_us / 2);
+    const auto span = background_period * background_requests;
+    
+    // Outcomes per request kind, so the one-class run can be compared with the two-class one
+    struct Tally {
+        std::mutex mutex;
+        std::size_t on_time = 0, late = 0, rejected = 0, expired = 0;
+        std::vector<double> latencies;
+    };
+    auto run_load = [&](const char* title, std::vector<std::string> classes, std::size_t background_class) {
+        nn_scheduler::Scheduler scheduler(std::move(classes));
+        Tally tallies[2];  // interactive, background
+        auto submit = [&](nn_graph::GraphExecutor& executor, std::size_t priority, Tally& tally, const char* kind,
+                          Clock::time_point deadline) {
+            nn_scheduler::Request request;
+            request.priority = priority;
+            request.deadline = deadline;
+            request.kind = kind;
+            request.steps = executor.num_steps();
+            request.run_step = [&executor](std::size_t step, ThreadPool& pool) { executor.run_step(step, pool); };
+            request.done = [&tally](const nn_scheduler::Outcome& outcome) {
+                std::lock_guard<std::mutex> lock(tally.mutex);
+                switch (outcome.status) {
+                    case nn_scheduler::Status::Completed:
+                        ++(outcome.met_deadline ? tally.on_time : tally.late);
+                        tally.latencies.push_back(outcome.latency_us);
+                        break;
+                    case nn_scheduler::Status::Rejected: ++tally.rejected; break;
+                    case nn_scheduler::Status::Expired: ++tally.expired; break;
+                    case nn_scheduler::Status::Cancelled: break;
+                }
+            };
+            scheduler.submit(std::move(request));
+        };
+        const auto start = Clock::now();
+        auto at = [&](auto offset) { return start + std::chrono::duration_cast<Clock::duration>(offset); };
+        int b = 0, i = 0;
+        for (;;) {
+            const auto next_background = background_period * b;
+            const auto next_interactive = interactive_period * i;
+            if (next_background >= span && next_interactive >= span) break;
+            if (next_background <= next_interactive) {
+                std::this_thread::sleep_until(at(next_background));
+                submit(*background, background_class, tallies[1], "background",
+                       at(next_background + background_slack));
+                ++b;
+            } else {
+                std::this_thread::sleep_until(at(next_interactive));
+                submit(*interactive, 0, tallies[0], "interactive", at(next_interactive + interactive_slack));
+                ++i;
+            }
+        }
+        scheduler.drain();
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        
+        std::size_t preempted = 0;
+        for (const auto& s : scheduler.stats()) preempted += s.preempted;
+        cout << title << " (" << seconds << " s, " << preempted << " preemptions):\n";
+        const char* kinds[2] = {"interactive", "background"};
+        for (int k = 0; k < 2; ++k) {
+            auto& t = tallies[k];
+            std::sort(t.latencies.begin(), t.latencies.end());
+            auto percentile = [&](double q) {
+                if (t.latencies.empty()) return 0.0;
+                return t.latencies[static_cast<std::size_t>(q * static_cast<double>(t.latencies.size() - 1) + 0.5)];
+            };
+            cout << "  " << std::left << std::setw(12) << kinds[k] << std::right << " on time " << std::setw(4)
+                 << t.on_time << ", late " << std::setw(3) << t.late << ", rejected " << std::setw(3) << t.rejected
+                 << ", expired " << std::setw(3) << t.expired << ", latency p50 " << std::setw(7)
+                 << percentile(0.5) / 1e3 << " ms, p99 " << std::setw(7) << percentile(0.99) / 1e3 << " ms\n";
+        }
+    };
+    run_load("One class, earliest deadline first", {"all"}, 0);
+    run_load("Two classes, background preemptible at layer boundaries", {"interactive", "background"}, 1);
+    cout << std::defaultfloat;
+}
+
 int main() {
+    // NN_META_PROFILE=out.folded samples the run and writes folded stacks
+    auto profiler = nn_profiler::ScopedProfiler::from_env();
+    // NN_META_METRICS_PORT / NN_META_METRICS_FILE export kernel metrics
+    auto metrics = nn_metrics::ScopedMetricsExport::from_env();
+    // NN_META_AUTOTUNE_CACHE=tuning.tsv keeps autotune winners across runs
+    auto autotune = nn_autotune::ScopedCache::from_env();
+    nn_metrics::ModelScope model("benchmark");
+    
     cout << "========================================\n";
     cout << "C++ Metaprogramming Benchmark Suite\n";
     cout << "========================================\n";
@@ -260,6 +1743,28 @@ int main() {
     benchmark_relu();
     benchmark_linear_layer();
     benchmark_elementwise();
+    benchmark_data_parallel_training();
+    benchmark_softmax_cross_entropy();
+    benchmark_gradient_checkpointing();
+    benchmark_mixed_precision();
+    benchmark_random_fill();
+    benchmark_dropout();
+    benchmark_sampling();
+    benchmark_gemm();
+    benchmark_moe();
+    benchmark_sparse_attention();
+    benchmark_indexing();
+    benchmark_concat();
+    benchmark_scan();
+    benchmark_similarity_search();
+    benchmark_conv1d();
+    benchmark_conv2d();
+    benchmark_quantized_conv();
+    benchmark_graph_executor();
+    benchmark_autotune();
+    benchmark_warm_start();
+    benchmark_zygote();
+    benchmark_scheduler();
     
     cout << "\n========================================\n";
     cout << "Benchmark Complete!\n";
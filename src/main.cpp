@@ -3,6 +3,7 @@
 #include "tensor.hpp"
 #include "expression_template.hpp"
 #include "nn_compiler.hpp"
+#include "memory_tracker.hpp"
 
 using namespace std;
 
@@ -174,6 +175,36 @@ int main() {
     cout << "sum([2, 3, 4]) = " << sum << " (computed at compile time)\n";
     cout << "\n";
     
+    // ============================================================
+    // 8. Tensor Memory Accounting
+    // ============================================================
+    cout << "8. Tensor Memory Accounting\n";
+    cout << "-----------------------------------------------\n";
+    
+    {
+        using namespace nn_memory;
+        
+        // Heap-allocated layer and activations, tagged by owner and purpose
+        MemoryOwnerScope owner("LinearLayer<256, 128>");
+        auto layer = make_tracked<LinearLayer<float, 256, 128>>(MemoryPurpose::Weights);
+        auto activation_in = make_tracked<Tensor<float, 256>>(MemoryPurpose::Activations);
+        auto activation_out = make_tracked<Tensor<float, 128>>(
+            MemoryPurpose::Activations, layer->forward(*activation_in));
+        std::vector<float, TrackingAllocator<float>> workspace(
+            4096, TrackingAllocator<float>(MemoryPurpose::Workspace));
+        
+        MemoryTracker::instance().dump();
+        
+        activation_in.reset();
+        activation_out.reset();
+        cout << "After releasing activations: current = "
+             << MemoryTracker::instance().current_bytes() << " B, peak = "
+             << MemoryTracker::instance().peak_bytes() << " B\n";
+    }
+    cout << "Tags still holding memory after scope exit: "
+         << nn_memory::MemoryTracker::instance().live().size() << "\n";
+    cout << "\n";
+    
     // ============================================================
     // Summary
     // ============================================================